@@ -1,133 +1,44 @@
 #include <iostream>
 #include <string>
+#include <cstdlib>
+#include <cmath>
+#include <algorithm>
 
 #include "image.h"
 #include "imageIO.h"
+#include "bilateral.h"
+#include "bilateralGrid.h"
+#include "permutohedral.h"
+#include "flashPipeline.h"
 
-void bilateralfilter(image &original, int x, int y)
+void imgdetail(image_view base, const_image_view flash)
 {
+    base.checkSize(flash);
 
-    float sigmad = 5.0; //
-    float sigmar = 0.05; // 0.05~0.1
-    int window = 3;
-    float red0 = original(x, y).r;
-    float green0 = original(x, y).g;
-    float blue0 = original(x, y).b;
-    int i, j;
-    float gd;
-    float red, green, blue;
-    float red2 = 0.0;
-    float green2 = 0.0;
-    float blue2 = 0.0;
-    float gr;
-    float sumweight = 0.0;
-    
-    
-    for(i = -window; i <= window; i++)
-    {
-        for(j = -window; j <= window; j++)
-        {
-            if((x + i < original.width()) && (x + i >= 0) && (y + j < original.height()) && (y + j >= 0))
-            {
-                gd = exp(- (float)(i * i + j * j) / (2 * sigmad * sigmad));
-
-                red = original(x + i, y + j).r;
-                green = original(x + i, y + j).g;
-                blue = original(x + i, y + j).b;
-            
-                gr = exp(- ((red0 - red) * (red0 - red) + (green0 - green) * (green0 - green) + (blue0 - blue) * (blue0 - blue)) / (2 * sigmar * sigmar));
-
-                sumweight += gd * gr;
-		
-		red2 += original(x + i, y + j).r * gd * gr;
-                green2 += original(x + i, y + j).g * gd * gr;
-                blue2 += original(x + i, y + j).b * gd * gr;
-            }
-        }
-    }
-    
-    original(x, y).r = red2 / sumweight;
-    original(x, y).g = green2 / sumweight;
-    original(x, y).b = blue2 / sumweight; 
-}
-
-void jointbilateralfilter(image &original, image &flash, int x, int y)
-{
-
-    float sigmad = 5.0; //
-    float sigmar = 0.001; //0.1% of the total range of color values
-    int window = 3;
-    float red0 = original(x, y).r;
-    float green0 = original(x, y).g;
-    float blue0 = original(x, y).b;
-    float redf = flash(x, y).r;
-    float greenf = flash(x, y).g;
-    float bluef = flash(x, y).b;
-    int i, j;
-    float gd;
-    float red, green, blue;
-    float red2 = 0.0;
-    float green2 = 0.0;
-    float blue2 = 0.0;
-    float gr;
-    float sumweight = 0.0;
-    
-    
-    for(i = -window; i <= window; i++)
-    {
-        for(j = -window; j <= window; j++)
-        {
-            if((x + i < original.width()) && (x + i >= 0) && (y + j < original.height()) && (y + j >= 0))
-            {
-
-                
-                gd = exp(- (float)(i * i + j * j) / (2 * sigmad * sigmad));
-                //std::cerr <<gd << std::endl;
-
-                red = flash(x + i, y + j).r;
-                green = flash(x + i, y + j).g;
-                blue = flash(x + i, y + j).b;
-            
-                gr = exp(- ((redf - red) * (redf - red) + (greenf - green) * (greenf - green) + (bluef - blue) * (bluef - blue)) / (2 * sigmar * sigmar));
-
-                sumweight += gd * gr;
-		
-		red2 += original(x + i, y + j).r * gd * gr;
-                green2 += original(x + i, y + j).g * gd * gr;
-                blue2 += original(x + i, y + j).b * gd * gr;
-            }
-        }
-    }
-    
-    original(x, y).r = red2 / sumweight;
-    original(x, y).g = green2 / sumweight;
-    original(x, y).b = blue2 / sumweight; 
-}
-
-void imgdetail(image &base, image flash)
-{
     int i, j;
     color<float> e(0.02, 0.02, 0.02); //0.02
     
-    for(i = 0; i < base.width() ; i++)
+    for(j = 0; j < base.height(); j++)
     {
-        for(j = 0; j < base.height(); j++)
+        for(i = 0; i < base.width() ; i++)
 	{
 	    base(i, j) = (flash(i, j) + e) / (base(i, j) + e);
 	}
     }
 }
 
-void imgmask(image &original, image flash)
+void imgmask(image_view original, const_image_view flash)
 {
+	original.checkSize(flash);
+
 	int i, j;
 	color<float> t(0.95, 0.95, 0.95); //95% of range of sensor output values
 	color<float> m1(1.0, 1.0, 1.0);
 	color<float> m0(0.0, 0.0, 0.0);
 
-	for(i = 0; i < original.width(); i++)
+	for(j = 0; j < original.height(); j++)
 	{
-		for(j = 0; j < original.height(); j++)
+		for(i = 0; i < original.width(); i++)
 		{
 			if(flash(i, j) - original(i, j) < t)
 			{
@@ -141,22 +52,28 @@ void imgmask(image &original, image flash)
 	}
 }
 
-void imgfinal(image &base, image nr, image detail, image mask)
+void imgfinal(image_view base, const_image_view nr, const_image_view detail, const_image_view mask)
 {
+	base.checkSize(nr);
+	base.checkSize(detail);
+	base.checkSize(mask);
+
 	int i, j;
 	color<float> m1(1.0, 1.0, 1.0);
 
-	for(i = 0; i < base.width(); i++)
+	for(j = 0; j < base.height(); j++)
 	{
-		for(j = 0; j < base.height(); j++)
+		for(i = 0; i < base.width(); i++)
 		{
 			base(i, j) = (m1 - mask(i, j)) * nr(i, j) * detail(i, j) + mask(i, j) * base(i, j);				             
 		}
 	}
 }
 
-void whitebalance(image &original, image flash)
+void whitebalance(image_view original, const_image_view flash)
 {
+    original.checkSize(flash);
+
     int i, j;
     int m = 0;
     int n = 0;
@@ -168,9 +85,9 @@ void whitebalance(image &original, image flash)
     color<float> sumcp(0.0, 0.0, 0.0);
     color<float> c(0.0, 0.0, 0.0);
 
-    for(i = 0; i < original.width(); i++)
+    for(j = 0; j < original.height(); j++)
     {
-	for(j = 0; j < original.height(); j++)
+	for(i = 0; i < original.width(); i++)
 	{
 	    dp = flash(i, j) - original(i, j);
 	    if((abs(original(i, j).r) >= t1) && (dp.r >= t2))
@@ -199,75 +116,154 @@ void whitebalance(image &original, image flash)
     c.r = sumcp.r / (float)m;
     c.g = sumcp.g / (float)n;
     c.b = sumcp.b / (float)l;
-    for(i = 0; i < original.width(); i++)
+    for(j = 0; j < original.height(); j++)
     {
-	for(j = 0; j < original.height(); j++)
+	for(i = 0; i < original.width(); i++)
 	{
 	    original(i, j) /= c;
 	}
     }
 }
 
+//////////////////////////////////////////////
+// spatial window of the LUT kernels: the   //
+// historical 7x7 by default, +/-3 sigma    //
+// for an explicit -sigmad                  //
+//////////////////////////////////////////////
+int lutWindow(float sigmad)
+{
+  return (sigmad > 0) ? std::max(1, (int)(std::ceil(3.0f * sigmad))) : 3;
+}
+
+void usage(const char* name)
+{
+  std::cerr << "Usage: " << name << " [options] <stage> <input images> <output image name>" << std::endl;
+  std::cerr << "  * bilateral    <image> <output>" << std::endl;
+  std::cerr << "  * joint        <no-flash image> <flash image> <output>" << std::endl;
+  std::cerr << "  * detail       <flash base image> <flash image> <output>" << std::endl;
+  std::cerr << "  * mask         <no-flash image> <flash image> <output>" << std::endl;
+  std::cerr << "  * final        <no-flash image> <nr image> <detail image> <mask image> <output>" << std::endl;
+  std::cerr << "  * whitebalance <image> <flash image> <output>" << std::endl;
+  std::cerr << "  * pipeline     <no-flash image> <flash image> <output>" << std::endl;
+  std::cerr << "Options:" << std::endl;
+  std::cerr << "  -grid           use a bilateral grid for the bilateral and joint stages" << std::endl;
+  std::cerr << "  -lattice        use a 5D permutohedral lattice for the joint stage" << std::endl;
+  std::cerr << "  -sigmad <value> spatial sigma (pixels); without -grid/-lattice the window is +/-3 sigma" << std::endl;
+  std::cerr << "  -sigmar <value> range sigma" << std::endl;
+  std::cerr << "  -dump <prefix>  write the pipeline intermediates to <prefix>{nr,detail,mask}.pfm" << std::endl;
+  std::cerr << "  * pipeline applies -sigmad and -sigmar to both bilateral filters; -grid and -lattice are not supported" << std::endl;
+}
+
 int main(int argc, char** argv)
 {           
   // parse commend line
-  if(argc != 6)
+  bool useGrid = false;
+  bool useLattice = false;
+  float sigmad = -1.0f;
+  float sigmar = -1.0f;
+  std::string dumpPrefix;
+
+  int arg = 1;
+  for(; arg < argc && argv[arg][0] == '-'; arg++)
+  {
+    std::string option = argv[arg];
+    if(option == "-grid") useGrid = true;
+    else if(option == "-lattice") useLattice = true;
+    else if(option == "-sigmad" && arg+1 < argc) sigmad = atof(argv[++arg]);
+    else if(option == "-sigmar" && arg+1 < argc) sigmar = atof(argv[++arg]);
+    else if(option == "-dump" && arg+1 < argc) dumpPrefix = argv[++arg];
+    else
+    {
+      usage(argv[0]);
+      return -1;
+    }
+  }
+
+  if(argc - arg < 3)
   {
-    std::cerr << "Usage: " << argv[0] << "<input original image name> <input original image name> <input original image name> <input original image name> <output image name>" << std::endl;
+    usage(argv[0]);
     return -1;
   }
 
-    // load and save images
-    image img0, img1;
-    image img2, img3;
-    ::io::importImage(argv[1], img0);
-    ::io::importImage(argv[2], img1);
-    ::io::importImage(argv[3], img2);
-    ::io::importImage(argv[4], img3);
+  std::string stage = argv[arg];
+  char** inputs = &argv[arg+1];
+  int numInputs = argc - arg - 2;
 
-    int i, j;
-    int i0, j0;
-    int width, height;
+  // load images
+  image img0, img1;
+  image img2, img3;
+  if(numInputs > 0) ::io::importImage(inputs[0], img0);
+  if(numInputs > 1) ::io::importImage(inputs[1], img1);
+  if(numInputs > 2) ::io::importImage(inputs[2], img2);
+  if(numInputs > 3) ::io::importImage(inputs[3], img3);
 
-    i0 = 0;
-    j0 = 0;
-    width = img0.width();
-    height = img0.height();
-    
-    std::cerr <<img0.width() << std::endl;
-    std::cerr <<img0.height() << std::endl;
-    std::cerr <<img0.size() << std::endl;
-    
-    /*for(i = i0; i < width ; i++)
+  std::cerr << img0.width() << std::endl;
+  std::cerr << img0.height() << std::endl;
+  std::cerr << img0.size() << std::endl;
+
+  // run stage
+  if(stage == "bilateral" && numInputs == 1)
+  {
+    if(useGrid) ::filter::bilateralGridFilter(img0, img0, (sigmad > 0) ? sigmad : 16.0f, (sigmar > 0) ? sigmar : 0.1f);
+    else ::filter::bilateral(img0, img0, ::filter::bilateralKernel((sigmad > 0) ? sigmad : 5.0f, (sigmar > 0) ? sigmar : 0.05f, lutWindow(sigmad)));
+  }
+
+  else if(stage == "joint" && numInputs == 2)
+  {
+    if(useLattice) ::filter::jointBilateralLattice(img0, img1, img0, (sigmad > 0) ? sigmad : 5.0f, (sigmar > 0) ? sigmar : 0.001f);
+    else if(useGrid) ::filter::jointBilateralGridFilter(img0, img1, img0, (sigmad > 0) ? sigmad : 16.0f, (sigmar > 0) ? sigmar : 0.1f);
+    else ::filter::jointBilateral(img0, img1, img0, ::filter::bilateralKernel((sigmad > 0) ? sigmad : 5.0f, (sigmar > 0) ? sigmar : 0.001f, lutWindow(sigmad)));
+  }
+
+  else if(stage == "detail" && numInputs == 2)
+    imgdetail(img0, img1);
+
+  else if(stage == "mask" && numInputs == 2)
+    imgmask(img0, img1);
+
+  else if(stage == "final" && numInputs == 4)
+    imgfinal(img0, img1, img2, img3);
+
+  else if(stage == "whitebalance" && numInputs == 2)
+    whitebalance(img0, img1);
+
+  else if(stage == "pipeline" && numInputs == 2)
+  {
+    // the fused pipeline filters tiles with the LUT kernels only
+    if(useGrid || useLattice)
     {
-        for(j = j0; j < height; j++)
-        {
-            bilateralfilter(img0, i, j);
+      usage(argv[0]);
+      return -1;
+    }
 
-        }
-    }*/
-    
-    /*for(i = i0; i < width ; i++)
+    ::flash::options opt;
+    opt.nrKernel = ::filter::bilateralKernel((sigmad > 0) ? sigmad : 5.0f, (sigmar > 0) ? sigmar : 0.001f, lutWindow(sigmad));
+    opt.baseKernel = ::filter::bilateralKernel((sigmad > 0) ? sigmad : 5.0f, (sigmar > 0) ? sigmar : 0.05f, lutWindow(sigmad));
+
+    image result, nr, detail, mask;
+    ::flash::intermediates dump;
+    if(!dumpPrefix.empty()) dump = ::flash::intermediates(&nr, &detail, &mask);
+
+    ::flash::pipeline(img0, img1, result, opt, dump);
+    swap(result, img0);
+
+    if(!dumpPrefix.empty())
     {
-        for(j = j0; j < height; j++)
-        {
-            jointbilateralfilter(img0, img1, i, j);
+      ::io::exportImage(dumpPrefix + "nr.pfm", nr);
+      ::io::exportImage(dumpPrefix + "detail.pfm", detail);
+      ::io::exportImage(dumpPrefix + "mask.pfm", mask);
+    }
+  }
 
-        }
-    }*/
-   
-    //imgdetail(img0, img1);
+  else
+  {
+    usage(argv[0]);
+    return -1;
+  }
 
-    //imgmask(img0, img1);
-    
-    imgfinal(img0, img1, img2, img3);
-    
-    //whitebalance(img0, img1);
-    
-    ::io::exportImage(argv[3], img0);
-    
-    
+  // save result
+  ::io::exportImage(argv[argc-1], img0);
 
-    // Done.
-    return 0;
+  // Done.
+  return 0;
 }
@@ -1,9 +1,198 @@
 #include <iostream>
+#include <fstream>
+#include <sstream>
 #include <string>
+#include <vector>
+#include <map>
+#include <cstdlib>
+#include <climits>
+#include <algorithm>
+#include <glob.h>
+#include <unistd.h>
+#include <sys/time.h>
 
 #include "image.h"
 #include "imageIO.h"
 
+//////////////////////////////////////////////
+// output name: '%s' in the pattern is      //
+// replaced by the input name without its   //
+// directory and extension                  //
+//////////////////////////////////////////////
+std::string outputName(const std::string& pattern, const std::string& input)
+{
+  std::string::size_type slash = input.rfind('/');
+  std::string base = (slash == std::string::npos) ? input : input.substr(slash + 1);
+  std::string::size_type dot = base.rfind('.');
+  if(dot != std::string::npos && dot != 0) base = base.substr(0, dot);
+
+  std::string result = pattern;
+  std::string::size_type pos = result.find("%s");
+  if(pos != std::string::npos) result.replace(pos, 2, base);
+  return result;
+}
+
+
+//////////////////////////////////////////////
+// expand an input argument: '@file' reads  //
+// one name per line, arguments containing  //
+// wildcards are globbed (for lists that    //
+// exceed the shell's argument limit)       //
+//////////////////////////////////////////////
+void addInputs(const std::string& arg, std::vector<std::string>& inputs)
+{
+  if(!arg.empty() && arg[0] == '@')
+  {
+    std::ifstream list(arg.substr(1).c_str());
+    if(!list) throw fileNotFound(arg.substr(1), "reading");
+    std::string line;
+    while(std::getline(list, line))
+      if(!line.empty()) inputs.push_back(line);
+  }
+
+  else if(arg.find_first_of("*?[") != std::string::npos)
+  {
+    glob_t matches;
+    if(glob(arg.c_str(), 0, NULL, &matches) == 0)
+      for(size_t i=0; i < matches.gl_pathc; i++)
+	inputs.push_back(matches.gl_pathv[i]);
+    globfree(&matches);
+  }
+
+  else inputs.push_back(arg);
+}
+
+
+//////////////////////////////////////////////
+// name with the directory resolved (the    //
+// file itself need not exist), such that   //
+// different spellings of the same path     //
+// compare equal                            //
+//////////////////////////////////////////////
+std::string canonicalName(const std::string& name)
+{
+  std::string::size_type slash = name.rfind('/');
+  std::string dir = (slash == std::string::npos) ? "." : name.substr(0, std::max<std::string::size_type>(slash, 1));
+  std::string base = (slash == std::string::npos) ? name : name.substr(slash + 1);
+
+  char resolved[PATH_MAX];
+  if(realpath(dir.c_str(), resolved) == NULL) return name;
+  return std::string(resolved) + "/" + base;
+}
+
+
+//////////////////////////////////////////////
+// check that every input maps to its own   //
+// output, and that no output overwrites an //
+// input; reports all conflicts             //
+//////////////////////////////////////////////
+bool checkOutputs(const std::string& pattern, const std::vector<std::string>& inputs)
+{
+  bool valid = true;
+  std::map<std::string, std::string> inputNames, outputNames;
+  for(size_t i=0; i < inputs.size(); i++)
+    inputNames[canonicalName(inputs[i])] = inputs[i];
+
+  for(size_t i=0; i < inputs.size(); i++)
+  {
+    std::string output = outputName(pattern, inputs[i]);
+    std::string name = canonicalName(output);
+
+    std::map<std::string, std::string>::const_iterator itr = inputNames.find(name);
+    if(itr != inputNames.end())
+    {
+      std::cerr << inputs[i] << ": output " << output << " overwrites input " << itr->second << std::endl;
+      valid = false;
+    }
+
+    itr = outputNames.find(name);
+    if(itr != outputNames.end())
+    {
+      std::cerr << inputs[i] << ": output " << output << " is also written for " << itr->second << std::endl;
+      valid = false;
+    }
+    else outputNames[name] = inputs[i];
+  }
+
+  return valid;
+}
+
+
+double now(void)
+{
+  struct timeval time;
+  gettimeofday(&time, NULL);
+  return time.tv_sec + 1e-6 * time.tv_usec;
+}
+
+
+//////////////////////////////////////////////
+// Batch conversion: files are distributed  //
+// over a pool of workers, each decoding,   //
+// converting and encoding one file at a    //
+// time.  Memory is thus bounded by one     //
+// image per worker.                        //
+//////////////////////////////////////////////
+int batch(const std::string& pattern, const std::vector<std::string>& inputs, int workers)
+{
+  // sanity check
+  if(inputs.empty())
+  {
+    std::cerr << "Error: no input images (wildcards without matches?)" << std::endl;
+    return -1;
+  }
+
+  if(inputs.size() > 1 && pattern.find("%s") == std::string::npos)
+  {
+    std::cerr << "Error: the output pattern must contain '%s' when converting more than one image" << std::endl;
+    return -1;
+  }
+
+  if(!checkOutputs(pattern, inputs))
+  {
+    std::cerr << "Error: conflicting output names; nothing converted" << std::endl;
+    return -1;
+  }
+
+  int failed = 0;
+  double pixels = 0;
+  double start = now();
+
+#pragma omp parallel for schedule(dynamic, 1) num_threads(workers) reduction(+:failed,pixels)
+  for(int i=0; i < (int)(inputs.size()); i++)
+  {
+    std::string output = outputName(pattern, inputs[i]);
+    std::ostringstream message;
+
+    try
+    {
+      image img;
+      ::io::importImage(inputs[i], img);
+      ::io::exportImage(output, img);
+
+      pixels += (double)(img.width()) * img.height();
+      message << inputs[i] << " -> " << output << std::endl;
+    }
+    catch(std::exception& e)
+    {
+      failed++;
+      message << inputs[i] << ": " << e.what() << std::endl;
+    }
+
+#pragma omp critical
+    std::cerr << message.str();
+  }
+
+  // report throughput
+  double seconds = now() - start;
+  std::cerr << inputs.size() - failed << " of " << inputs.size() << " image(s) converted in " << seconds << " s ("
+	    << (inputs.size() - failed) / seconds << " images/s, " << pixels / (1e6 * seconds) << " Mpixels/s)" << std::endl;
+
+  // Done.
+  return (failed == 0) ? 0 : 1;
+}
+
+
 int main(int argc, char** argv)
 {
   // create a list of supported formats
@@ -22,35 +211,46 @@ int main(int argc, char** argv)
 #endif /* INCLUDE_TIFF */             
 
   // parse commend line
-  if(argc != 3)
+  bool infoOnly = (argc == 3 && std::string(argv[1]) == "-i");
+  bool batchMode = (argc >= 4 && std::string(argv[1]) == "-b");
+  if(argc != 3 && !batchMode)
   {
     std::cerr << "Usage: " << argv[0] << " <input image name> <output image name>" << std::endl;
+    std::cerr << "       " << argv[0] << " -i <input image name>" << std::endl;
+    std::cerr << "       " << argv[0] << " -b <output pattern> [-j <workers>] <input>..." << std::endl;
     std::cerr << "  * Supported formats: " << support_list << std::endl;
+    std::cerr << "  * Batch mode: '%s' in the output pattern is replaced by the input name" << std::endl;
+    std::cerr << "    without directory and extension (e.g., 'png/%s.png'); inputs can be" << std::endl;
+    std::cerr << "    names, quoted wildcards ('exr/*.exr') or '@<file>' with one name per line." << std::endl;
     return -1;
   }
 
+  // convert a list of images
+  if(batchMode)
+  {
+    int workers = sysconf(_SC_NPROCESSORS_ONLN);
+    std::vector<std::string> inputs;
+    for(int i=3; i < argc; i++)
+    {
+      if(std::string(argv[i]) == "-j" && i+1 < argc) workers = std::max(1, atoi(argv[++i]));
+      else addInputs(argv[i], inputs);
+    }
+
+    return batch(argv[2], inputs, workers);
+  }
+
+  // print image properties (header only)
+  std::string input = infoOnly ? argv[2] : argv[1];
+  ::io::imageInfo info = ::io::probeImage(input);
+  std::cerr << input << ": " << info.format << ", "
+	    << info.width << " x " << info.height << ", "
+	    << info.channels << " channel(s), "
+	    << info.bitDepth << " bit " << (info.floatingPoint ? "float" : "integer") << std::endl;
+  if(infoOnly) return 0;
+
   // load and save images
   image img;
-  ::io::importImage(argv[1], img);
-  float width = img.width();
-  float height = img.height();
-  float size = img.size();
-  float red0 = img(0,0).r;
-  float green0 = img(0,0).g;
-  float blue0 = img(0,0).b;  
-  float red1 = img(width-1,height-1).r;
-  float green1 = img(width-1,height-1).g;
-  float blue1 = img(width-1,height-1).b;  
-  std::cerr <<width << std::endl;
-  std::cerr <<height << std::endl;
-  std::cerr <<size << std::endl;
-  std::cerr <<red0 << std::endl;
-  std::cerr <<green0 << std::endl;
-  std::cerr <<blue0 << std::endl;
-  std::cerr <<red1 << std::endl;
-  std::cerr <<green1 << std::endl;
-  std::cerr <<blue1 << std::endl;  
-  
+  ::io::importImage(input, img);
   ::io::exportImage(argv[2], img);
 
   // Done.
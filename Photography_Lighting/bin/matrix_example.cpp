@@ -2,6 +2,7 @@
 
 #include "mat.h"
 #include "mat_operations.h"
+#include "mat_batched.h"
 
 int main(int argc, char** argv)
 {
@@ -27,6 +28,23 @@ int main(int argc, char** argv)
   least_squares(a, b);
   std::cerr << std::endl << "Solution to ax=b: " << std::endl << b << std::endl;
 
+  // test batched solvers: a well-posed and a rank deficient system each
+  double A[12] = {1.0, 2.0, 3.0,   1.0, 0.0, 1.0,       // 3x2, independent columns
+		  1.0, 2.0, 3.0,   1.0, 2.0, 3.0};      // 3x2, identical columns
+  double B[6] = {1.0, 2.0, 2.0,   1.0, 2.0, 3.0};
+  double X[4];
+  bool success[2];
+
+  batched::least_squares<3,2>(A, B, X, 2, batched::QR, success);
+  std::cerr << std::endl << "Batched least squares (QR): " << std::endl;
+  for(int s=0; s < 2; s++)
+    std::cerr << "  system " << s << ": " << (success[s] ? "solved" : "rank deficient") << ", x = " << X[2*s] << ", " << X[2*s+1] << std::endl;
+
+  batched::least_squares<3,2>(A, B, X, 2, batched::CHOLESKY, success);
+  std::cerr << "Batched least squares (Cholesky): " << std::endl;
+  for(int s=0; s < 2; s++)
+    std::cerr << "  system " << s << ": " << (success[s] ? "solved" : "rank deficient") << ", x = " << X[2*s] << ", " << X[2*s+1] << std::endl;
+
   // Done.
   return 0;
 }
@@ -0,0 +1,88 @@
+#ifndef _BILATERAL_H_
+#define _BILATERAL_H_
+
+#include <vector>
+#include <cmath>
+
+#include "image.h"
+
+namespace filter {
+
+  /////////////////////////////////////////////////////
+  // Precomputed bilateral weights.  The spatial     //
+  // Gaussian is separable and stored as a 1D table  //
+  // over [-window, window].  The range Gaussian is  //
+  // tabulated over the squared color distance,      //
+  // quantized in 'rangeBins' steps and cut off once //
+  // the weight becomes negligible.                  //
+  /////////////////////////////////////////////////////
+  class bilateralKernel {
+  public:
+    /////////////////
+    // Constructor //
+    /////////////////
+    bilateralKernel(float sigmad=5.0f, float sigmar=0.05f, int window=3, unsigned int rangeBins=4096);
+
+    ////////////////
+    // Inspectors //
+    ////////////////
+    float sigmad(void) const { return _sigmad; }
+    float sigmar(void) const { return _sigmar; }
+    int window(void) const   { return _window; }
+
+    float spatial(int offset) const { return _spatial[offset + _window]; }
+    float range(float distance2) const
+    {
+      float bin = distance2 * _rangeScale + 0.5f;
+      return (bin < _rangeBins) ? _range[(unsigned int)(bin)] : 0.0f;
+    }
+
+  private:
+    //////////////////
+    // Private Data //
+    //////////////////
+    float _sigmad, _sigmar;
+    int _window;
+    float _rangeBins, _rangeScale;
+    std::vector<float> _spatial;
+    std::vector<float> _range;
+  };
+
+
+  ///////////////////////////////////////////////////////
+  // Whole-image bilateral filter.  Reads from 'src'   //
+  // and writes to 'dst' (resized if needed); 'src'    //
+  // and 'dst' may be the same image.  Rows are split  //
+  // in tiles that are filtered in parallel.           //
+  ///////////////////////////////////////////////////////
+  void bilateral(const image& src, image& dst, const bilateralKernel& kernel=bilateralKernel());
+
+  ///////////////////////////////////////////////////////
+  // Joint (cross) bilateral filter: range weights are //
+  // computed on 'guide' instead of on 'src'.          //
+  ///////////////////////////////////////////////////////
+  void jointBilateral(const image& src, const image& guide, image& dst, const bilateralKernel& kernel=bilateralKernel(5.0f, 0.001f, 3));
+
+
+  namespace detail {
+    /////////////////////////////////////////////////////
+    // Filter rows [y0, y1) of 'src' into the view      //
+    // 'dst' (width() x (y1-y0) pixels).                //
+    /////////////////////////////////////////////////////
+    void bilateralRows(const image& src, const image& guide, const bilateralKernel& kernel, image::size_type y0, image::size_type y1, image_view dst);
+
+    void bilateralImage(const image& src, const image& guide, image& dst, const bilateralKernel& kernel);
+
+    // number of rows per parallel work item
+    const image::size_type bilateralTileRows = 16;
+  }
+
+} // end filter namespace
+
+
+////////////////////
+// Inline Methods //
+////////////////////
+#include "bilateral.inline.h"
+
+#endif /* _BILATERAL_H_ */
@@ -0,0 +1,147 @@
+////////////////////////////////////
+// Inline Methods for bilateral.h //
+////////////////////////////////////
+
+#include <algorithm>
+#include "exceptions.h"
+
+namespace filter {
+
+//////////////////////////////
+// bilateralKernel          //
+//                          //
+// The range table covers   //
+// exp(-t) for t in [0,16]; //
+// beyond that the weight   //
+// is below 1e-7 and is     //
+// treated as 0.            //
+//////////////////////////////
+inline bilateralKernel::bilateralKernel(float sigmad, float sigmar, int window, unsigned int rangeBins) : _sigmad(sigmad), _sigmar(sigmar), _window(window), _rangeBins((float)(rangeBins)), _spatial(2*window+1), _range(rangeBins+1)
+{
+  const float rangeCutoff = 16.0f;
+
+  // spatial table (1D, separable)
+  for(int i=-window; i <= window; i++)
+    _spatial[i + window] = exp(- (float)(i * i) / (2 * sigmad * sigmad));
+
+  // range table (quantized squared distance)
+  _rangeScale = _rangeBins / (rangeCutoff * 2 * sigmar * sigmar);
+  for(unsigned int i=0; i <= rangeBins; i++)
+    _range[i] = exp(- rangeCutoff * (float)(i) / _rangeBins);
+}
+
+
+//////////////////////////////
+// bilateral                //
+//////////////////////////////
+inline void bilateral(const image& src, image& dst, const bilateralKernel& kernel)
+{
+  detail::bilateralImage(src, src, dst, kernel);
+}
+
+
+//////////////////////////////
+// jointBilateral           //
+//////////////////////////////
+inline void jointBilateral(const image& src, const image& guide, image& dst, const bilateralKernel& kernel)
+{
+  detail::bilateralImage(src, guide, dst, kernel);
+}
+
+
+namespace detail {
+
+//////////////////////////////
+// bilateralRows            //
+//////////////////////////////
+inline void bilateralRows(const image& src, const image& guide, const bilateralKernel& kernel, image::size_type y0, image::size_type y1, image_view dst)
+{
+  const int width = src.width();
+  const int height = src.height();
+  const int window = kernel.window();
+
+  for(int y=y0; y < (int)(y1); y++)
+  {
+    // clip the window vertically
+    const int jmin = std::max(-window, -y);
+    const int jmax = std::min(window, height - 1 - y);
+    color<float>* out = dst.row(y - y0);
+
+    for(int x=0; x < width; x++)
+    {
+      // clip the window horizontally
+      const int imin = std::max(-window, -x);
+      const int imax = std::min(window, width - 1 - x);
+
+      const color<float>& center = guide(x, y);
+      color<float> sum(0.0f);
+      float sumweight = 0.0f;
+
+      for(int j=jmin; j <= jmax; j++)
+      {
+        const color<float>* srcRow = &src(x, y + j);
+        const color<float>* guideRow = &guide(x, y + j);
+        const float gy = kernel.spatial(j);
+
+        for(int i=imin; i <= imax; i++)
+        {
+          const color<float>& g = guideRow[i];
+          float dr = g.r - center.r;
+          float dg = g.g - center.g;
+          float db = g.b - center.b;
+
+          float weight = gy * kernel.spatial(i) * kernel.range(dr*dr + dg*dg + db*db);
+
+          const color<float>& s = srcRow[i];
+          sum.r += s.r * weight;
+          sum.g += s.g * weight;
+          sum.b += s.b * weight;
+          sumweight += weight;
+        }
+      }
+
+      // the center pixel always has weight 1 => sumweight > 0
+      out[x] = sum / sumweight;
+    }
+  }
+}
+
+
+//////////////////////////////
+// bilateralImage           //
+//////////////////////////////
+inline void bilateralImage(const image& src, const image& guide, image& dst, const bilateralKernel& kernel)
+{
+  // sanity check
+  if(src.width() != guide.width() || src.height() != guide.height()) throw buffer2dIllegalSize();
+
+  // filtering in place => go through a temporary
+  if(&dst == &src || &dst == &guide)
+  {
+    image temp;
+    bilateralImage(src, guide, temp, kernel);
+    swap(temp, dst);
+    return;
+  }
+
+  // allocate
+  if(dst.width() != src.width() || dst.height() != src.height())
+    dst.resize(src.width(), src.height());
+  if(src.empty()) return;
+
+  // filter tiles of rows in parallel
+  const int numTiles = (src.height() + bilateralTileRows - 1) / bilateralTileRows;
+
+#pragma omp parallel for schedule(dynamic)
+  for(int t=0; t < numTiles; t++)
+  {
+    image::size_type y0 = t * bilateralTileRows;
+    image::size_type y1 = std::min(y0 + bilateralTileRows, src.height());
+    bilateralRows(src, guide, kernel, y0, y1, image_view(dst).subview(0, y0, dst.width(), y1 - y0));
+  }
+
+  // Done.
+}
+
+} // end detail namespace
+} // end filter namespace
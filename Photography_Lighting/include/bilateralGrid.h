@@ -0,0 +1,99 @@
+#ifndef _BILATERALGRID_H_
+#define _BILATERALGRID_H_
+
+#include <vector>
+#include <cmath>
+#include <limits>
+
+#include "image.h"
+
+namespace filter {
+
+  ////////////////////////////////////////////////////////
+  // Bilateral grid (Paris & Durand / Chen et al.).     //
+  // The image is splatted into a coarse 3D grid over   //
+  // (x, y, intensity) with cells of sigmad x sigmad x  //
+  // sigmar, blurred with a small separable kernel, and //
+  // sliced back with trilinear interpolation.  The     //
+  // cost is linear in the number of pixels and nearly  //
+  // independent of sigmad.                             //
+  //                                                    //
+  // The grid is limited to maxCells cells: for wide    //
+  // intensity ranges (HDR) or a small sigmar, the      //
+  // range cells are widened (rangeStep() > sigmar),    //
+  // i.e., the range kernel becomes wider.  Non-finite  //
+  // pixels are not splatted; non-finite intensities    //
+  // are sliced at the nearest end of the range.        //
+  ////////////////////////////////////////////////////////
+  class bilateralGrid {
+  public:
+    static const unsigned int maxCells = 1 << 24;       // 256MB of cells
+
+    /////////////////
+    // Constructor //
+    /////////////////
+    bilateralGrid(float sigmad=16.0f, float sigmar=0.1f);
+
+    ////////////////
+    // Inspectors //
+    ////////////////
+    float sigmad(void) const { return _sigmad; }
+    float sigmar(void) const { return _sigmar; }
+    float rangeStep(void) const { return _rangeStep; }   // intensity per grid cell
+
+    unsigned int gridWidth(void) const  { return _nx; }
+    unsigned int gridHeight(void) const { return _ny; }
+    unsigned int gridDepth(void) const  { return _nz; }
+
+    /////////////
+    // Methods //
+    /////////////
+    void splat(const image& src, const image& edge);
+    void blur(void);
+    void slice(const image& edge, image& dst) const;
+
+  private:
+    /////////////////////
+    // Private Methods //
+    /////////////////////
+    struct cell {
+      color<float> value;
+      float weight;
+    };
+
+    static bool _isFinite(float v) { return std::fabs(v) <= std::numeric_limits<float>::max(); }
+    float _intensity(const color<float>& c) const;
+    void _blurAxis(unsigned int length, unsigned int stride, unsigned int numLines, unsigned int blockSize, unsigned int blockStride);
+
+    //////////////////
+    // Private Data //
+    //////////////////
+    float _sigmad, _sigmar;
+    float _minIntensity, _rangeStep;
+    float _padding;
+    unsigned int _nx, _ny, _nz;
+    std::vector<cell> _grid;
+  };
+
+
+  ///////////////////////////////////////////////////////
+  // Whole-image bilateral filter through a bilateral  //
+  // grid. 'src' and 'dst' may be the same image.      //
+  ///////////////////////////////////////////////////////
+  void bilateralGridFilter(const image& src, image& dst, float sigmad=16.0f, float sigmar=0.1f);
+
+  ///////////////////////////////////////////////////////
+  // Joint variant: the grid is built and sliced on    //
+  // the intensity of 'guide'.                         //
+  ///////////////////////////////////////////////////////
+  void jointBilateralGridFilter(const image& src, const image& guide, image& dst, float sigmad=16.0f, float sigmar=0.1f);
+
+} // end filter namespace
+
+
+////////////////////
+// Inline Methods //
+////////////////////
+#include "bilateralGrid.inline.h"
+
+#endif /* _BILATERALGRID_H_ */
@@ -0,0 +1,239 @@
+////////////////////////////////////////
+// Inline Methods for bilateralGrid.h //
+////////////////////////////////////////
+
+#include <cmath>
+#include <algorithm>
+#include "exceptions.h"
+
+namespace filter {
+
+//////////////////////////////
+// bilateralGrid            //
+//////////////////////////////
+inline bilateralGrid::bilateralGrid(float sigmad, float sigmar) : _sigmad(sigmad), _sigmar(sigmar), _minIntensity(0.0f), _rangeStep(sigmar), _padding(2.0f), _nx(0), _ny(0), _nz(0)
+{
+  // Do nothing
+}
+
+
+//////////////////////////////
+// splat                    //
+//                          //
+// Accumulate each pixel of //
+// 'src' in the nearest grid//
+// cell at the intensity of //
+// 'edge'.                  //
+//////////////////////////////
+inline void bilateralGrid::splat(const image& src, const image& edge)
+{
+  // sanity check
+  if(src.width() != edge.width() || src.height() != edge.height()) throw buffer2dIllegalSize();
+
+  // determine intensity range of the edge image (finite values only)
+  bool first = true;
+  float minIntensity = 0.0f, maxIntensity = 0.0f;
+  for(image::const_iterator itr=edge.begin(); itr != edge.end(); itr++)
+  {
+    float intensity = itr->average();
+    if(!_isFinite(intensity)) continue;
+    if(first || intensity < minIntensity) minIntensity = intensity;
+    if(first || intensity > maxIntensity) maxIntensity = intensity;
+    first = false;
+  }
+  _minIntensity = minIntensity;
+
+  // allocate grid; widen the range cells if needed to stay within maxCells
+  unsigned int padding = (unsigned int)(_padding);
+  _nx = (unsigned int)((src.width() - 1) / _sigmad) + 1 + 2*padding;
+  _ny = (unsigned int)((src.height() - 1) / _sigmad) + 1 + 2*padding;
+
+  unsigned int maxDepth = std::max<unsigned int>(maxCells / (_nx * _ny), 2 + 2*padding);
+  float range = maxIntensity - minIntensity;
+  _rangeStep = _sigmar;
+  if(range / _rangeStep >= (float)(maxDepth - 1 - 2*padding))
+    _rangeStep = range / (maxDepth - 1 - 2*padding);
+  _nz = std::min((unsigned int)(range / _rangeStep) + 1 + 2*padding, maxDepth);
+
+  cell empty;
+  empty.value = color<float>(0.0f);
+  empty.weight = 0.0f;
+  _grid.assign(_nx * _ny * _nz, empty);
+
+  // splat
+  for(image::size_type y=0; y < src.height(); y++)
+  {
+    unsigned int gy = (unsigned int)(y / _sigmad + _padding + 0.5f);
+    for(image::size_type x=0; x < src.width(); x++)
+    {
+      // skip non-finite pixels (they would poison the cell)
+      const color<float>& value = src(x,y);
+      if(!_isFinite(edge(x,y).average()) || !_isFinite(value.r) || !_isFinite(value.g) || !_isFinite(value.b)) continue;
+
+      unsigned int gx = (unsigned int)(x / _sigmad + _padding + 0.5f);
+      unsigned int gz = (unsigned int)(_intensity(edge(x,y)) + 0.5f);
+
+      cell& c = _grid[(gz*_ny + gy)*_nx + gx];
+      c.value += value;
+      c.weight += 1.0f;
+    }
+  }
+
+  // Done.
+}
+
+
+//////////////////////////////
+// _intensity (private)     //
+//                          //
+// Grid coordinate along    //
+// the range axis, clamped  //
+// to the grid (non-finite  //
+// values included).        //
+//////////////////////////////
+inline float bilateralGrid::_intensity(const color<float>& c) const
+{
+  float z = (c.average() - _minIntensity) / _rangeStep + _padding;
+  float maxZ = (float)(_nz) - _padding;
+  if(z >= _padding && z <= maxZ) return z;
+  return (z > maxZ) ? maxZ : _padding;               // includes NaN => _padding
+}
+
+
+//////////////////////////////
+// blur                     //
+//                          //
+// Separable [1 2 1] / 4    //
+// along each grid axis.    //
+//////////////////////////////
+inline void bilateralGrid::blur(void)
+{
+  _blurAxis(_nx, 1, _ny * _nz, 1, _nx);
+  _blurAxis(_ny, _nx, _nx * _nz, _nx, _nx * _ny);
+  _blurAxis(_nz, _nx * _ny, _nx * _ny, _nx * _ny, 0);
+}
+
+
+//////////////////////////////
+// slice                    //
+//                          //
+// Trilinearly interpolate  //
+// the grid at each pixel   //
+// of 'edge'.               //
+//////////////////////////////
+inline void bilateralGrid::slice(const image& edge, image& dst) const
+{
+  // allocate
+  if(dst.width() != edge.width() || dst.height() != edge.height())
+    dst.resize(edge.width(), edge.height());
+
+  const unsigned int sx = 1;
+  const unsigned int sy = _nx;
+  const unsigned int sz = _nx * _ny;
+  const int height = edge.height();
+
+#pragma omp parallel for schedule(dynamic)
+  for(int y=0; y < height; y++)
+  {
+    float fy = y / _sigmad + _padding;
+    unsigned int gy = (unsigned int)(fy);
+    float ty = fy - gy;
+
+    for(image::size_type x=0; x < edge.width(); x++)
+    {
+      float fx = x / _sigmad + _padding;
+      float fz = _intensity(edge(x,y));
+      unsigned int gx = (unsigned int)(fx);
+      unsigned int gz = (unsigned int)(fz);
+      float tx = fx - gx;
+      float tz = fz - gz;
+
+      // trilinear interpolation of the homogeneous value
+      const cell* base = &_grid[gz*sz + gy*sy + gx*sx];
+      color<float> value(0.0f);
+      float weight = 0.0f;
+      for(unsigned int k=0; k < 8; k++)
+      {
+        unsigned int dx = k & 1, dy = (k >> 1) & 1, dz = (k >> 2) & 1;
+        float w = (dx ? tx : 1.0f - tx) * (dy ? ty : 1.0f - ty) * (dz ? tz : 1.0f - tz);
+        const cell& c = base[dz*sz + dy*sy + dx*sx];
+        value += c.value * w;
+        weight += c.weight * w;
+      }
+
+      dst(x,y) = (weight > 0.0f) ? value / weight : value;
+    }
+  }
+
+  // Done.
+}
+
+
+//////////////////////////////
+// _blurAxis                //
+//                          //
+// Blur 'numLines' lines of //
+// 'length' cells spaced by //
+// 'stride'.  Line l starts //
+// at (l / blockSize) *     //
+// blockStride + l %        //
+// blockSize.               //
+//////////////////////////////
+inline void bilateralGrid::_blurAxis(unsigned int length, unsigned int stride, unsigned int numLines, unsigned int blockSize, unsigned int blockStride)
+{
+#pragma omp parallel
+  {
+    std::vector<cell> line(length);
+
+#pragma omp for
+    for(int l=0; l < (int)(numLines); l++)
+    {
+      cell* start = &_grid[(l / blockSize) * blockStride + (l % blockSize)];
+
+      // copy line
+      for(unsigned int i=0; i < length; i++)
+        line[i] = start[i*stride];
+
+      // blur (grid borders are zero padded)
+      for(unsigned int i=1; i+1 < length; i++)
+      {
+        cell& c = start[i*stride];
+        c.value = (line[i-1].value + line[i].value * 2.0f + line[i+1].value) * 0.25f;
+        c.weight = (line[i-1].weight + 2.0f * line[i].weight + line[i+1].weight) * 0.25f;
+      }
+    }
+  }
+}
+
+
+//////////////////////////////
+// bilateralGridFilter      //
+//////////////////////////////
+inline void bilateralGridFilter(const image& src, image& dst, float sigmad, float sigmar)
+{
+  jointBilateralGridFilter(src, src, dst, sigmad, sigmar);
+}
+
+
+//////////////////////////////
+// jointBilateralGridFilter //
+//////////////////////////////
+inline void jointBilateralGridFilter(const image& src, const image& guide, image& dst, float sigmad, float sigmar)
+{
+  if(src.empty()) { dst.resize(0, 0); return; }
+
+  bilateralGrid grid(sigmad, sigmar);
+  grid.splat(src, guide);
+  grid.blur();
+
+  // slice reads 'guide' only => safe if dst aliases src, not guide
+  if(&dst == &guide)
+  {
+    image temp;
+    grid.slice(guide, temp);
+    swap(temp, dst);
+  }
+  else grid.slice(guide, dst);
+}
+
+} // end filter namespace
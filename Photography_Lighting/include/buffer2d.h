@@ -4,10 +4,18 @@
 #include <ostream>
 #include <algorithm>
 #include <functional>
+#if __cplusplus >= 201103L
+#include <utility>
+#endif
+
+#include <boost/shared_ptr.hpp>
 
 #include "raises.h"
 #include "absoluteValue.h"
 #include "exceptions.h"
+#include "buffer2dLayout.h"
+#include "buffer2dIterator.h"
+#include "buffer2dExpression.h"
 
 template<typename T>
 class buffer2d {
@@ -15,18 +23,34 @@ class buffer2d {
   ///////////////
   // type defs //
   ///////////////
-  typedef T             value_type;
-  typedef T*            iterator;
-  typedef const T*      const_iterator;
-  typedef T&            reference;
-  typedef const T&      const_reference;
-  typedef size_t        size_type;
+  typedef T                               value_type;
+  typedef buffer2d_iterator<T>            iterator;
+  typedef buffer2d_iterator<const T>      const_iterator;
+  typedef T*                              pointer;
+  typedef const T*                        const_pointer;
+  typedef T&                              reference;
+  typedef const T&                        const_reference;
+  typedef size_t                          size_type;
 
   //////////////////
   // Constructors //
   //////////////////
-  explicit buffer2d(size_type width=0, size_type height=0, const_iterator init=NULL) { _allocate(width, height, init); }
-  buffer2d(const buffer2d<T>& b)                                                     { _allocate(b.width(), b.height(), b.begin()); }
+  explicit buffer2d(size_type width=0, size_type height=0, const_pointer init=NULL)   { _allocate(width, height, buffer2dLayout(), init); }
+  buffer2d(size_type width, size_type height, const buffer2dLayout& layout)          { _allocate(width, height, layout, NULL); }
+  buffer2d(const buffer2d<T>& b)                                                     { _allocate(b.width(), b.height(), b.layout(), NULL); _copy(b); }
+#if __cplusplus >= 201103L
+  buffer2d(buffer2d<T>&& b) : _storage(b._storage), _data(b._data), _width(b._width), _height(b._height), _size(b._size), _stride(b._stride), _layout(b._layout), _owner(b._owner) { b._release(); }
+#endif
+
+  ////////////////////////////////////////////////
+  // Wrap external storage (e.g., a memory      //
+  // mapped file).  The elements are neither    //
+  // constructed nor destroyed; 'owner' is kept //
+  // alive while the buffer refers to the data. //
+  ////////////////////////////////////////////////
+  buffer2d(pointer data, size_type width, size_type height, size_type stride, const boost::shared_ptr<void>& owner) : _storage(NULL), _data(data), _width(width), _height(height), _size(width*height), _stride(stride), _layout(), _owner(owner) {}
+  template<typename E>
+    buffer2d(const buffer2dExpression<E>& e)                                         { _allocate(e.width(), e.height(), buffer2dLayout(), NULL); _evaluate(e); }
 
   ////////////////
   // Destructor //
@@ -36,10 +60,10 @@ class buffer2d {
   ///////////////
   // Iterators //
   ///////////////
-  iterator          begin(void)         { return _data; }
-  const_iterator    begin(void) const   { return _data; }
-  iterator          end(void)           { return &(_data[size()]); }
-  const_iterator    end(void) const     { return &(_data[size()]); }
+  iterator          begin(void)         { return iterator(_data, 0, _width, _stride); }
+  const_iterator    begin(void) const   { return const_iterator(_data, 0, _width, _stride); }
+  iterator          end(void)           { return iterator(_data + _height*_stride, 0, _width, _stride); }
+  const_iterator    end(void) const     { return const_iterator(_data + _height*_stride, 0, _width, _stride); }
 
   ////////////////
   // Inspectors //
@@ -47,8 +71,16 @@ class buffer2d {
   size_type width(void) const  { return _width; }
   size_type height(void) const { return _height; }
   size_type size(void) const   { return _size; }
+  size_type stride(void) const { return _stride; }
+
+  const buffer2dLayout& layout(void) const { return _layout; }
 
-  bool empty(void) const { return (_width == 0) || (_height == 0); }
+  bool empty(void) const  { return (_width == 0) || (_height == 0); }
+  bool packed(void) const { return (_stride == _width); }
+  bool external(void) const { return (_owner.get() != NULL); }
+
+  pointer         row(size_type y)                           { return _data + y*_stride; }
+  const_pointer   row(size_type y) const                     { return _data + y*_stride; }
 
   const_reference operator()(size_type x, size_type y) const { return _at(x,y); }
   reference       operator()(size_type x, size_type y)       { return _at(x,y); }
@@ -56,58 +88,96 @@ class buffer2d {
   ///////////////
   // Operators //
   ///////////////
-  buffer2d<T> operator=(const buffer2d<T>& b)        { _assign(b); return *this; }
-
-  buffer2d<T> operator+(const T& s) const            { return operation(std::bind2nd(std::plus<T>(), s)); }
-  buffer2d<T> operator+(const buffer2d<T>& b) const  { return operation(b, std::plus<T>()); }
-  buffer2d<T> operator-(void) const                  { return operation(std::negate<T>()); }
-  buffer2d<T> operator-(const T& s) const            { return operation(std::bind2nd(std::minus<T>(), s)); }
-  buffer2d<T> operator-(const buffer2d<T>& b) const  { return operation(b, std::minus<T>()); }
-  buffer2d<T> operator*(const T& s) const            { return operation(std::bind2nd(std::multiplies<T>(), s)); }
-  buffer2d<T> operator*(const buffer2d<T>& b) const  { return operation(b, std::multiplies<T>()); }
-  buffer2d<T> operator/(const T& s) const            { return operation(std::bind2nd(std::divides<T>(), s)); }
-  buffer2d<T> operator/(const buffer2d<T>& b) const  { return operation(b, std::divides<T>()); }
-
-  template<typename S>
-    buffer2d<T> operator^(const S& s) const            { return operation(std::bind2nd(raises<T,S>(), s)); }
+  buffer2d<T>& operator=(const buffer2d<T>& b)       { _assign(b); return *this; }
+#if __cplusplus >= 201103L
+  buffer2d<T>& operator=(buffer2d<T>&& b)            { if(this != &b) { _deallocate(); _swap(b); } return *this; }
+#endif
 
-  buffer2d<T>& operator+=(const T& s)                { return operation(std::bind2nd(std::plus<T>(), s)); }
+  buffer2d<T>& operator+=(const T& s)                { return operation(buffer2dScalar<std::plus<T>, T>(s)); }
   buffer2d<T>& operator+=(const buffer2d<T>& b)      { return operation(b, std::plus<T>()); }
-  buffer2d<T>& operator-=(const T& s)                { return operation(std::bind2nd(std::minus<T>(), s)); }
+  buffer2d<T>& operator-=(const T& s)                { return operation(buffer2dScalar<std::minus<T>, T>(s)); }
   buffer2d<T>& operator-=(const buffer2d<T>& b)      { return operation(b, std::minus<T>()); }
-  buffer2d<T>& operator*=(const T& s)                { return operation(std::bind2nd(std::multiplies<T>(), s)); }
+  buffer2d<T>& operator*=(const T& s)                { return operation(buffer2dScalar<std::multiplies<T>, T>(s)); }
   buffer2d<T>& operator*=(const buffer2d<T>& b)      { return operation(b, std::multiplies<T>()); }
-  buffer2d<T>& operator/=(const T& s)                { return operation(std::bind2nd(std::divides<T>(), s)); }
+  buffer2d<T>& operator/=(const T& s)                { return operation(buffer2dScalar<std::divides<T>, T>(s)); }
   buffer2d<T>& operator/=(const buffer2d<T>& b)      { return operation(b, std::divides<T>()); }
 
   template<typename S>
-    buffer2d<T>& operator^=(const S& s)                { return operation(std::bind2nd(raises<T,S>(), s)); }
+    buffer2d<T>& operator^=(const S& s)                { return operation(buffer2dScalar<raises<T,S>, T, S>(s)); }
+
+  ////////////////////////////////////////////////
+  // Expressions (see buffer2dExpression.h) are //
+  // evaluated in a single pass on assignment   //
+  ////////////////////////////////////////////////
+  template<typename E>
+    buffer2d<T>& operator=(const buffer2dExpression<E>& e);
+
+  template<typename E>
+    buffer2d<T>& operator+=(const buffer2dExpression<E>& e) { return (*this = *this + e); }
+  template<typename E>
+    buffer2d<T>& operator-=(const buffer2dExpression<E>& e) { return (*this = *this - e); }
+  template<typename E>
+    buffer2d<T>& operator*=(const buffer2dExpression<E>& e) { return (*this = *this * e); }
+  template<typename E>
+    buffer2d<T>& operator/=(const buffer2dExpression<E>& e) { return (*this = *this / e); }
 
   /////////////
   // Methods //
   /////////////
   void resize(size_type newWidth, size_type newHeight);
+  void resize(size_type newWidth, size_type newHeight, const buffer2dLayout& layout);
 
   template<typename S>
     void remap(buffer2d<S>& result);
 
   void clear(const T& s=(T)(0)) { fill(begin(), end(), s); }
-  void Abs(void)                { return operation(absoluteValue<T>()); }
-  T max(void) const             { return *std::max_element(begin(), end()); }
-  T min(void) const             { return *std::min_element(begin(), end()); }
+  buffer2d<T>& Abs(void)        { return operation(absoluteValue<T>()); }
+  T max(void) const;
+  T min(void) const;
+  T sum(void) const;
 
   /////////////
   // Friends //
   /////////////
   friend void swap(buffer2d<T>& a, buffer2d<T>& b)               { a._swap(b); }
-  friend buffer2d<T> pow(const buffer2d<T>& b, const T& s)       { return (b ^ s); }
-  friend buffer2d<T> Abs(const buffer2d<T>& b)                   { return buffer2d<T>(b).Abs(); }
 
-  friend buffer2d<T> operator*(const T& s, const buffer2d<T>& b) { return (b*s); }
+  template<typename S>
+    friend class buffer2d;
+
+#if __cplusplus >= 201103L
+  ////////////////////////////////////////////////
+  // Rvalue overloads: the result reuses the    //
+  // storage of a temporary operand, so that    //
+  // e.g. (a + b) * c allocates only one buffer //
+  ////////////////////////////////////////////////
+  friend buffer2d<T> operator+(buffer2d<T>&& a, const T& s)             { return std::move(a += s); }
+  friend buffer2d<T> operator+(buffer2d<T>&& a, const buffer2d<T>& b)   { return std::move(a += b); }
+  friend buffer2d<T> operator+(const buffer2d<T>& a, buffer2d<T>&& b)   { return std::move(b._reverseOperation(a, std::plus<T>())); }
+  friend buffer2d<T> operator+(buffer2d<T>&& a, buffer2d<T>&& b)        { return std::move(a += b); }
+  friend buffer2d<T> operator-(buffer2d<T>&& a)                         { return std::move(a.operation(std::negate<T>())); }
+  friend buffer2d<T> operator-(buffer2d<T>&& a, const T& s)             { return std::move(a -= s); }
+  friend buffer2d<T> operator-(buffer2d<T>&& a, const buffer2d<T>& b)   { return std::move(a -= b); }
+  friend buffer2d<T> operator-(const buffer2d<T>& a, buffer2d<T>&& b)   { return std::move(b._reverseOperation(a, std::minus<T>())); }
+  friend buffer2d<T> operator-(buffer2d<T>&& a, buffer2d<T>&& b)        { return std::move(a -= b); }
+  friend buffer2d<T> operator*(buffer2d<T>&& a, const T& s)             { return std::move(a *= s); }
+  friend buffer2d<T> operator*(buffer2d<T>&& a, const buffer2d<T>& b)   { return std::move(a *= b); }
+  friend buffer2d<T> operator*(const buffer2d<T>& a, buffer2d<T>&& b)   { return std::move(b._reverseOperation(a, std::multiplies<T>())); }
+  friend buffer2d<T> operator*(buffer2d<T>&& a, buffer2d<T>&& b)        { return std::move(a *= b); }
+  friend buffer2d<T> operator*(const T& s, buffer2d<T>&& b)             { return std::move(b *= s); }
+  friend buffer2d<T> operator/(buffer2d<T>&& a, const T& s)             { return std::move(a /= s); }
+  friend buffer2d<T> operator/(buffer2d<T>&& a, const buffer2d<T>& b)   { return std::move(a /= b); }
+  friend buffer2d<T> operator/(const buffer2d<T>& a, buffer2d<T>&& b)   { return std::move(b._reverseOperation(a, std::divides<T>())); }
+  friend buffer2d<T> operator/(buffer2d<T>&& a, buffer2d<T>&& b)        { return std::move(a /= b); }
+  friend buffer2d<T> pow(buffer2d<T>&& b, const T& s)                   { return std::move(b ^= s); }
+  friend buffer2d<T> Abs(buffer2d<T>&& b)                               { return std::move(b.Abs()); }
+
+  template<typename S>
+    friend buffer2d<T> operator^(buffer2d<T>&& a, const S& s)           { return std::move(a ^= s); }
+#endif
 
   friend std::ostream& operator<<(std::ostream& s, const buffer2d<T>& b)
   {
-    s << "(" << b.width() << ", " << b.height() << ")@" << (void *)(b.begin());
+    s << "(" << b.width() << ", " << b.height() << ")@" << (const void *)(b.row(0));
     return s;
   }
 
@@ -115,34 +185,45 @@ class buffer2d {
   ///////////////////////
   // Protected Methods //
   ///////////////////////
-  void _allocate(size_type width, size_type height, const_iterator init);
+  void _allocate(size_type width, size_type height, const buffer2dLayout& layout, const_pointer init);
   void _deallocate(void);
+  void _copy(const buffer2d<T>& src);
 
   void _checkSize(const buffer2d<T>& b) const { if(width() != b.width() || height() != b.height()) throw buffer2dIllegalSize(); }
 
   template<typename Operation>
-    buffer2d<T> operation(const buffer2d<T>& b, Operation op) const;
+    buffer2d<T>& operation(const buffer2d<T>& b, Operation op);
 
   template<typename Operation>
-    buffer2d<T>& operation(const buffer2d<T>& b, Operation op);
+    buffer2d<T>& operation(Operation op);
+
+  template<typename E>
+    void _evaluate(const E& e);
 
   template<typename Operation>
-    buffer2d<T> operation(Operation op) const;
+    void _evaluate(const buffer2dExpression< buffer2dBinary<buffer2dTerminal<T>, buffer2dTerminal<T>, Operation> >& e);
 
   template<typename Operation>
-    buffer2d<T>& operation(Operation op);
+    void _evaluate(const buffer2dExpression< buffer2dUnary<buffer2dTerminal<T>, Operation> >& e);
+
+  template<typename Operation>
+    buffer2d<T>& _reverseOperation(const buffer2d<T>& a, Operation op);
 
   void _swap(buffer2d<T>& b);
+  void _release(void)                                    { _storage = NULL; _data = NULL; _width = _height = _size = _stride = 0; _owner.reset(); }
   void _assign(const buffer2d<T>& src);
 
-  const_reference _at(size_type x, size_type y) const    { return _data[y*width()+x]; }
-  reference       _at(size_type x, size_type y)          { return _data[y*width()+x]; }
+  const_reference _at(size_type x, size_type y) const    { return _data[y*_stride+x]; }
+  reference       _at(size_type x, size_type y)          { return _data[y*_stride+x]; }
 
   ////////////////////////////
   // Protected Data Members //
   ////////////////////////////
+  void* _storage;
   T* _data;
-  size_type _width, _height, _size;
+  size_type _width, _height, _size, _stride;
+  buffer2dLayout _layout;
+  boost::shared_ptr<void> _owner;     // set for external storage
 };
 
 ////////////////////
@@ -2,8 +2,8 @@
 // Inline Methods for buffer2d.h //
 ///////////////////////////////////
 
+#include <new>
 #include <algorithm>
-#include "copyFrom.h"
 
 using namespace std;
 
@@ -13,13 +13,15 @@ using namespace std;
 //////////////////////////////
 template<typename T>
 template<typename Operation>
-inline buffer2d<T> buffer2d<T>::operation(Operation op) const
+inline buffer2d<T>& buffer2d<T>::operation(Operation op)
 {
-  buffer2d<T> result(width(), height());
-  transform(begin(), end(), result.begin(), op);
+  if(packed()) buffer2dKernel<T>::transform(row(0), row(0), size(), op);
+  else
+    for(size_type y=0; y < height(); y++)
+      buffer2dKernel<T>::transform(row(y), row(y), width(), op);
 
   // done.
-  return result;
+  return *this;
 }
 
 
@@ -28,9 +30,16 @@ inline buffer2d<T> buffer2d<T>::operation(Operation op) const
 //////////////////////////////
 template<typename T>
 template<typename Operation>
-inline buffer2d<T>& buffer2d<T>::operation(Operation op)
+inline buffer2d<T>& buffer2d<T>::operation(const buffer2d<T>& b, Operation op)
 {
-  transform(begin(), end(), begin(), op);
+  // sanity check
+  _checkSize(b);
+
+  // create result
+  if(packed() && b.packed()) buffer2dKernel<T>::transform(row(0), b.row(0), row(0), size(), op);
+  else
+    for(size_type y=0; y < height(); y++)
+      buffer2dKernel<T>::transform(row(y), b.row(y), row(y), width(), op);
 
   // done.
   return *this;
@@ -38,53 +47,192 @@ inline buffer2d<T>& buffer2d<T>::operation(Operation op)
 
 
 //////////////////////////////
-// operation                //
+// _reverseOperation        //
+//                          //
+// this = op(a, this), i.e. //
+// with 'a' as left operand //
 //////////////////////////////
 template<typename T>
 template<typename Operation>
-inline buffer2d<T> buffer2d<T>::operation(const buffer2d<T>& b, Operation op) const
+inline buffer2d<T>& buffer2d<T>::_reverseOperation(const buffer2d<T>& a, Operation op)
 {
   // sanity check
-  _checkSize(b);
+  _checkSize(a);
 
-  // create result
-  buffer2d<T> result(width(), height());
-  transform(begin(), end(), b.begin(), result.begin(), op);
+  // compute in place
+  if(packed() && a.packed()) buffer2dKernel<T>::transform(a.row(0), row(0), row(0), size(), op);
+  else
+    for(size_type y=0; y < height(); y++)
+      buffer2dKernel<T>::transform(a.row(y), row(y), row(y), width(), op);
 
   // done.
-  return result;
+  return *this;
 }
 
 
 //////////////////////////////
-// operation                //
+// operator= (expression)   //
+//                          //
+// Element-wise evaluation  //
+// may alias this buffer;   //
+// the size only differs if //
+// it does not.             //
 //////////////////////////////
 template<typename T>
-template<typename Operation>
-inline buffer2d<T>& buffer2d<T>::operation(const buffer2d<T>& b, Operation op)
+  template<typename E>
+inline buffer2d<T>& buffer2d<T>::operator=(const buffer2dExpression<E>& e)
 {
-  // sanity check
-  _checkSize(b);
-
-  // create result
-  transform(begin(), end(), b.begin(), begin(), op);
+  if(width() != e.width() || height() != e.height())
+  {
+    buffer2d<T> temp(e.width(), e.height(), layout());
+    temp._evaluate(e);
+    _swap(temp);
+  }
+  else _evaluate(e);
 
   // done.
   return *this;
 }
 
 
+//////////////////////////////
+// _evaluate                //
+//////////////////////////////
+template<typename T>
+  template<typename E>
+inline void buffer2d<T>::_evaluate(const E& e)
+{
+  for(size_type y=0; y < height(); y++)
+  {
+    T* dst = row(y);
+    for(size_type x=0; x < width(); x++)
+      dst[x] = e(x,y);
+  }
+
+  // done.
+}
+
+
+//////////////////////////////
+// _evaluate                //
+//                          //
+// Single operation on two  //
+// buffers: use the kernel  //
+//////////////////////////////
+template<typename T>
+  template<typename Operation>
+inline void buffer2d<T>::_evaluate(const buffer2dExpression< buffer2dBinary<buffer2dTerminal<T>, buffer2dTerminal<T>, Operation> >& e)
+{
+  const buffer2dBinary<buffer2dTerminal<T>, buffer2dTerminal<T>, Operation>& node = e.expression();
+  const buffer2d<T>& a = node.left().buffer();
+  const buffer2d<T>& b = node.right().buffer();
+
+  if(packed() && a.packed() && b.packed()) buffer2dKernel<T>::transform(a.row(0), b.row(0), row(0), size(), node.functor());
+  else
+    for(size_type y=0; y < height(); y++)
+      buffer2dKernel<T>::transform(a.row(y), b.row(y), row(y), width(), node.functor());
+}
+
+
+//////////////////////////////
+// _evaluate                //
+//                          //
+// Single operation on one  //
+// buffer: use the kernel   //
+//////////////////////////////
+template<typename T>
+  template<typename Operation>
+inline void buffer2d<T>::_evaluate(const buffer2dExpression< buffer2dUnary<buffer2dTerminal<T>, Operation> >& e)
+{
+  const buffer2dUnary<buffer2dTerminal<T>, Operation>& node = e.expression();
+  const buffer2d<T>& a = node.operand().buffer();
+
+  if(packed() && a.packed()) buffer2dKernel<T>::transform(a.row(0), row(0), size(), node.functor());
+  else
+    for(size_type y=0; y < height(); y++)
+      buffer2dKernel<T>::transform(a.row(y), row(y), width(), node.functor());
+}
+
+
+//////////////////////////////
+// max                      //
+//////////////////////////////
+template<typename T>
+inline T buffer2d<T>::max(void) const
+{
+  if(packed()) return *buffer2dKernel<T>::maxElement(row(0), size());
+
+  // per row; keep the first maximum
+  const T* result = buffer2dKernel<T>::maxElement(row(0), width());
+  for(size_type y=1; y < height(); y++)
+  {
+    const T* candidate = buffer2dKernel<T>::maxElement(row(y), width());
+    if(*result < *candidate) result = candidate;
+  }
+
+  // done.
+  return *result;
+}
+
+
+//////////////////////////////
+// min                      //
+//////////////////////////////
+template<typename T>
+inline T buffer2d<T>::min(void) const
+{
+  if(packed()) return *buffer2dKernel<T>::minElement(row(0), size());
+
+  // per row; keep the first minimum
+  const T* result = buffer2dKernel<T>::minElement(row(0), width());
+  for(size_type y=1; y < height(); y++)
+  {
+    const T* candidate = buffer2dKernel<T>::minElement(row(y), width());
+    if(*candidate < *result) result = candidate;
+  }
+
+  // done.
+  return *result;
+}
+
+
+//////////////////////////////
+// sum                      //
+//////////////////////////////
+template<typename T>
+inline T buffer2d<T>::sum(void) const
+{
+  if(packed()) return buffer2dKernel<T>::sum(row(0), size());
+
+  T result = (T)(0);
+  for(size_type y=0; y < height(); y++)
+    result += buffer2dKernel<T>::sum(row(y), width());
+
+  // done.
+  return result;
+}
+
+
 //////////////////////////////
 // resize                   //
 //                          //
 // Resizes the buffer. The  //
 // content of the current   //
-// buffer is lost!          //
+// buffer is lost!  The     //
+// layout is preserved      //
+// unless specified.        //
 //////////////////////////////
 template<typename T>
 inline void buffer2d<T>::resize(buffer2d<T>::size_type newWidth, buffer2d<T>::size_type newHeight)
 {
-  buffer2d<T> temp(newWidth, newHeight);
+  resize(newWidth, newHeight, layout());
+}
+
+
+template<typename T>
+inline void buffer2d<T>::resize(buffer2d<T>::size_type newWidth, buffer2d<T>::size_type newHeight, const buffer2dLayout& newLayout)
+{
+  buffer2d<T> temp(newWidth, newHeight, newLayout);
   swap(temp, *this);
 }
 
@@ -96,23 +244,25 @@ inline void buffer2d<T>::resize(buffer2d<T>::size_type newWidth, buffer2d<T>::si
 // buffer to a new base type//
 // The content of this is   //
 // destroyed.  The width    //
-// of the result is adjusted//
-// by sizeof(T) / sizeof(S) //
+// (and stride) of the      //
+// result is adjusted by    //
+// sizeof(T) / sizeof(S)    //
 //////////////////////////////
 template<typename T>
   template<typename S>
 inline void buffer2d<T>::remap(buffer2d<S>& result)
 {
   result._deallocate();
-  result._data = static_cast<S*>(_data);            
-  result._width = _width * sizeof(T) / sizeof(S);   
-  result._height = _height;                         
+  result._storage = _storage;
+  result._data = reinterpret_cast<S*>(_data);
+  result._width = _width * sizeof(T) / sizeof(S);
+  result._height = _height;
   result._size = result._width * result._height;
+  result._stride = _stride * sizeof(T) / sizeof(S);
+  result._layout = _layout;
+  result._owner = _owner;
 
-  _data = NULL;
-  _width = 0;
-  _height = 0;
-  _size = 0;
+  _release();
 
   // Done.
 }
@@ -120,16 +270,24 @@ inline void buffer2d<T>::remap(buffer2d<S>& result)
 
 //////////////////////////////
 // allocate                 //
+//                          //
+// Rows are 'stride' apart; //
+// the first element (and   //
+// thus every row) is       //
+// aligned as requested by  //
+// the layout.              //
 //////////////////////////////
 template<typename T>
-inline void buffer2d<T>::_allocate(buffer2d<T>::size_type width, buffer2d<T>::size_type height, buffer2d<T>::const_iterator init)
+inline void buffer2d<T>::_allocate(buffer2d<T>::size_type width, buffer2d<T>::size_type height, const buffer2dLayout& layout, buffer2d<T>::const_pointer init)
 {
+  _layout = layout;
   _size = width * height;
 
   // sanity check: special care if height or width == 0
   if(_size == 0)
   {
-    _width = _height = 0;
+    _width = _height = _stride = 0;
+    _storage = NULL;
     _data = NULL;
   }
   else
@@ -137,10 +295,24 @@ inline void buffer2d<T>::_allocate(buffer2d<T>::size_type width, buffer2d<T>::si
     // allocate
     _width = width;
     _height = height;
-    _data = new T[_size];
+    _stride = layout.template stride<T>(width);
+
+    size_t alignment = layout.alignment();
+    size_t bytes = _stride * _height * sizeof(T) + ((alignment > 1) ? alignment : 0);
+    _storage = ::operator new(bytes);
+
+    size_t address = reinterpret_cast<size_t>(_storage);
+    if(alignment > 1) address = (address + alignment - 1) & ~(alignment - 1);
+    _data = reinterpret_cast<T*>(address);
 
-    // copy data if requested
-    if(init) copyFrom(init, begin(), end());
+    // construct elements (including the padding)
+    for(size_type i=0; i < _stride * _height; i++)
+      new (_data + i) T;
+
+    // copy data if requested (packed)
+    if(init)
+      for(size_type y=0; y < _height; y++)
+        std::copy(init + y*_width, init + (y+1)*_width, row(y));
   }
 
   // done.
@@ -154,18 +326,36 @@ template<typename T>
 inline void buffer2d<T>::_deallocate(void)
 {
   // deallocate if allocated
-  if(_data) delete[] _data;
-  
+  if(_storage)
+  {
+    for(size_type i=0; i < _stride * _height; i++)
+      _data[i].~T();
+    ::operator delete(_storage);
+  }
+
   // reset
-  _data = NULL;
-  _width = 0;
-  _height = 0;
-  _size = 0;
+  _release();
 
   // done.
 }
 
 
+//////////////////////////////
+// _copy                    //
+//                          //
+// Copy the content of an   //
+// equally sized buffer     //
+//////////////////////////////
+template<typename T>
+inline void buffer2d<T>::_copy(const buffer2d<T>& src)
+{
+  if(packed() && src.packed()) std::copy(src.row(0), src.row(0) + size(), row(0));
+  else
+    for(size_type y=0; y < height(); y++)
+      std::copy(src.row(y), src.row(y) + width(), row(y));
+}
+
+
 //////////////////////////////
 // _swap                    //
 //////////////////////////////
@@ -175,12 +365,20 @@ inline void buffer2d<T>::_swap(buffer2d<T>& b)
   swap(_width, b._width);
   swap(_height, b._height);
   swap(_size, b._size);
+  swap(_stride, b._stride);
+  swap(_layout, b._layout);
+  swap(_storage, b._storage);
   swap(_data, b._data);
+  swap(_owner, b._owner);
 }
 
 
 //////////////////////////////
 // _assign                  //
+//                          //
+// The destination keeps    //
+// its layout; storage is   //
+// reused if sizes match.   //
 //////////////////////////////
 template<typename T>
 inline void buffer2d<T>::_assign(const buffer2d<T>& src)
@@ -189,10 +387,12 @@ inline void buffer2d<T>::_assign(const buffer2d<T>& src)
   if(this == & src) return;
 
   // copy
-  buffer2d<T> temp(src);
-  _swap(temp);
+  if(width() != src.width() || height() != src.height())
+  {
+    buffer2d<T> temp(src.width(), src.height(), layout());
+    _swap(temp);
+  }
+  _copy(src);
 
   // done.
 }
-
-
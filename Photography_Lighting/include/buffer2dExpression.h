@@ -0,0 +1,244 @@
+#ifndef _BUFFER2DEXPRESSION_H_
+#define _BUFFER2DEXPRESSION_H_
+
+#include <cstddef>
+#include <functional>
+#include <boost/utility/enable_if.hpp>
+
+#include "raises.h"
+#include "absoluteValue.h"
+#include "exceptions.h"
+#include "buffer2dKernel.h"
+
+//////////////////////////////////////////////////////////
+// Expression templates for element-wise buffer2d       //
+// arithmetic.  Operators on buffers build a lightweight//
+// expression tree; nothing is computed until the tree  //
+// is assigned to a buffer2d, which evaluates the whole //
+// expression in a single loop without temporaries.     //
+// Operand sizes are validated when the tree is built.  //
+//////////////////////////////////////////////////////////
+
+template<typename T>
+class buffer2d;
+
+template<typename E>
+class buffer2dExpression;
+
+
+/////////////////////////////////
+// Leaf: reference to a buffer //
+/////////////////////////////////
+template<typename T>
+class buffer2dTerminal {
+ public:
+  typedef T       value_type;
+  typedef size_t  size_type;
+
+  buffer2dTerminal(const buffer2d<T>& b) : _b(b) {}
+
+  size_type width(void) const  { return _b.width(); }
+  size_type height(void) const { return _b.height(); }
+
+  const value_type& operator()(size_type x, size_type y) const { return _b(x,y); }
+  const buffer2d<T>& buffer(void) const                        { return _b; }
+
+ private:
+  const buffer2d<T>& _b;
+};
+
+
+/////////////////////////////////////
+// Node: unary (or scalar) functor //
+/////////////////////////////////////
+template<typename E, typename Op>
+class buffer2dUnary {
+ public:
+  typedef typename E::value_type  value_type;
+  typedef size_t                  size_type;
+
+  buffer2dUnary(const E& e, const Op& op) : _e(e), _op(op) {}
+
+  size_type width(void) const  { return _e.width(); }
+  size_type height(void) const { return _e.height(); }
+
+  value_type operator()(size_type x, size_type y) const { return _op(_e(x,y)); }
+  const E& operand(void) const                          { return _e; }
+  const Op& functor(void) const                         { return _op; }
+
+ private:
+  E _e;
+  Op _op;
+};
+
+
+/////////////////////////
+// Node: binary functor //
+/////////////////////////
+template<typename L, typename R, typename Op>
+class buffer2dBinary {
+ public:
+  typedef typename L::value_type  value_type;
+  typedef size_t                  size_type;
+
+  buffer2dBinary(const L& l, const R& r, const Op& op) : _l(l), _r(r), _op(op)
+  {
+    // sanity check
+    if(l.width() != r.width() || l.height() != r.height()) throw buffer2dIllegalSize();
+  }
+
+  size_type width(void) const  { return _l.width(); }
+  size_type height(void) const { return _l.height(); }
+
+  value_type operator()(size_type x, size_type y) const { return _op(_l(x,y), _r(x,y)); }
+  const L& left(void) const                             { return _l; }
+  const R& right(void) const                            { return _r; }
+  const Op& functor(void) const                         { return _op; }
+
+ private:
+  L _l;
+  R _r;
+  Op _op;
+};
+
+
+/////////////////////////////////////////
+// Wrapper that marks a tree as a      //
+// buffer2d expression (for overloads) //
+/////////////////////////////////////////
+template<typename E>
+class buffer2dExpression {
+ public:
+  typedef typename E::value_type  value_type;
+  typedef size_t                  size_type;
+
+  explicit buffer2dExpression(const E& e) : _e(e) {}
+
+  size_type width(void) const  { return _e.width(); }
+  size_type height(void) const { return _e.height(); }
+
+  value_type operator()(size_type x, size_type y) const { return _e(x,y); }
+  const E& expression(void) const                       { return _e; }
+
+ private:
+  E _e;
+};
+
+
+///////////////////////////////////////////////////
+// Operand traits: buffers become terminals,     //
+// expressions are used as is.  Other types have //
+// no 'value_type' and are rejected by SFINAE.   //
+///////////////////////////////////////////////////
+template<typename X>
+struct buffer2dOperand {
+  static const bool value = false;
+};
+
+template<typename T>
+struct buffer2dOperand< buffer2d<T> > {
+  static const bool value = true;
+  typedef T                    value_type;
+  typedef buffer2dTerminal<T>  type;
+  static type wrap(const buffer2d<T>& b) { return type(b); }
+};
+
+template<typename E>
+struct buffer2dOperand< buffer2dExpression<E> > {
+  static const bool value = true;
+  typedef typename E::value_type  value_type;
+  typedef buffer2dExpression<E>   type;
+  static const type& wrap(const type& e) { return e; }
+};
+
+
+template<typename X, typename Op>
+struct buffer2dUnaryResult {
+  typedef buffer2dExpression< buffer2dUnary<typename buffer2dOperand<X>::type, Op> > type;
+  static type make(const X& x, const Op& op) { return type(buffer2dUnary<typename buffer2dOperand<X>::type, Op>(buffer2dOperand<X>::wrap(x), op)); }
+};
+
+template<typename L, typename R, template<typename> class Op>
+struct buffer2dBinaryResult {
+  typedef Op<typename buffer2dOperand<L>::value_type>  op_type;
+  typedef buffer2dExpression< buffer2dBinary<typename buffer2dOperand<L>::type, typename buffer2dOperand<R>::type, op_type> > type;
+  static type make(const L& l, const R& r) { return type(buffer2dBinary<typename buffer2dOperand<L>::type, typename buffer2dOperand<R>::type, op_type>(buffer2dOperand<L>::wrap(l), buffer2dOperand<R>::wrap(r), op_type())); }
+};
+
+
+///////////////////////////////////////////
+// Operators (buffer or expression with  //
+// buffer, expression or scalar)         //
+///////////////////////////////////////////
+template<typename L, typename R>
+  typename boost::lazy_enable_if_c<buffer2dOperand<L>::value && buffer2dOperand<R>::value, buffer2dBinaryResult<L, R, std::plus> >::type
+  operator+(const L& l, const R& r) { return buffer2dBinaryResult<L, R, std::plus>::make(l, r); }
+template<typename L, typename R>
+  typename boost::lazy_enable_if_c<buffer2dOperand<L>::value && buffer2dOperand<R>::value, buffer2dBinaryResult<L, R, std::minus> >::type
+  operator-(const L& l, const R& r) { return buffer2dBinaryResult<L, R, std::minus>::make(l, r); }
+template<typename L, typename R>
+  typename boost::lazy_enable_if_c<buffer2dOperand<L>::value && buffer2dOperand<R>::value, buffer2dBinaryResult<L, R, std::multiplies> >::type
+  operator*(const L& l, const R& r) { return buffer2dBinaryResult<L, R, std::multiplies>::make(l, r); }
+template<typename L, typename R>
+  typename boost::lazy_enable_if_c<buffer2dOperand<L>::value && buffer2dOperand<R>::value, buffer2dBinaryResult<L, R, std::divides> >::type
+  operator/(const L& l, const R& r) { return buffer2dBinaryResult<L, R, std::divides>::make(l, r); }
+
+template<typename X>
+  typename buffer2dUnaryResult<X, buffer2dScalar<std::plus<typename buffer2dOperand<X>::value_type>, typename buffer2dOperand<X>::value_type> >::type
+  operator+(const X& x, const typename buffer2dOperand<X>::value_type& s)        { return buffer2dUnaryResult<X, buffer2dScalar<std::plus<typename buffer2dOperand<X>::value_type>, typename buffer2dOperand<X>::value_type> >::make(x, buffer2dScalar<std::plus<typename buffer2dOperand<X>::value_type>, typename buffer2dOperand<X>::value_type>(s)); }
+template<typename X>
+  typename buffer2dUnaryResult<X, buffer2dScalar<std::minus<typename buffer2dOperand<X>::value_type>, typename buffer2dOperand<X>::value_type> >::type
+  operator-(const X& x, const typename buffer2dOperand<X>::value_type& s)        { return buffer2dUnaryResult<X, buffer2dScalar<std::minus<typename buffer2dOperand<X>::value_type>, typename buffer2dOperand<X>::value_type> >::make(x, buffer2dScalar<std::minus<typename buffer2dOperand<X>::value_type>, typename buffer2dOperand<X>::value_type>(s)); }
+template<typename X>
+  typename buffer2dUnaryResult<X, buffer2dScalar<std::multiplies<typename buffer2dOperand<X>::value_type>, typename buffer2dOperand<X>::value_type> >::type
+  operator*(const X& x, const typename buffer2dOperand<X>::value_type& s)        { return buffer2dUnaryResult<X, buffer2dScalar<std::multiplies<typename buffer2dOperand<X>::value_type>, typename buffer2dOperand<X>::value_type> >::make(x, buffer2dScalar<std::multiplies<typename buffer2dOperand<X>::value_type>, typename buffer2dOperand<X>::value_type>(s)); }
+template<typename X>
+  typename buffer2dUnaryResult<X, buffer2dScalar<std::divides<typename buffer2dOperand<X>::value_type>, typename buffer2dOperand<X>::value_type> >::type
+  operator/(const X& x, const typename buffer2dOperand<X>::value_type& s)        { return buffer2dUnaryResult<X, buffer2dScalar<std::divides<typename buffer2dOperand<X>::value_type>, typename buffer2dOperand<X>::value_type> >::make(x, buffer2dScalar<std::divides<typename buffer2dOperand<X>::value_type>, typename buffer2dOperand<X>::value_type>(s)); }
+template<typename X>
+  typename buffer2dUnaryResult<X, buffer2dScalarLeft<std::multiplies<typename buffer2dOperand<X>::value_type>, typename buffer2dOperand<X>::value_type> >::type
+  operator*(const typename buffer2dOperand<X>::value_type& s, const X& x)        { return buffer2dUnaryResult<X, buffer2dScalarLeft<std::multiplies<typename buffer2dOperand<X>::value_type>, typename buffer2dOperand<X>::value_type> >::make(x, buffer2dScalarLeft<std::multiplies<typename buffer2dOperand<X>::value_type>, typename buffer2dOperand<X>::value_type>(s)); }
+
+template<typename X>
+  typename buffer2dUnaryResult<X, std::negate<typename buffer2dOperand<X>::value_type> >::type
+  operator-(const X& x)                                                          { return buffer2dUnaryResult<X, std::negate<typename buffer2dOperand<X>::value_type> >::make(x, std::negate<typename buffer2dOperand<X>::value_type>()); }
+
+template<typename X, typename S>
+  typename buffer2dUnaryResult<X, buffer2dScalar<raises<typename buffer2dOperand<X>::value_type, S>, typename buffer2dOperand<X>::value_type, S> >::type
+  operator^(const X& x, const S& s)                                              { return buffer2dUnaryResult<X, buffer2dScalar<raises<typename buffer2dOperand<X>::value_type, S>, typename buffer2dOperand<X>::value_type, S> >::make(x, buffer2dScalar<raises<typename buffer2dOperand<X>::value_type, S>, typename buffer2dOperand<X>::value_type, S>(s)); }
+
+template<typename X>
+  typename buffer2dUnaryResult<X, buffer2dScalar<raises<typename buffer2dOperand<X>::value_type, typename buffer2dOperand<X>::value_type>, typename buffer2dOperand<X>::value_type> >::type
+  pow(const X& x, const typename buffer2dOperand<X>::value_type& s)              { return (x ^ s); }
+
+template<typename X>
+  typename buffer2dUnaryResult<X, absoluteValue<typename buffer2dOperand<X>::value_type> >::type
+  Abs(const X& x)                                                                { return buffer2dUnaryResult<X, absoluteValue<typename buffer2dOperand<X>::value_type> >::make(x, absoluteValue<typename buffer2dOperand<X>::value_type>()); }
+
+#if __cplusplus >= 201103L
+////////////////////////////////////////////////
+// Expression with a temporary buffer: the    //
+// result is evaluated into the storage of    //
+// the temporary (safe, evaluation is purely  //
+// element-wise).  Also resolves the overload //
+// against the buffer2d rvalue operators.     //
+////////////////////////////////////////////////
+template<typename E, typename T>
+  buffer2d<T> operator+(const buffer2dExpression<E>& l, buffer2d<T>&& r) { r = buffer2dBinaryResult<buffer2dExpression<E>, buffer2d<T>, std::plus>::make(l, r); return std::move(r); }
+template<typename E, typename T>
+  buffer2d<T> operator+(buffer2d<T>&& l, const buffer2dExpression<E>& r) { l = buffer2dBinaryResult<buffer2d<T>, buffer2dExpression<E>, std::plus>::make(l, r); return std::move(l); }
+template<typename E, typename T>
+  buffer2d<T> operator-(const buffer2dExpression<E>& l, buffer2d<T>&& r) { r = buffer2dBinaryResult<buffer2dExpression<E>, buffer2d<T>, std::minus>::make(l, r); return std::move(r); }
+template<typename E, typename T>
+  buffer2d<T> operator-(buffer2d<T>&& l, const buffer2dExpression<E>& r) { l = buffer2dBinaryResult<buffer2d<T>, buffer2dExpression<E>, std::minus>::make(l, r); return std::move(l); }
+template<typename E, typename T>
+  buffer2d<T> operator*(const buffer2dExpression<E>& l, buffer2d<T>&& r) { r = buffer2dBinaryResult<buffer2dExpression<E>, buffer2d<T>, std::multiplies>::make(l, r); return std::move(r); }
+template<typename E, typename T>
+  buffer2d<T> operator*(buffer2d<T>&& l, const buffer2dExpression<E>& r) { l = buffer2dBinaryResult<buffer2d<T>, buffer2dExpression<E>, std::multiplies>::make(l, r); return std::move(l); }
+template<typename E, typename T>
+  buffer2d<T> operator/(const buffer2dExpression<E>& l, buffer2d<T>&& r) { r = buffer2dBinaryResult<buffer2dExpression<E>, buffer2d<T>, std::divides>::make(l, r); return std::move(r); }
+template<typename E, typename T>
+  buffer2d<T> operator/(buffer2d<T>&& l, const buffer2dExpression<E>& r) { l = buffer2dBinaryResult<buffer2d<T>, buffer2dExpression<E>, std::divides>::make(l, r); return std::move(l); }
+#endif
+
+#endif /* _BUFFER2DEXPRESSION_H_ */
@@ -3,11 +3,28 @@
 //////////////////////////////////////////////////////
 
 #if !defined(_BUFFER2DIO_EXR_DETAIL_H_) && defined(_BUFFER2DIO_EXR_H_)
-#define _BUFFER2D_EXR_DETAIL_H_
+#define _BUFFER2DIO_EXR_DETAIL_H_
 
+#include <string>
+#include <vector>
+#include <algorithm>
 #include <stdint.h>
+
+#if defined(__unix__) || defined(__APPLE__)
+  #include <unistd.h>
+#endif
+
 #include "half.h"
+#include "IlmThreadPool.h"
+#include "ImfThreading.h"
+#include "ImfCompression.h"
+#include "ImfHeader.h"
+#include "ImfChannelList.h"
+#include "ImfFrameBuffer.h"
+#include "ImfTiledOutputFile.h"
 #include "exceptions.h"
+#include "offset_iterator.h"
+#include "iteratorWrapper.h"
 #include "buffer2dIO.exr.options.h"
 
 namespace io {
@@ -48,9 +65,202 @@ namespace io {
     else throw customException("Unknown EXR pixel type.");
   }
 
+
+  //////////////////////////////////////////////////
+  // Number of threads requested by the options   //
+  // (0: all available cores).  OpenEXR's global  //
+  // thread pool is grown if needed; the returned //
+  // value is the per-file thread count (0 = no   //
+  // threading, i.e., the calling thread only).   //
+  //////////////////////////////////////////////////
+  inline int setupThreads(const ::io::exr::options& opt)
+  {
+    long threads = opt.threads();
+#if defined(_SC_NPROCESSORS_ONLN)
+    if(threads == 0) threads = sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+    if(threads <= 1) return 0;
+
+    if(Imf::globalThreadCount() < threads) Imf::setGlobalThreadCount(threads);
+    return threads;
+  }
+
+
+  //////////////////////////////////////////////////
+  // Scanlines per compressed block (OpenEXR line //
+  // buffer size) for a given compression.        //
+  //////////////////////////////////////////////////
+  inline unsigned int linesPerBlock(const ::io::exr::compression& compressionType)
+  {
+    switch(compressionType)
+    {
+    case ::io::exr::ZIP:
+    case ::io::exr::XR24: return 16;
+    case ::io::exr::PIZ:
+    case ::io::exr::B44:
+    case ::io::exr::B44A: return 32;
+    default: return 1;
+    }
+  }
+
+
+  //////////////////////////////////////////////////
+  // Conversion of a chunk of rows between the    //
+  // buffer and the flat EXR layout, executed on  //
+  // OpenEXR's thread pool such that it overlaps  //
+  // with the (de)compression of the previous or  //
+  // next chunk.                                  //
+  //////////////////////////////////////////////////
+  template<typename Buffer, typename C>
+    class exportChunkTask : public IlmThread::Task {
+  public:
+    exportChunkTask(IlmThread::TaskGroup* group, const Buffer& buf, size_t y0, size_t rows, char* dst, unsigned int channels, const ::io::exr::pixel& pixelType, float pad) : IlmThread::Task(group), _buf(buf), _y0(y0), _rows(rows), _dst(dst), _channels(channels), _pixelType(pixelType), _pad(pad) {}
+
+    void execute(void)
+    {
+      typename Buffer::const_iterator begin = _buf.begin() + _y0 * _buf.width();
+      convertPixelToFlat<typename Buffer::const_iterator, C>(begin, begin + _rows * _buf.width(), (void *)(_dst), _channels, _pixelType, _pad);
+    }
+
+  private:
+    const Buffer& _buf;
+    size_t _y0, _rows;
+    char* _dst;
+    unsigned int _channels;
+    ::io::exr::pixel _pixelType;
+    float _pad;
+  };
+
+
+  template<typename Buffer, typename C>
+    class importChunkTask : public IlmThread::Task {
+  public:
+    // 'src' holds one flat buffer per channel with rows of 'srcPitch' pixels;
+    // the rows starting at (srcX, srcY) are converted into rows [y0, y0+rows) of 'buf'.
+    importChunkTask(IlmThread::TaskGroup* group, Buffer& buf, size_t y0, size_t rows, const std::vector< std::vector<char> >& src, size_t srcPitch, size_t srcX, size_t srcY, const std::vector< ::io::exr::pixel >& pixelTypes, unsigned int channels, float pad) : IlmThread::Task(group), _buf(buf), _y0(y0), _rows(rows), _src(src), _srcPitch(srcPitch), _srcX(srcX), _srcY(srcY), _pixelTypes(pixelTypes), _channels(channels), _pad(pad) {}
+
+    void execute(void)
+    {
+      for(size_t y=0; y < _rows; y++)
+      {
+	typename Buffer::iterator begin = _buf.begin() + (_y0 + y) * _buf.width();
+	typename Buffer::iterator end = begin + _buf.width();
+
+	for(unsigned int c=0; c < _channels; c++)
+	{
+	  offset_iterator<typename Buffer::iterator> itr_begin(begin, c);
+	  offset_iterator<typename Buffer::iterator> itr_end(end, c);
+
+	  // convert
+	  if(c < _src.size())
+	    convertFlatToPixel<offset_iterator<typename Buffer::iterator>, iteratorWrapper<typename C::value_type> >((const void *)(&_src[c][((_srcY + y) * _srcPitch + _srcX) * bytesPerPixel(_pixelTypes[c])]), 1, itr_begin, itr_end, _pixelTypes[c], _pad);
+
+	  // pad
+	  else std::fill(itr_begin, itr_end, _pad);
+	}
+      }
+    }
+
+  private:
+    Buffer& _buf;
+    size_t _y0, _rows;
+    const std::vector< std::vector<char> >& _src;
+    size_t _srcPitch, _srcX, _srcY;
+    const std::vector< ::io::exr::pixel >& _pixelTypes;
+    unsigned int _channels;
+    float _pad;
+  };
+
+
+  //////////////////////////////////////////////////
+  // Channels to import: the names in the options //
+  // or the first 'numChannels' stored channels.  //
+  // Throws if a named channel does not exist.    //
+  //////////////////////////////////////////////////
+  inline void findChannels(const Imf::Header& header, const ::io::exr::options& opt, unsigned int numChannels, std::vector<std::string>& names, std::vector< ::io::exr::pixel >& types)
+  {
+    const Imf::ChannelList& chanList = header.channels();
+    Imf::ChannelList::ConstIterator chanItr = chanList.begin();
+    for(unsigned int c=0; c < numChannels; c++)
+    {
+      if(opt.hasNamedChannels()) names.push_back(opt.channelName(c));
+      else if(chanItr != chanList.end()) names.push_back((chanItr++).name());
+      else break;
+
+      const Imf::Channel* chan = chanList.findChannel(names.back().c_str());
+      if(!chan) throw customException("import EXR: channel '" + names.back() + "' not found.");
+      types.push_back( ::io::exr::pixel(chan->type) );
+    }
+  }
+
+
+  //////////////////////////////////////////////////
+  // Region to import (relative to the top-left   //
+  // of the data window): the region in the       //
+  // options, or the whole image.                 //
+  //////////////////////////////////////////////////
+  inline void getRegion(const ::io::exr::options& opt, size_t width, size_t height, size_t& x, size_t& y, size_t& w, size_t& h)
+  {
+    if(!opt.hasRegion()) { x = 0; y = 0; w = width; h = height; return; }
+
+    x = opt.regionX();  w = opt.regionWidth();
+    y = opt.regionY();  h = opt.regionHeight();
+    if(x + w > width || y + h > height) throw customException("import EXR: region exceeds the image.");
+  }
+
+
+  //////////////////////////////////////////////////
+  // Halve the resolution of a flat float image   //
+  // (box filter; odd rows/columns are dropped,   //
+  // matching OpenEXR's ROUND_DOWN level sizes).  //
+  //////////////////////////////////////////////////
+  inline void halve(std::vector<float>& data, size_t& width, size_t& height, unsigned int channels, bool halveX, bool halveY)
+  {
+    size_t fx = (halveX && width > 1) ? 2 : 1;
+    size_t fy = (halveY && height > 1) ? 2 : 1;
+    size_t newWidth = width / fx, newHeight = height / fy;
+    float scale = 1.0f / (fx * fy);
+
+    std::vector<float> result(newWidth * newHeight * channels, 0.0f);
+    for(size_t y=0; y < newHeight; y++)
+      for(size_t x=0; x < newWidth; x++)
+	for(size_t dy=0; dy < fy; dy++)
+	  for(size_t dx=0; dx < fx; dx++)
+	  {
+	    const float* src = &data[((y*fy + dy) * width + x*fx + dx) * channels];
+	    float* dst = &result[(y * newWidth + x) * channels];
+	    for(unsigned int c=0; c < channels; c++)
+	      dst[c] += scale * src[c];
+	  }
+
+    data.swap(result);
+    width = newWidth;
+    height = newHeight;
+  }
+
+
+  //////////////////////////////////////////////////
+  // Write all tiles of level (lx, ly) from a     //
+  // flat float image of that level's size.       //
+  //////////////////////////////////////////////////
+  inline void writeTiledLevel(Imf::TiledOutputFile& file, const std::vector<float>& data, size_t width, const std::vector<std::string>& names, int lx, int ly)
+  {
+    const Imath::Box2i window = file.dataWindowForLevel(lx, ly);
+    size_t xStride = sizeof(float) * names.size();
+    size_t yStride = width * xStride;
+    char* base = (char *)(const_cast<float*>(&data[0])) - window.min.y * yStride - window.min.x * xStride;
+
+    Imf::FrameBuffer frameBuffer;
+    for(unsigned int c=0; c < names.size(); c++)
+      frameBuffer.insert(names[c].c_str(), Imf::Slice(Imf::FLOAT, base + c * sizeof(float), xStride, yStride));
+
+    file.setFrameBuffer(frameBuffer);
+    file.writeTiles(0, file.numXTiles(lx) - 1, 0, file.numYTiles(ly) - 1, lx, ly);
+  }
+
     }  // end detail namespace
   }    // end exr namespace
 }      // end io namespace
 
-#endif /* _BUFFER2D_EXR_DETAIL_H_ */
+#endif /* _BUFFER2DIO_EXR_DETAIL_H_ */
 
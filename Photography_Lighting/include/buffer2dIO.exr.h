@@ -8,8 +8,11 @@
 #include <vector>
 #include <string>
 #include <cstdlib>
+#include <algorithm>
+#include <boost/scoped_ptr.hpp>
 
 #include "exceptions.h"
+#include "buffer2dIO.util.h"
 #include "buffer2dIO.exr.options.h"
 
 #ifdef INCLUDE_OPENEXR
@@ -25,6 +28,10 @@
 #include "ImfOutputFile.h"
 #include "ImfFrameBuffer.h"
 #include "ImfChannelList.h"
+#include "ImfTestFile.h"
+#include "ImfTileDescription.h"
+#include "ImfTiledInputFile.h"
+#include "ImfTiledOutputFile.h"
 
 #endif /* INCLUDE_OPENEXR */
 
@@ -36,17 +43,93 @@ namespace io {
 #ifndef INCLUDE_OPENEXR
 
     template<typename Buffer, typename C>
-      void _export(const string& filename, const Buffer& buf, float pad=0.0f, const options& opt=options()) { throw unsupportedFormat(); }
+      void _export(const string&, const Buffer&, float = 0.0f, const options& = options()) { throw unsupportedFormat(); }
 
     template<typename Buffer, typename C>
-      void _import(const string& filename, Buffer& buf, float pad=0.0f, const options& opt=options()) { throw unsupportedFormat(); }
+      void _import(const string&, Buffer&, float = 0.0f, const options& = options()) { throw unsupportedFormat(); }
+
+    inline ::io::util::headerInfo _probe(const string&) { throw unsupportedFormat(); }
+
+    class reader : public ::io::util::scanlineReader {
+    public:
+      explicit reader(const string&, const options& = options()) { throw unsupportedFormat(); }
+      void readRow(float*) {}
+    };
+
+    class writer : public ::io::util::scanlineWriter {
+    public:
+      writer(const string&, size_t, size_t, unsigned int, const options& = options()) { throw unsupportedFormat(); }
+      void writeRow(const float*) {}
+      void finish(void) {}
+    };
 
 #else /* INCLUDE_OPENEXR */
 
 
-    ////////////////
-    // Export EXR //
-    ////////////////
+    ///////////////////////////////////////////////
+    // Export tiled EXR                          //
+    //                                           //
+    // Lower resolution levels are computed with //
+    // a 2x2 (mip) or 2x1/1x2 (rip) box filter.  //
+    ///////////////////////////////////////////////
+    template<typename Buffer, typename C>
+      void _exportTiles(const string& filename, const Buffer& buf, float padding, const options& opt, unsigned int numChannels)
+    {
+      // setup EXR file
+      Imf::Header header(buf.width(), buf.height(), 1, Imath::V2f(0,0), 1, Imf::INCREASING_Y, Imf::Compression(opt.compressionType()));
+      header.setTileDescription( Imf::TileDescription(opt.tileWidth(), opt.tileHeight(), Imf::LevelMode(opt.levelMode()), Imf::ROUND_DOWN) );
+
+      std::vector<std::string> names;
+      for(unsigned int c=0; c < numChannels; c++)
+      {
+	names.push_back(opt.channelName(c));
+	header.channels().insert( names.back().c_str(), (Imf::PixelType)(opt.pixelType()) );
+      }
+
+      Imf::TiledOutputFile file(filename.c_str(), header, ::io::exr::detail::setupThreads(opt));
+
+      // level (0, 0); OpenEXR converts the float samples to the stored pixel type
+      size_t width = buf.width(), height = buf.height();
+      std::vector<float> level(width * height * numChannels);
+      ::io::util::convertPixelToFlat<typename Buffer::const_iterator, float*, C>(buf.begin(), buf.end(), &level[0], numChannels, padding);
+
+      // write levels
+      if(opt.levelMode() == RIPMAP_LEVELS)
+      {
+	for(int ly=0; ly < file.numYLevels(); ly++)
+	{
+	  std::vector<float> rip(level);
+	  size_t ripWidth = width, ripHeight = height;
+	  for(int lx=0; lx < file.numXLevels(); lx++)
+	  {
+	    ::io::exr::detail::writeTiledLevel(file, rip, ripWidth, names, lx, ly);
+	    if(lx + 1 < file.numXLevels()) ::io::exr::detail::halve(rip, ripWidth, ripHeight, numChannels, true, false);
+	  }
+
+	  if(ly + 1 < file.numYLevels()) ::io::exr::detail::halve(level, width, height, numChannels, false, true);
+	}
+      }
+
+      else
+      {
+	for(int l=0; l < file.numLevels(); l++)
+	{
+	  ::io::exr::detail::writeTiledLevel(file, level, width, names, l, l);
+	  if(l + 1 < file.numLevels()) ::io::exr::detail::halve(level, width, height, numChannels, true, true);
+	}
+      }
+
+      // done.
+    }
+
+
+    ///////////////////////////////////////////////
+    // Export EXR                                //
+    //                                           //
+    // Rows are converted in chunks of a few     //
+    // line buffers; the next chunk is converted //
+    // while OpenEXR compresses the current one. //
+    ///////////////////////////////////////////////
     template<typename Buffer, typename C>
       void _export(const string& filename, const Buffer& buf, float padding=0.0f, const options& opt=options())
     {
@@ -57,46 +140,203 @@ namespace io {
       const C wrapper(*(buf.begin()));
       unsigned int storedChannels = std::distance( wrapper.begin(), wrapper.end() );
       unsigned int numChannels = (opt.hasNamedChannels()) ? opt.numberOfChannels() : storedChannels;
+      unsigned int bytesPerPixel = ::io::exr::detail::bytesPerPixel(opt.pixelType());
+
+      // tiled file
+      if(opt.isTiled()) { _exportTiles<Buffer, C>(filename, buf, padding, opt, numChannels); return; }
 
       // setup EXR file
       Imf::Header header(buf.width(), buf.height(), 1, Imath::V2f(0,0), 1, Imf::INCREASING_Y, Imf::Compression(opt.compressionType()));
-      Imf::FrameBuffer frameBuffer;
+      for(unsigned int c=0; c < numChannels; c++)
+	header.channels().insert( opt.channelName(c).c_str(), (Imf::PixelType)(opt.pixelType()) );
 
-      // allocate memory
-      tempArray(char, buffer, buf.width() * buf.height() * numChannels * ::io::exr::detail::bytesPerPixel(opt.pixelType()));
+      int threads = ::io::exr::detail::setupThreads(opt);
+      Imf::OutputFile file(filename.c_str(), header, threads);
 
-      // convert
-      ::io::exr::detail::convertPixelToFlat<typename Buffer::const_iterator, C>( buf.begin(), buf.end(), (void *)(&(buffer[0])), numChannels, opt.pixelType(), padding);
+      // allocate memory (two chunks)
+      size_t xStride = bytesPerPixel * numChannels;
+      size_t yStride = buf.width() * xStride;
+      size_t chunkRows = std::min<size_t>(::io::exr::detail::linesPerBlock(opt.compressionType()) * std::max(threads, 1), buf.height());
+      std::vector<char> chunk[2];
+      chunk[0].resize(chunkRows * yStride);
+      chunk[1].resize(chunkRows * yStride);
 
-      // output frameBuffers
-      for(unsigned int c=0; c < numChannels; c++)
+      // convert first chunk
       {
-	// setup header
-	std::string name = opt.channelName(c).c_str();
-	header.channels().insert( name.c_str(), (Imf::PixelType)(opt.pixelType()) );
-
-	// insert in EXR frame buffer
-	frameBuffer.insert( name.c_str(),
-			    Imf::Slice((Imf::PixelType)(opt.pixelType()),                                                // pixel types
-				       &(buffer[c*::io::exr::detail::bytesPerPixel(opt.pixelType())]),                   // ptr to buffer
-				       ::io::exr::detail::bytesPerPixel(opt.pixelType())*numChannels,                    // stride
-				       buf.width() * ::io::exr::detail::bytesPerPixel(opt.pixelType()) * numChannels,    // bytes per scanline
-				       1, 1,
-				       padding) );
+	IlmThread::TaskGroup group;
+	IlmThread::ThreadPool::addGlobalTask(new ::io::exr::detail::exportChunkTask<Buffer, C>(&group, buf, 0, chunkRows, &chunk[0][0], numChannels, opt.pixelType(), padding));
       }
 
-      // write file
-      Imf::OutputFile file(filename.c_str(), header);
-      file.setFrameBuffer(frameBuffer);
-      file.writePixels(buf.height());
+      // write chunks
+      for(size_t y0=0, k=0; y0 < buf.height(); y0 += chunkRows, k = 1 - k)
+      {
+	size_t rows = std::min(chunkRows, buf.height() - y0);
+	size_t nextRows = std::min(chunkRows, buf.height() - y0 - rows);
+
+	IlmThread::TaskGroup group;     // waits for the conversion on destruction
+	if(nextRows != 0) IlmThread::ThreadPool::addGlobalTask(new ::io::exr::detail::exportChunkTask<Buffer, C>(&group, buf, y0 + rows, nextRows, &chunk[1-k][0], numChannels, opt.pixelType(), padding));
+
+	// frame buffer addressed with absolute row coordinates
+	Imf::FrameBuffer frameBuffer;
+	char* base = &chunk[k][0] - y0 * yStride;
+	for(unsigned int c=0; c < numChannels; c++)
+	  frameBuffer.insert( opt.channelName(c).c_str(),
+			      Imf::Slice((Imf::PixelType)(opt.pixelType()),      // pixel types
+					 base + c * bytesPerPixel,               // ptr to buffer
+					 xStride,                                // stride
+					 yStride,                                // bytes per scanline
+					 1, 1,
+					 padding) );
+
+	file.setFrameBuffer(frameBuffer);
+	file.writePixels(rows);
+      }
 
       // done.
     }
 
 
-    ////////////////
-    // Import EXR //
-    ////////////////
+    ///////////////////////////////////////////////
+    // Import EXR                                //
+    //                                           //
+    // Rows are read in chunks (line buffers, or //
+    // rows of tiles); the previous chunk is     //
+    // converted while OpenEXR decompresses the  //
+    // next one.  Only the chunks that intersect //
+    // the requested region are decoded.         //
+    ///////////////////////////////////////////////
+    template<typename Buffer, typename C>
+      void _importScanlines(const string& filename, Buffer& buf, float padding, const options& opt, unsigned int numChannels, unsigned int availableChannels)
+    {
+      if(opt.level() != 0) throw customException("import EXR: levels are only available in tiled files.");
+
+      // open exr and get relevant data
+      int threads = ::io::exr::detail::setupThreads(opt);
+      Imf::InputFile file(filename.c_str(), threads);
+
+      const Imath::Box2i& dataWindow = file.header().dataWindow();
+      size_t width = dataWindow.max.x - dataWindow.min.x + 1;
+      size_t height = dataWindow.max.y - dataWindow.min.y + 1;
+
+      size_t rx, ry, rw, rh;
+      ::io::exr::detail::getRegion(opt, width, height, rx, ry, rw, rh);
+
+      // find channels
+      std::vector<std::string> chanName;
+      std::vector< ::io::exr::pixel > chanType;
+      ::io::exr::detail::findChannels(file.header(), opt, numChannels, chanName, chanType);
+
+      // allocate memory
+      buf.resize(rw, rh);
+
+      // allocate temp storage (two chunks of full rows, one buffer per channel)
+      size_t chunkRows = std::min<size_t>(::io::exr::detail::linesPerBlock(::io::exr::compression(file.header().compression())) * std::max(threads, 1), rh);
+      std::vector< std::vector<char> > chunk[2];
+      for(unsigned int k=0; k < 2; k++)
+	for(unsigned int c=0; c < chanType.size(); c++)
+	  chunk[k].push_back( std::vector<char>(chunkRows * width * ::io::exr::detail::bytesPerPixel(chanType[c])) );
+
+      // read chunks
+      boost::scoped_ptr<IlmThread::TaskGroup> group;      // waits for the pending conversion on destruction
+      for(size_t y0=0, k=0; y0 < rh; y0 += chunkRows, k = 1 - k)
+      {
+	size_t rows = std::min(chunkRows, rh - y0);
+	std::ptrdiff_t firstRow = dataWindow.min.y + (std::ptrdiff_t)(ry + y0);
+
+	// frame buffer addressed with absolute pixel coordinates
+	Imf::FrameBuffer frameBuffer;
+	for(unsigned int c=0; c < chanType.size(); c++)
+	{
+	  std::ptrdiff_t xStride = ::io::exr::detail::bytesPerPixel(chanType[c]);
+	  char* base = &chunk[k][c][0] - firstRow * (std::ptrdiff_t)(width) * xStride - dataWindow.min.x * xStride;
+	  frameBuffer.insert(chanName[c].c_str(), Imf::Slice( Imf::PixelType(chanType[c]), base, xStride, width * xStride, 1, 1, 0.0));
+	}
+
+	file.setFrameBuffer(frameBuffer);
+	file.readPixels(firstRow, firstRow + rows - 1);
+
+	// wait for the conversion of the previous chunk, and convert this one
+	group.reset();
+	group.reset(new IlmThread::TaskGroup());
+	IlmThread::ThreadPool::addGlobalTask(new ::io::exr::detail::importChunkTask<Buffer, C>(group.get(), buf, y0, rows, chunk[k], width, rx, 0, chanType, availableChannels, padding));
+      }
+
+      // Done.
+    }
+
+
+    template<typename Buffer, typename C>
+      void _importTiles(const string& filename, Buffer& buf, float padding, const options& opt, unsigned int numChannels, unsigned int availableChannels)
+    {
+      // open exr and get relevant data
+      int threads = ::io::exr::detail::setupThreads(opt);
+      Imf::TiledInputFile file(filename.c_str(), threads);
+
+      int lx = opt.level(), ly = opt.level();
+      if(!file.isValidLevel(lx, ly)) throw customException("import EXR: requested level is not available.");
+
+      const Imath::Box2i dataWindow = file.dataWindowForLevel(lx, ly);
+      size_t width = dataWindow.max.x - dataWindow.min.x + 1;
+      size_t height = dataWindow.max.y - dataWindow.min.y + 1;
+
+      size_t rx, ry, rw, rh;
+      ::io::exr::detail::getRegion(opt, width, height, rx, ry, rw, rh);
+
+      // find channels
+      std::vector<std::string> chanName;
+      std::vector< ::io::exr::pixel > chanType;
+      ::io::exr::detail::findChannels(file.header(), opt, numChannels, chanName, chanType);
+
+      // allocate memory
+      buf.resize(rw, rh);
+
+      // tiles covering the region
+      size_t tileWidth = file.tileXSize(), tileHeight = file.tileYSize();
+      int tx0 = rx / tileWidth, tx1 = (rx + rw - 1) / tileWidth;
+      int ty0 = ry / tileHeight, ty1 = (ry + rh - 1) / tileHeight;
+      size_t bx = tx0 * tileWidth;
+      size_t bw = std::min((tx1 + 1) * tileWidth, width) - bx;
+
+      // allocate temp storage (two rows of tiles, one buffer per channel)
+      std::vector< std::vector<char> > chunk[2];
+      for(unsigned int k=0; k < 2; k++)
+	for(unsigned int c=0; c < chanType.size(); c++)
+	  chunk[k].push_back( std::vector<char>(tileHeight * bw * ::io::exr::detail::bytesPerPixel(chanType[c])) );
+
+      // read rows of tiles
+      boost::scoped_ptr<IlmThread::TaskGroup> group;      // waits for the pending conversion on destruction
+      for(int ty=ty0, k=0; ty <= ty1; ty++, k = 1 - k)
+      {
+	size_t y0 = ty * tileHeight;
+	std::ptrdiff_t firstRow = dataWindow.min.y + (std::ptrdiff_t)(y0);
+	std::ptrdiff_t firstColumn = dataWindow.min.x + (std::ptrdiff_t)(bx);
+
+	// frame buffer addressed with absolute pixel coordinates
+	Imf::FrameBuffer frameBuffer;
+	for(unsigned int c=0; c < chanType.size(); c++)
+	{
+	  std::ptrdiff_t xStride = ::io::exr::detail::bytesPerPixel(chanType[c]);
+	  char* base = &chunk[k][c][0] - firstRow * (std::ptrdiff_t)(bw) * xStride - firstColumn * xStride;
+	  frameBuffer.insert(chanName[c].c_str(), Imf::Slice( Imf::PixelType(chanType[c]), base, xStride, bw * xStride, 1, 1, 0.0));
+	}
+
+	file.setFrameBuffer(frameBuffer);
+	file.readTiles(tx0, tx1, ty, ty, lx, ly);
+
+	// rows of the region in this row of tiles
+	size_t first = std::max(ry, y0);
+	size_t last = std::min(ry + rh, y0 + tileHeight);
+
+	// wait for the conversion of the previous chunk, and convert this one
+	group.reset();
+	group.reset(new IlmThread::TaskGroup());
+	IlmThread::ThreadPool::addGlobalTask(new ::io::exr::detail::importChunkTask<Buffer, C>(group.get(), buf, first - ry, last - first, chunk[k], bw, rx - bx, first - y0, chanType, availableChannels, padding));
+      }
+
+      // Done.
+    }
+
+
     template<typename Buffer, typename C>
       void _import(const string& filename, Buffer& buf, float padding=0.0f, const options& opt=options())
     {
@@ -110,71 +350,125 @@ namespace io {
 	numChannels = opt.numberOfChannels();
       }
 
-      // open exr and get relevant data
-      Imf::InputFile file(filename.c_str());
+      // read scanline or tiled file
+      if(Imf::isTiledOpenExrFile(filename.c_str())) _importTiles<Buffer, C>(filename, buf, padding, opt, numChannels, availableChannels);
+      else _importScanlines<Buffer, C>(filename, buf, padding, opt, numChannels, availableChannels);
 
+      // Done.
+    }
+
+
+    ///////////////////////////////////////
+    // Probe the header only.  The bit   //
+    // depth is that of the widest       //
+    // channel.                          //
+    ///////////////////////////////////////
+    inline ::io::util::headerInfo _probe(const string& filename)
+    {
+      Imf::InputFile file(filename.c_str());
       const Imath::Box2i& dataWindow = file.header().dataWindow();
       const Imf::ChannelList& chanList = file.header().channels();
 
-      unsigned long width = dataWindow.max.x - dataWindow.min.x + 1;
-      unsigned long height = dataWindow.max.y - dataWindow.min.y + 1;
-      unsigned int storedChannels = 0;
-      for(Imf::ChannelList::ConstIterator i = chanList.begin(); i != chanList.end(); i++) storedChannels++;
+      ::io::util::headerInfo result(dataWindow.max.x - dataWindow.min.x + 1, dataWindow.max.y - dataWindow.min.y + 1, 0, 0, false);
+      for(Imf::ChannelList::ConstIterator i = chanList.begin(); i != chanList.end(); i++, result.channels++)
+      {
+	unsigned int bitDepth = (i.channel().type == Imf::HALF) ? 16 : 32;
+	if(bitDepth > result.bitDepth) result.bitDepth = bitDepth;
+	if(i.channel().type != Imf::UINT) result.floatingPoint = true;
+      }
 
-      // allocate memory
-      buf.resize(width, height);
+      // Done.
+      return result;
+    }
 
-      // setup frame buffers
-      Imf::FrameBuffer frameBuffer;
-      std::vector< buffer2d<unsigned char> > tempBuffer;     tempBuffer.reserve(numChannels);       // avoid copying of buffers
-      std::vector< ::io::exr::pixel > tempBufferType;
 
-      std::string chanName;
-      Imf::ChannelList::ConstIterator chanItr = chanList.begin();
-      for(unsigned int c=0; c < numChannels; c++, chanItr++)
+    /////////////////////////////////////
+    // Scanline reader (backend of     //
+    // io::scanline_reader).  Reads    //
+    // the channels named in 'opt'.    //
+    /////////////////////////////////////
+    class reader : public ::io::util::scanlineReader {
+    public:
+      explicit reader(const string& filename, const options& opt=options()) : _file(new Imf::InputFile(filename.c_str(), ::io::exr::detail::setupThreads(opt))), _y(0)
+      {
+	const Imath::Box2i& dataWindow = _file->header().dataWindow();
+	const Imf::ChannelList& chanList = _file->header().channels();
+
+	_width = dataWindow.max.x - dataWindow.min.x + 1;
+	_height = dataWindow.max.y - dataWindow.min.y + 1;
+	_minY = dataWindow.min.y;
+
+	// channel names: from the options, or all stored channels
+	std::vector<std::string> names;
+	if(opt.hasNamedChannels())
+	  for(unsigned int c=0; c < opt.numberOfChannels(); c++) names.push_back(opt.channelName(c));
+	else
+	  for(Imf::ChannelList::ConstIterator i = chanList.begin(); i != chanList.end(); i++) names.push_back(i.name());
+
+	_channels = names.size();
+	_row.resize(_width * _channels);
+
+	// a single row buffer (yStride = 0), converted to float by OpenEXR
+	Imf::FrameBuffer frameBuffer;
+	for(unsigned int c=0; c < _channels; c++)
 	{
-	// get name of channel
-	if(!opt.hasNamedChannels()) chanName = chanItr.name();
-	else chanName = opt.channelName(c);
-
-	// Find channel (will throw an exception if not found!)
-	const Imf::Channel& chan = chanList[chanName.c_str()];
-
-	// allocate temp storage buffer
-	tempBufferType.push_back( ::io::exr::pixel(chan.type) );  
-	tempBuffer.push_back( buffer2d<unsigned char>(width * ::io::exr::detail::bytesPerPixel( tempBufferType.back() ), height) );
-
-	// setup frame buffer
-	frameBuffer.insert(chanName.c_str(),
-			   Imf::Slice( chan.type,                                                     // pixel type
-				       (char *)(tempBuffer.back().begin()),                           // ptr to buffer
-				       ::io::exr::detail::bytesPerPixel( tempBufferType.back() ),     // stride
-				       tempBuffer.back().width(),                                     // bytes per scanlinle
-				       1, 1, 
-				       0.0));
+	  chanList[names[c].c_str()];     // throws if the channel does not exist
+	  char* base = (char *)(&_row[c]) - dataWindow.min.x * sizeof(float) * _channels;
+	  frameBuffer.insert(names[c].c_str(), Imf::Slice(Imf::FLOAT, base, sizeof(float) * _channels, 0, 1, 1, 0.0));
+	}
+	_file->setFrameBuffer(frameBuffer);
+      }
 
+      void readRow(float* samples)
+      {
+	_file->readPixels(_minY + _y, _minY + _y);
+	std::copy(_row.begin(), _row.end(), samples);
+	_y++;
       }
 
-      // read file
-      file.setFrameBuffer(frameBuffer);
-      file.readPixels(dataWindow.min.y, dataWindow.max.y);
+    private:
+      boost::scoped_ptr<Imf::InputFile> _file;
+      int _minY, _y;
+      std::vector<float> _row;
+    };
+
 
-      // copy data to buffer (convert or pad if needed)
-      for(unsigned int c=0; c < availableChannels; c++)
+    /////////////////////////////////////
+    // Scanline writer (backend of     //
+    // io::scanline_writer)            //
+    /////////////////////////////////////
+    class writer : public ::io::util::scanlineWriter {
+    public:
+      writer(const string& filename, size_t width, size_t height, unsigned int channels, const options& opt=options()) : ::io::util::scanlineWriter((opt.hasNamedChannels()) ? opt.numberOfChannels() : channels), _row(width * _channels)
       {
-	offset_iterator<typename Buffer::iterator> itr_begin(buf.begin(), c);
-	offset_iterator<typename Buffer::iterator> itr_end(buf.end(), c);
+	Imf::Header header(width, height, 1, Imath::V2f(0,0), 1, Imf::INCREASING_Y, Imf::Compression(opt.compressionType()));
+	Imf::FrameBuffer frameBuffer;
 
-	// convert
-	if(c < numChannels)
-	  ::io::exr::detail::convertFlatToPixel<offset_iterator<typename Buffer::iterator>, iteratorWrapper<typename C::value_type> >(tempBuffer[c].begin(), 1, itr_begin, itr_end, tempBufferType[c], padding);
+	// a single row buffer (yStride = 0); OpenEXR converts to the requested pixel type
+	for(unsigned int c=0; c < _channels; c++)
+	{
+	  std::string name = opt.channelName(c);
+	  header.channels().insert(name.c_str(), Imf::Channel((Imf::PixelType)(opt.pixelType())));
+	  frameBuffer.insert(name.c_str(), Imf::Slice(Imf::FLOAT, (char *)(&_row[c]), sizeof(float) * _channels, 0, 1, 1, 0.0));
+	}
 
-	// pad
-	else std::fill(itr_begin, itr_end, padding);
+	_file.reset(new Imf::OutputFile(filename.c_str(), header, ::io::exr::detail::setupThreads(opt)));
+	_file->setFrameBuffer(frameBuffer);
       }
 
-      // Done.
-    }
+      void writeRow(const float* samples)
+      {
+	std::copy(samples, samples + _row.size(), _row.begin());
+	_file->writePixels(1);
+      }
+
+      void finish(void) { _file.reset(); }
+
+    private:
+      std::vector<float> _row;
+      boost::scoped_ptr<Imf::OutputFile> _file;
+    };
+
 #endif /* INCLUDE_OPENEXR */
 
 
@@ -23,12 +23,18 @@ namespace io {
       FLOAT = 2
     };
 
+    enum level_mode {
+      ONE_LEVEL = 0,
+      MIPMAP_LEVELS = 1,
+      RIPMAP_LEVELS = 2
+    };
+
     struct options {
     public:
       /////////////////////////
       // Default Constructor //
       /////////////////////////
-      options(const compression& compressionType=ZIP, const pixel& pixelType=FLOAT) : _compressionType(compressionType), _pixelType(pixelType)
+      options(const compression& compressionType=ZIP, const pixel& pixelType=FLOAT, unsigned int threads=0) : _compressionType(compressionType), _pixelType(pixelType), _threads(threads), _tileWidth(0), _tileHeight(0), _levelMode(ONE_LEVEL), _regionX(0), _regionY(0), _regionWidth(0), _regionHeight(0), _level(0)
       {
 	_channelNames.push_back("R");
 	_channelNames.push_back("G");
@@ -38,7 +44,7 @@ namespace io {
       ///////////////////////
       // Named Constructor //
       ///////////////////////
-      options(const std::vector<std::string>& channelNames, const compression& compressionType=ZIP, const pixel& pixelType=FLOAT) : _compressionType(compressionType), _pixelType(pixelType)
+      options(const std::vector<std::string>& channelNames, const compression& compressionType=ZIP, const pixel& pixelType=FLOAT, unsigned int threads=0) : _compressionType(compressionType), _pixelType(pixelType), _threads(threads), _tileWidth(0), _tileHeight(0), _levelMode(ONE_LEVEL), _regionX(0), _regionY(0), _regionWidth(0), _regionHeight(0), _level(0)
       {
 	for(std::vector<std::string>::const_iterator itr=channelNames.begin(); itr != channelNames.end(); ++itr)
 	  _channelNames.push_back(*itr);
@@ -49,6 +55,15 @@ namespace io {
       //////////////////////
       options(const options& src) : _compressionType(src._compressionType),
                                     _pixelType(src._pixelType),
+                                    _threads(src._threads),
+                                    _tileWidth(src._tileWidth),
+                                    _tileHeight(src._tileHeight),
+                                    _levelMode(src._levelMode),
+                                    _regionX(src._regionX),
+                                    _regionY(src._regionY),
+                                    _regionWidth(src._regionWidth),
+                                    _regionHeight(src._regionHeight),
+                                    _level(src._level),
 	                            _channelNames(src._channelNames)
       {
 	// Do nothing
@@ -61,6 +76,47 @@ namespace io {
       unsigned int numberOfChannels(void) const { return _channelNames.size(); }
       compression compressionType(void) const   { return _compressionType; }
       pixel pixelType(void) const               { return _pixelType; }
+      unsigned int threads(void) const          { return _threads; }     // 0: all available cores
+
+      bool isTiled(void) const                  { return _tileWidth != 0; }
+      unsigned int tileWidth(void) const        { return _tileWidth; }
+      unsigned int tileHeight(void) const       { return _tileHeight; }
+      level_mode levelMode(void) const          { return _levelMode; }
+
+      bool hasRegion(void) const                { return _regionWidth != 0; }
+      unsigned long regionX(void) const         { return _regionX; }
+      unsigned long regionY(void) const         { return _regionY; }
+      unsigned long regionWidth(void) const     { return _regionWidth; }
+      unsigned long regionHeight(void) const    { return _regionHeight; }
+      unsigned int level(void) const            { return _level; }
+
+      //////////////
+      // Mutators //
+      //////////////
+
+      // export: write a tiled file (with optional mip/rip levels) instead of scanlines
+      options& setTiles(unsigned int tileWidth, unsigned int tileHeight, const level_mode& levelMode=ONE_LEVEL)
+      {
+	if(tileWidth == 0 || tileHeight == 0) throw customException("EXR options: tile size must be non-zero.");
+	_tileWidth = tileWidth;
+	_tileHeight = tileHeight;
+	_levelMode = levelMode;
+	return *this;
+      }
+
+      // import: only decode the given rectangle (relative to the top-left of the data window)
+      options& setRegion(unsigned long x, unsigned long y, unsigned long width, unsigned long height)
+      {
+	if(width == 0 || height == 0) throw customException("EXR options: region must be non-empty.");
+	_regionX = x;
+	_regionY = y;
+	_regionWidth = width;
+	_regionHeight = height;
+	return *this;
+      }
+
+      // import: read the given mip level (or rip level (level, level)) of a tiled file
+      options& setLevel(unsigned int level)  { _level = level; return *this; }
 
       std::string channelName(unsigned int index) const
       {
@@ -79,6 +135,11 @@ namespace io {
       /////////////////////
       compression _compressionType;
       pixel _pixelType;
+      unsigned int _threads;
+      unsigned int _tileWidth, _tileHeight;
+      level_mode _levelMode;
+      unsigned long _regionX, _regionY, _regionWidth, _regionHeight;
+      unsigned int _level;
       std::vector<std::string> _channelNames;
     };
 
@@ -13,6 +13,7 @@
 #include <string>
 
 #include "buffer2d.h"
+#include "planarImage.h"
 #include "iteratorWrapper.h"
 
 //////////////////
@@ -24,6 +25,7 @@
 #include "buffer2dIO.png.h"
 #include "buffer2dIO.jpg.h"
 #include "buffer2dIO.tif.h"
+#include "buffer2dIO.scanline.h"
 
 using namespace std;
 
@@ -35,7 +37,7 @@ namespace io {
   template<typename T> void exportPFM(const string& filename, const buffer2d<T>& buf, const typename iteratorWrapper<T>::value_type& pad=0)                                               { pfm::_export<buffer2d<T>, iteratorWrapper<const T> >(filename, buf, pad); }
   template<typename T> void exportPPM(const string& filename, const buffer2d<T>& buf, const typename iteratorWrapper<T>::value_type& pad=0, ppm::bit_depth bitDepth=ppm::PPM8BIT)         { ppm::_export<buffer2d<T>, iteratorWrapper<const T> >(filename, buf, bitDepth, pad); }
   template<typename T> void exportEXR(const string& filename, const buffer2d<T>& buf, const typename iteratorWrapper<T>::value_type& pad=0, const exr::options& options=exr::options())   { exr::_export<buffer2d<T>, iteratorWrapper<const T> >(filename, buf, pad, options); }
-  template<typename T> void exportPNG(const string& filename, const buffer2d<T>& buf, const typename iteratorWrapper<T>::value_type& pad=0)                                               { png::_export<buffer2d<T>, iteratorWrapper<const T> >(filename, buf, pad); }
+  template<typename T> void exportPNG(const string& filename, const buffer2d<T>& buf, const typename iteratorWrapper<T>::value_type& pad=0, const png::options& options=png::options())   { png::_export<buffer2d<T>, iteratorWrapper<const T> >(filename, buf, pad, options); }
   template<typename T> void exportJPG(const string& filename, const buffer2d<T>& buf, const typename iteratorWrapper<T>::value_type& pad=0, float compressionQuality=0.95f)               { jpg::_export<buffer2d<T>, iteratorWrapper<const T> >(filename, buf, pad, compressionQuality); }
   template<typename T> void exportTIF(const string& filename, const buffer2d<T>& buf, const typename iteratorWrapper<T>::value_type& pad=0, const tif::options& options=tif::options())   { tif::_export<buffer2d<T>, iteratorWrapper<const T> >(filename, buf, pad, options); }
 
@@ -47,9 +49,29 @@ namespace io {
   template<typename T> void importPPM(const string& filename, buffer2d<T>& result, const typename iteratorWrapper<T>::value_type& pad=0)                                                   { ppm::_import<buffer2d<T>, iteratorWrapper<T> >(filename, result, pad); }
   template<typename T> void importEXR(const string& filename, buffer2d<T>& result, const typename iteratorWrapper<T>::value_type& pad=0, const exr::options& options=exr::options())       { exr::_import<buffer2d<T>, iteratorWrapper<T> >(filename, result, pad, options); }
   template<typename T> void importPNG(const string& filename, buffer2d<T>& result, const typename iteratorWrapper<T>::value_type& pad=0)                                                   { png::_import<buffer2d<T>, iteratorWrapper<T> >(filename, result, pad); }
-  template<typename T> void importJPG(const string& filename, buffer2d<T>& result, const typename iteratorWrapper<T>::value_type& pad=0)                                                   { jpg::_import<buffer2d<T>, iteratorWrapper<T> >(filename, result, pad); }
+  template<typename T> void importJPG(const string& filename, buffer2d<T>& result, const typename iteratorWrapper<T>::value_type& pad=0, jpg::scale s=jpg::FULL_SCALE)                 { jpg::_import<buffer2d<T>, iteratorWrapper<T> >(filename, result, pad, s); }
   template<typename T> void importTIF(const string& filename, buffer2d<T>& result, const typename iteratorWrapper<T>::value_type& pad=0)                                                   { tif::_import<buffer2d<T>, iteratorWrapper<T> >(filename, result, pad); }
 
+
+  ///////////////////////////////////////////////
+  // Planar images: pixels are converted from  //
+  // and to the planes directly (no temporary  //
+  // interleaved image).                       //
+  ///////////////////////////////////////////////
+  template<typename T, unsigned int N> void exportPFM(const string& filename, const planar_image<T,N>& buf, const T& pad=0)                                               { pfm::_export<planar_image<T,N>, planar_pixel<const T,N> >(filename, buf, pad); }
+  template<typename T, unsigned int N> void exportPPM(const string& filename, const planar_image<T,N>& buf, const T& pad=0, ppm::bit_depth bitDepth=ppm::PPM8BIT)         { ppm::_export<planar_image<T,N>, planar_pixel<const T,N> >(filename, buf, bitDepth, pad); }
+  template<typename T, unsigned int N> void exportEXR(const string& filename, const planar_image<T,N>& buf, const T& pad=0, const exr::options& options=exr::options())   { exr::_export<planar_image<T,N>, planar_pixel<const T,N> >(filename, buf, pad, options); }
+  template<typename T, unsigned int N> void exportPNG(const string& filename, const planar_image<T,N>& buf, const T& pad=0, const png::options& options=png::options())   { png::_export<planar_image<T,N>, planar_pixel<const T,N> >(filename, buf, pad, options); }
+  template<typename T, unsigned int N> void exportJPG(const string& filename, const planar_image<T,N>& buf, const T& pad=0, float compressionQuality=0.95f)               { jpg::_export<planar_image<T,N>, planar_pixel<const T,N> >(filename, buf, pad, compressionQuality); }
+  template<typename T, unsigned int N> void exportTIF(const string& filename, const planar_image<T,N>& buf, const T& pad=0, const tif::options& options=tif::options())   { tif::_export<planar_image<T,N>, planar_pixel<const T,N> >(filename, buf, pad, options); }
+
+  template<typename T, unsigned int N> void importPFM(const string& filename, planar_image<T,N>& result, const T& pad=0)                                                   { pfm::_import<planar_image<T,N>, planar_pixel<T,N> >(filename, result, pad); }
+  template<typename T, unsigned int N> void importPPM(const string& filename, planar_image<T,N>& result, const T& pad=0)                                                   { ppm::_import<planar_image<T,N>, planar_pixel<T,N> >(filename, result, pad); }
+  template<typename T, unsigned int N> void importEXR(const string& filename, planar_image<T,N>& result, const T& pad=0, const exr::options& options=exr::options())       { exr::_import<planar_image<T,N>, planar_pixel<T,N> >(filename, result, pad, options); }
+  template<typename T, unsigned int N> void importPNG(const string& filename, planar_image<T,N>& result, const T& pad=0)                                                   { png::_import<planar_image<T,N>, planar_pixel<T,N> >(filename, result, pad); }
+  template<typename T, unsigned int N> void importJPG(const string& filename, planar_image<T,N>& result, const T& pad=0, jpg::scale s=jpg::FULL_SCALE)                 { jpg::_import<planar_image<T,N>, planar_pixel<T,N> >(filename, result, pad, s); }
+  template<typename T, unsigned int N> void importTIF(const string& filename, planar_image<T,N>& result, const T& pad=0)                                                   { tif::_import<planar_image<T,N>, planar_pixel<T,N> >(filename, result, pad); }
+
 } // io namespace
 
 #endif /* _BUFFER2DIO_H_ */
@@ -5,6 +5,8 @@
 #ifndef _BUFFER2DIO_JPG_H_
 #define _BUFFER2DIO_JPG_H_
 
+#include <vector>
+
 #include "buffer2dIO.util.h"
 #include "exceptions.h"
 #include "tempArray.h"
@@ -22,18 +24,53 @@ using namespace std;
 namespace io {
   namespace jpg {
 
+    // decode resolution; libjpeg scales in the DCT domain,
+    // which is much faster than decoding at full resolution
+    // and downsampling afterwards.
+    enum scale {
+      FULL_SCALE = 1,
+      HALF_SCALE = 2,
+      QUARTER_SCALE = 4,
+      EIGHTH_SCALE = 8
+    };
+
 #ifndef INCLUDE_JPEG
 
     template<typename Buffer, typename C>
-      void _export(const string& filename, const Buffer& buf, const typename C::value_type& pad=0, float compressionQuality=0.95f) { throw unsupportedFormat(); }
+      void _export(const string&, const Buffer&, const typename C::value_type& = 0, float = 0.95f) { throw unsupportedFormat(); }
 
     template<typename Buffer, typename C>
-      void _import(const string& filename, Buffer& buf, const typename C::value_type& pad=0) { throw unsupportedFormat(); }
+      void _import(const string&, Buffer&, const typename C::value_type& = 0, scale = FULL_SCALE) { throw unsupportedFormat(); }
+
+    inline ::io::util::headerInfo _probe(const string&) { throw unsupportedFormat(); }
+
+    class reader : public ::io::util::scanlineReader {
+    public:
+      explicit reader(const string&, scale = FULL_SCALE) { throw unsupportedFormat(); }
+      void readRow(float*) {}
+    };
+
+    class writer : public ::io::util::scanlineWriter {
+    public:
+      writer(const string&, size_t, size_t, unsigned int, float = 0.95f) { throw unsupportedFormat(); }
+      void writeRow(const float*) {}
+      void finish(void) {}
+    };
 
 #else /* INCLUDE_JPEG */
 
+    namespace detail {
+      // request a reduced output size (after jpeg_read_header)
+      inline void setScale(struct jpeg_decompress_struct& cinfo, scale s)
+      {
+	cinfo.scale_num = 1;
+	cinfo.scale_denom = s;
+      }
+    } // end detail namespace
+
+
     ////////////////
-    // Export PNG //
+    // Export JPG //
     ////////////////
     template<typename Buffer, typename C>
       void _export(const string& filename, const Buffer& buf, const typename C::value_type& pad=0, float compressionQuality=0.95f)
@@ -92,11 +129,14 @@ namespace io {
       fclose(fp);
     }
 
-    ////////////////
-    // Import PNG //
-    ////////////////
+    ///////////////////////////////////////
+    // Import JPG                        //
+    //                                   //
+    // The image is decoded at 1/s of    //
+    // the full resolution (rounded up). //
+    ///////////////////////////////////////
     template<typename Buffer, typename C>
-      void _import(const string& filename, Buffer& result, const typename C::value_type& pad=0)
+      void _import(const string& filename, Buffer& result, const typename C::value_type& pad=0, scale s=FULL_SCALE)
     {
       // read temp buffer
       FILE *fp = fopen(filename.c_str(), "rb");
@@ -115,21 +155,27 @@ namespace io {
 
       // read parameters & start decompress
       jpeg_read_header(&cinfo, TRUE);
+      detail::setScale(cinfo, s);
       jpeg_start_decompress(&cinfo);   
 
-      // allocate buffer
-      JSAMPARRAY buffer = (*cinfo.mem->alloc_sarray)((j_common_ptr) &cinfo, JPOOL_IMAGE, 3 * cinfo.output_width, 1);
+      // allocate buffer (gray is replicated if the target holds color)
       result.resize(cinfo.output_width, cinfo.output_height);
+      bool expandGray = (cinfo.output_components == 1) && ((C(*result.begin())).size() >= 3);
+      unsigned int channels = expandGray ? 3 : cinfo.output_components;
+      JSAMPARRAY buffer = (*cinfo.mem->alloc_sarray)((j_common_ptr) &cinfo, JPOOL_IMAGE, channels * cinfo.output_width, 1);
 
       // read scanline and convert
       typename Buffer::iterator itr = result.begin();
-  for(unsigned int y=0; y < result.height(); y++, itr += result.width())
+      for(unsigned int y=0; y < result.height(); y++, itr += result.width())
       {
 	// read
 	jpeg_read_scanlines(&cinfo, buffer, 1);
+	if(expandGray)
+	  for(size_t x=result.width(); x-- > 0; )
+	    (*buffer)[3*x] = (*buffer)[3*x+1] = (*buffer)[3*x+2] = (*buffer)[x];
 
         // convert
-        ::io::util::convertFlatToPixel<JSAMPLE*, typename Buffer::iterator, C>(&((*buffer)[0]), 3, itr, itr+result.width(), pad);
+        ::io::util::convertFlatToPixel<JSAMPLE*, typename Buffer::iterator, C>(&((*buffer)[0]), channels, itr, itr+result.width(), pad);
 
 	// next scanline
       }
@@ -142,6 +188,133 @@ namespace io {
       fclose(fp);
     }
 
+
+    ///////////////////////////
+    // Probe the header only //
+    ///////////////////////////
+    inline ::io::util::headerInfo _probe(const string& filename)
+    {
+      FILE *fp = fopen(filename.c_str(), "rb");
+      if(!fp) throw fileNotFound(filename, "reading");
+
+      // read parameters
+      struct jpeg_decompress_struct cinfo;
+      struct jpeg_error_mgr jerr;
+      cinfo.err = jpeg_std_error(&jerr);
+      jpeg_create_decompress(&cinfo);
+      jpeg_stdio_src(&cinfo, fp);
+      jpeg_read_header(&cinfo, TRUE);
+
+      ::io::util::headerInfo result(cinfo.image_width, cinfo.image_height, cinfo.num_components, cinfo.data_precision, false);
+
+      // clean up
+      jpeg_destroy_decompress(&cinfo);
+      fclose(fp);
+
+      // Done.
+      return result;
+    }
+
+
+    /////////////////////////////////////
+    // Scanline reader (backend of     //
+    // io::scanline_reader)            //
+    /////////////////////////////////////
+    class reader : public ::io::util::scanlineReader {
+    public:
+      explicit reader(const string& filename, scale s=FULL_SCALE)
+      {
+	_fp = fopen(filename.c_str(), "rb");
+	if(!_fp) throw fileNotFound(filename, "reading");
+
+	// setup, read parameters & start decompress
+	_cinfo.err = jpeg_std_error(&_jerr);
+	jpeg_create_decompress(&_cinfo);
+	jpeg_stdio_src(&_cinfo, _fp);
+	jpeg_read_header(&_cinfo, TRUE);
+	detail::setScale(_cinfo, s);
+	jpeg_start_decompress(&_cinfo);
+
+	_width = _cinfo.output_width;
+	_height = _cinfo.output_height;
+	_channels = _cinfo.output_components;
+	_row.resize(_width * _channels);
+      }
+
+      ~reader(void)
+      {
+	jpeg_destroy_decompress(&_cinfo);
+	fclose(_fp);
+      }
+
+      void readRow(float* samples)
+      {
+	JSAMPROW rowPointer[1] = {&_row[0]};
+	jpeg_read_scanlines(&_cinfo, rowPointer, 1);
+	::io::util::convertSamples(&_row[0], _row.size(), samples);
+      }
+
+    private:
+      FILE* _fp;
+      struct jpeg_decompress_struct _cinfo;
+      struct jpeg_error_mgr _jerr;
+      std::vector<JSAMPLE> _row;
+    };
+
+
+    /////////////////////////////////////
+    // Scanline writer (backend of     //
+    // io::scanline_writer)            //
+    /////////////////////////////////////
+    class writer : public ::io::util::scanlineWriter {
+    public:
+      writer(const string& filename, size_t width, size_t height, unsigned int channels, float compressionQuality=0.95f) : ::io::util::scanlineWriter((channels == 1) ? 1 : 3), _row(width * _channels)
+      {
+	_fp = fopen(filename.c_str(), "wb");
+	if(!_fp) throw fileNotFound(filename, "writing");
+
+	// setup & set compression parameters
+	_cinfo.err = jpeg_std_error(&_jerr);
+	jpeg_create_compress(&_cinfo);
+	jpeg_stdio_dest(&_cinfo, _fp);
+
+	_cinfo.image_width = width;
+	_cinfo.image_height = height;
+	_cinfo.input_components = _channels;
+	_cinfo.in_color_space = (_channels == 1) ? JCS_GRAYSCALE : JCS_RGB;
+
+	jpeg_set_defaults(&_cinfo);
+	jpeg_set_quality(&_cinfo, compressionQuality*100, true);
+	jpeg_start_compress(&_cinfo, TRUE);
+      }
+
+      ~writer(void)
+      {
+	jpeg_destroy_compress(&_cinfo);
+	if(_fp) fclose(_fp);
+      }
+
+      void writeRow(const float* samples)
+      {
+	::io::util::convertSamples(samples, _row.size(), &_row[0]);
+	JSAMPROW rowPointer[1] = {&_row[0]};
+	jpeg_write_scanlines(&_cinfo, rowPointer, 1);
+      }
+
+      void finish(void)
+      {
+	jpeg_finish_compress(&_cinfo);
+	fclose(_fp);
+	_fp = NULL;
+      }
+
+    private:
+      FILE* _fp;
+      struct jpeg_compress_struct _cinfo;
+      struct jpeg_error_mgr _jerr;
+      std::vector<JSAMPLE> _row;
+    };
+
 #endif /* INCLUDE_JPEG */
 
   } // end png namespace
@@ -6,9 +6,15 @@
 #define _BUFFER2DIO_PFM_H_
 
 #include "Endian.h"
+#include "color.h"
+#include "buffer2d.h"
+#include "mappedFile.h"
 #include "exceptions.h"
 #include "buffer2dIO.util.h"
 #include <cstdio>
+#include <vector>
+#include <algorithm>
+#include <boost/shared_ptr.hpp>
 
 using namespace std;
 
@@ -16,21 +22,102 @@ namespace io {
   namespace pfm {
 
     namespace detail {
-      /////////////////////////////////
-      // Skip Comments in the Header //
-      /////////////////////////////////
-      void skipComment(FILE *fp, char token='#')
+      /////////////////////////////////////////////////////
+      // Let 'result' alias the pixels in a mapped file. //
+      // Only possible if the pixel type matches the     //
+      // file (packed floats) and the data is suitably   //
+      // aligned; returns false otherwise.               //
+      /////////////////////////////////////////////////////
+      template<typename Buffer>
+	bool alias(Buffer&, const boost::shared_ptr<mappedFile>&, size_t, size_t, size_t, unsigned int) { return false; }
+
+      template<typename T>
+	bool aliasAs(buffer2d<T>& result, const boost::shared_ptr<mappedFile>& file, size_t offset, size_t width, size_t height)
+      {
+	char* data = file->data() + offset;
+	if(reinterpret_cast<size_t>(data) % sizeof(float) != 0) return false;
+
+	buffer2d<T> temp(reinterpret_cast<T*>(data), width, height, width, file);
+	swap(temp, result);
+	return true;
+      }
+
+      inline bool alias(buffer2d< color<float> >& result, const boost::shared_ptr<mappedFile>& file, size_t offset, size_t width, size_t height, unsigned int channels)
+      {
+	return (channels == 3) && aliasAs(result, file, offset, width, height);
+      }
+
+      inline bool alias(buffer2d<float>& result, const boost::shared_ptr<mappedFile>& file, size_t offset, size_t width, size_t height, unsigned int channels)
+      {
+	return (channels == 1) && aliasAs(result, file, offset, width, height);
+      }
+
+
+      //////////////////////////////////////
+      // Parse the header of a (mapped)   //
+      // PFM file.  'data' points to the  //
+      // first sample.                    //
+      //////////////////////////////////////
+      struct header {
+	unsigned long width, height;
+	unsigned int channels;
+	bool swapBytes;
+	const char* data;
+      };
+
+      inline header readHeader(const mappedFile& file)
       {
-	int b = fgetc(fp);
+	::io::util::headerReader reader(file.data(), file.data() + file.size());
+
+	// scan header
+	char dummy=0, type=0;     // type is 'f' or 'F'
+	float endianess=0;        // endianess is -1 (LE) or 1 (BE)
+	unsigned long width=0, height=0;
+
+	bool res = reader.readChar(dummy) && (dummy == 'P') && reader.readChar(type) && reader.readChar(dummy);
+	reader.skipComment();
+	res = res && reader.readNumber(width) && reader.readChar(dummy) && reader.readNumber(height) && reader.readChar(dummy);
+	reader.skipComment();
+	res = res && reader.readNumber(endianess) && reader.readChar(dummy);
+
+	// Check if PFM file format
+	if (!res) throw unsupportedFormat(); 
+	if (type != 'f' && type != 'F') throw unsupportedFormat();
+
+	// Determine number of channels
+	header result;
+	result.width = width;
+	result.height = height;
+	result.channels = (type == 'f') ? 1 : 3;
+	result.swapBytes = ((endianess > 0) != endian::isBigEndian());
+
+	// check size
+	result.data = reader.position();
+	size_t bytes;
+	if(!::io::util::imageBytes(width, height, result.channels, sizeof(float), bytes))
+	  throw customException("PFM importer: image dimensions are too large.");
+	if((size_t)(file.data() + file.size() - result.data) < bytes)
+	  throw customException("PFM importer: file is truncated.");
 
-	while(b != EOF && (b == token))
-	{
-	  while (b != EOF && b != '\n' && b != '\r')
-	    b = fgetc(fp);
+	// done.
+	return result;
+      }
+
+
+      //////////////////////////////////////
+      // Write a little endian header.    //
+      // The scale is padded with zeros   //
+      // such that the pixel data is      //
+      // float aligned (see alias).       //
+      //////////////////////////////////////
+      inline void writeHeader(FILE* fp, size_t width, size_t height, unsigned int channels)
+      {
+	char header[64];
+	int length = sprintf(header, "P%c\n%lu %lu\n-1.000000", (channels == 1) ? 'f' : 'F', (unsigned long)(width), (unsigned long)(height));
 
-	  b = fgetc(fp);
-	}
-	ungetc(b, fp);
+	while((length + 1) % sizeof(float) != 0) header[length++] = '0';
+	header[length++] = '\n';
+	fwrite(header, 1, length, fp);
       }
 
     } // namespace detail
@@ -52,66 +139,121 @@ namespace io {
 
       // write temp buffer to file
       FILE *fp = fopen(filename.c_str(), "wb");
-      char dummy='\n';
-      fprintf(fp,"PF%c%lu %lu%c-1.000000%c", dummy, (unsigned long)(buf.width()), (unsigned long)(buf.height()), dummy, dummy);
-      fwrite(temp.begin(), sizeof(dest_type), temp.size(), fp);
+      if(!fp) throw fileNotFound(filename, "writing");
+      detail::writeHeader(fp, buf.width(), buf.height(), 3);
+      fwrite(temp.row(0), sizeof(dest_type), temp.size(), fp);
       fclose(fp);      
 
       // done.
     }
 
 
-  ////////////////
-  // Import PFM //
-  ////////////////
+  /////////////////////////////////////////////
+  // Import PFM                              //
+  //                                         //
+  // The file is memory mapped.  If the      //
+  // pixel layout matches, the result        //
+  // aliases the mapping (copy-on-write);    //
+  // otherwise pixels are converted directly //
+  // from the mapping.                       //
+  /////////////////////////////////////////////
   template<typename Buffer, typename C>
     void _import(const string& filename, Buffer& result, const typename C::value_type& pad=0)
     {
-      // read temp buffer
-      char dummy, type;         // type is 'f' or 'F'
-      float endianess;          // endianess is -1 (LE) or 1 (BE)
-      int width, height;
-      FILE *fp = fopen(filename.c_str(), "rb");
-
-      if(!fp) throw fileNotFound(filename);
-
-      // scan header
-      int res = 0;
-      res += fscanf(fp, "P%c%c", &type, &dummy);
-      detail::skipComment(fp);
-      res += fscanf(fp, "%d%c%d%c", &width, &dummy, &height, &dummy);
-      detail::skipComment(fp);
-      res += fscanf(fp, "%g%c", &endianess, &dummy);
-
-      // Check if PFM file format
-      if (res != 8) throw unsupportedFormat(); 
-      if (type != 'f' && type != 'F') throw unsupportedFormat();
-
-      // Determine number of channels
-      unsigned int channels = (type == 'f') ? 1 : 3;
-      bool bigEndian = (endianess > 0);
-
-      // pixel convertor
-      typedef float   src_type;
-      //      ::io::util::pixelTypeConvertor<src_type, typename C::value_type> convertor;
-      //typename C::value_type cpad = convertor(pad);
-
-      // read buffer
-      buffer2d<src_type> temp(width*channels, height);
-      fread(temp.begin(), sizeof(src_type),  temp.size(), fp);
-      fclose(fp);
-
-      // endian
-      if(bigEndian) endian::big(temp.begin(), temp.end());
-      else endian::little(temp.begin(), temp.end());
+      boost::shared_ptr<mappedFile> file(new mappedFile(filename));
+      detail::header header = detail::readHeader(*file);
+      unsigned long width = header.width, height = header.height;
+      unsigned int channels = header.channels;
+      bool swapBytes = header.swapBytes;
+      const char* data = header.data;
+
+      // alias if possible
+      if(!swapBytes && detail::alias(result, file, data - file->data(), width, height, channels)) return;
 
       // allocate & convert
+      file->sequential();
       result.resize(width, height);
-      ::io::util::convertFlatToPixel<typename buffer2d<src_type>::const_iterator, typename Buffer::iterator, C>(temp.begin(), 3, result.begin(), result.end(), pad);
+      ::io::util::convertFlatToPixel< ::io::util::rawSampleIterator<float>, typename Buffer::iterator, C>(::io::util::rawSampleIterator<float>(data, swapBytes), channels, result.begin(), result.end(), pad);
 
       // done.
     }
 
+
+  ///////////////////////////
+  // Probe the header only //
+  ///////////////////////////
+  inline ::io::util::headerInfo _probe(const string& filename)
+  {
+    mappedFile file(filename);
+    detail::header header = detail::readHeader(file);
+    return ::io::util::headerInfo(header.width, header.height, header.channels, 8 * sizeof(float), true);
+  }
+
+
+  /////////////////////////////////////
+  // Scanline reader (backend of     //
+  // io::scanline_reader)            //
+  /////////////////////////////////////
+  class reader : public ::io::util::scanlineReader {
+  public:
+    explicit reader(const string& filename) : _file(filename)
+    {
+      detail::header header = detail::readHeader(_file);
+      _width = header.width;
+      _height = header.height;
+      _channels = header.channels;
+      _swapBytes = header.swapBytes;
+      _data = header.data;
+      _file.sequential();
+    }
+
+    void readRow(float* samples)
+    {
+      std::size_t count = _width * _channels;
+      ::io::util::convertSamples(::io::util::rawSampleIterator<float>(_data, _swapBytes), count, samples);
+      _data += count * sizeof(float);
+    }
+
+  private:
+    mappedFile _file;
+    bool _swapBytes;
+    const char* _data;
+  };
+
+
+  /////////////////////////////////////
+  // Scanline writer (backend of     //
+  // io::scanline_writer)            //
+  /////////////////////////////////////
+  class writer : public ::io::util::scanlineWriter {
+  public:
+    writer(const string& filename, size_t width, size_t height, unsigned int channels) : ::io::util::scanlineWriter((channels == 1) ? 1 : 3), _row(width * _channels)
+    {
+      _fp = fopen(filename.c_str(), "wb");
+      if(!_fp) throw fileNotFound(filename, "writing");
+      detail::writeHeader(_fp, width, height, _channels);
+    }
+
+    ~writer(void) { if(_fp) fclose(_fp); }
+
+    void writeRow(const float* samples)
+    {
+      std::copy(samples, samples + _row.size(), _row.begin());
+      endian::little(_row.begin(), _row.end());
+      if(fwrite(&_row[0], sizeof(float), _row.size(), _fp) != _row.size()) throw customException("PFM writer: failed to write to file.");
+    }
+
+    void finish(void)
+    {
+      if(_fp && fclose(_fp) != 0) { _fp = NULL; throw customException("PFM writer: failed to close file."); }
+      _fp = NULL;
+    }
+
+  private:
+    FILE* _fp;
+    std::vector<float> _row;
+  };
+
   } // namespace pfm
 }   // namespace io
 
@@ -5,9 +5,14 @@
 #ifndef _BUFFER2DIO_PNG_H_
 #define _BUFFER2DIO_PNG_H_
 
+#include <vector>
+#include <stdint.h>
+
+#include "Endian.h"
 #include "buffer2dIO.util.h"
 #include "exceptions.h"
 #include "tempArray.h"
+#include "buffer2dIO.png.options.h"
 
 #ifdef INCLUDE_PNG
 
@@ -24,18 +29,102 @@ namespace io {
 #ifndef INCLUDE_PNG
 
     template<typename Buffer, typename C>
-      void _export(const string& filename, const Buffer& buf, const typename C::value_type& pad=0) { throw unsupportedFormat(); }
+      void _export(const string&, const Buffer&, const typename C::value_type& = 0, const options& = options()) { throw unsupportedFormat(); }
 
     template<typename Buffer, typename C>
-      void _import(const string& filename, Buffer& buf, const typename C::value_type& pad=0) { throw unsupportedFormat(); }
+      void _import(const string&, Buffer&, const typename C::value_type& = 0) { throw unsupportedFormat(); }
+
+    inline ::io::util::headerInfo _probe(const string&) { throw unsupportedFormat(); }
+
+    class reader : public ::io::util::scanlineReader {
+    public:
+      explicit reader(const string&) { throw unsupportedFormat(); }
+      void readRow(float*) {}
+    };
+
+    class writer : public ::io::util::scanlineWriter {
+    public:
+      writer(const string&, size_t, size_t, unsigned int, const options& = options()) { throw unsupportedFormat(); }
+      void writeRow(const float*) {}
+      void finish(void) {}
+    };
 
 #else /* INCLUDE_PNG */
 
-    ////////////////
-    // Export PNG //
-    ////////////////
+    namespace detail {
+
+      //////////////////////////////////////
+      // Write the header and set the     //
+      // compression options.  16 bit     //
+      // rows are passed in machine order //
+      //////////////////////////////////////
+      inline void writeHeader(png_structp png_ptr, png_infop info_ptr, size_t width, size_t height, unsigned int channels, const options& opt)
+      {
+	png_set_IHDR(png_ptr, info_ptr,
+		     width,                 // width
+		     height,                // height
+		     opt.bitDepth(),        // bitdepth
+		     (channels == 3) ? PNG_COLOR_TYPE_RGB : PNG_COLOR_TYPE_GRAY,
+		     PNG_INTERLACE_NONE,    // interlacing
+		     PNG_COMPRESSION_TYPE_DEFAULT,
+		     PNG_FILTER_TYPE_DEFAULT);
+
+	// compression
+	static const int filters[] = { PNG_ALL_FILTERS, PNG_FILTER_NONE, PNG_FILTER_SUB, PNG_FILTER_UP, PNG_FILTER_AVG, PNG_FILTER_PAETH };
+	png_set_filter(png_ptr, PNG_FILTER_TYPE_BASE, filters[opt.filterType()]);
+	png_set_compression_level(png_ptr, (opt.compressionLevel() < 0) ? Z_DEFAULT_COMPRESSION : opt.compressionLevel());
+	png_set_compression_strategy(png_ptr, opt.strategyType());
+
+	png_write_info(png_ptr, info_ptr);
+	if(opt.bitDepth() == PNG16BIT && !endian::isBigEndian()) png_set_swap(png_ptr);
+      }
+
+
+      //////////////////////////////////////
+      // Input transformations (after     //
+      // png_read_info): palette and low  //
+      // bit depths are expanded, 16 bit  //
+      // samples are returned in machine  //
+      // order.  If 'channels' is given,  //
+      // gray is expanded to RGB when 3   //
+      // or more channels are wanted, and //
+      // alpha is dropped if it does not  //
+      // fit.  Returns true if the image  //
+      // is interlaced.                   //
+      //////////////////////////////////////
+      inline bool setupTransforms(png_structp png_ptr, png_infop info_ptr, unsigned int channels=0)
+      {
+	png_set_expand(png_ptr);
+	if(png_get_bit_depth(png_ptr, info_ptr) > 8 && !endian::isBigEndian()) png_set_swap(png_ptr);
+
+	if(channels != 0)
+	{
+	  png_byte colorType = png_get_color_type(png_ptr, info_ptr);
+	  bool gray = !(colorType & PNG_COLOR_MASK_COLOR) && (colorType != PNG_COLOR_TYPE_PALETTE);
+	  bool alpha = (colorType & PNG_COLOR_MASK_ALPHA) || png_get_valid(png_ptr, info_ptr, PNG_INFO_tRNS);
+
+	  if(gray && channels >= 3) png_set_gray_to_rgb(png_ptr);
+	  if(alpha && channels < ((gray && channels < 3) ? 2u : 4u)) png_set_strip_alpha(png_ptr);
+	}
+
+	bool interlaced = (png_get_interlace_type(png_ptr, info_ptr) != PNG_INTERLACE_NONE);
+	if(interlaced) png_set_interlace_handling(png_ptr);
+
+	png_read_update_info(png_ptr, info_ptr);
+	return interlaced;
+      }
+
+    } // end detail namespace
+
+
+    ///////////////////////////////////////
+    // Export PNG                        //
+    //                                   //
+    // Rows are converted and compressed //
+    // one at a time.                    //
+    ///////////////////////////////////////
     template<typename Buffer, typename C>
-      void _export(const string& filename, const Buffer& buf, const typename C::value_type& pad=0)
+      void _export(const string& filename, const Buffer& buf, const typename C::value_type& pad=0, const options& opt=options())
     {
       // sanity check
       if(buf.width() == 0 || buf.height() == 0) throw buffer2dIllegalSize();
@@ -46,44 +135,32 @@ namespace io {
 
       // allocate support memory structures
       png_structp png_ptr = png_create_write_struct(PNG_LIBPNG_VER_STRING, NULL, NULL, NULL);
-      if(!png_ptr) throw customException("Failed to allocated PNG-write structures");
+      if(!png_ptr) { fclose(fp); throw customException("Failed to allocated PNG-write structures"); }
 
       png_infop info_ptr = png_create_info_struct(png_ptr);
       if(!info_ptr)
       {
 	png_destroy_write_struct(&png_ptr, NULL);
+	fclose(fp);
 	throw customException("Failed to allocate PNG-info structures");
       }
 
-      // setup write buffer
-      typedef unsigned char   dest_type;
+      // setup IO & header
       unsigned long channels = ((C(*buf.begin())).size() == 1) ? 1 : 3;
+      png_init_io(png_ptr, fp);
+      detail::writeHeader(png_ptr, info_ptr, buf.width(), buf.height(), channels, opt);
 
-      // data buffer
-      buffer2d<dest_type> temp(buf.width()*channels, buf.height());
-      ::io::util::convertPixelToFlat<typename Buffer::const_iterator, typename buffer2d<dest_type>::iterator, C>(buf.begin(), buf.end(), temp.begin(), channels, pad);
-
-      // ptr to row buffer
-      tempArray(png_bytep, row_ptr, buf.height());      
-      for(size_t i=0; i < buf.height(); i++)
-	row_ptr[i] = &temp(0,i);
+      // convert & write row by row
+      std::vector<png_byte> row(buf.width() * channels * (opt.bitDepth() / 8));
+      typename Buffer::const_iterator scan_itr = buf.begin();
+      for(size_t y=0; y < buf.height(); y++, scan_itr += buf.width())
+      {
+	if(opt.bitDepth() == PNG16BIT) ::io::util::convertPixelToFlat<typename Buffer::const_iterator, uint16_t*, C>(scan_itr, scan_itr + buf.width(), reinterpret_cast<uint16_t*>(&row[0]), channels, pad);
+	else ::io::util::convertPixelToFlat<typename Buffer::const_iterator, uint8_t*, C>(scan_itr, scan_itr + buf.width(), &row[0], channels, pad);
 
-      // setup IO
-      png_init_io(png_ptr, fp);
+	png_write_row(png_ptr, &row[0]);
+      }
 
-      // setup header
-      png_set_IHDR(png_ptr, info_ptr, 
-		   buf.width(),           // width
-		   buf.height(),          // height
-		   8,                     // bitdepth
-		   (channels == 3) ? PNG_COLOR_TYPE_RGB : PNG_COLOR_TYPE_GRAY,
-		   PNG_INTERLACE_NONE,    // interlacing
-		   PNG_COMPRESSION_TYPE_DEFAULT,
-		   PNG_FILTER_TYPE_DEFAULT);
-
-      // write image data
-      png_write_info(png_ptr, info_ptr);
-      png_write_image(png_ptr, row_ptr);
       png_write_end(png_ptr, info_ptr);
 
       // clean up
@@ -93,9 +170,12 @@ namespace io {
       fclose(fp);
     }
 
-    ////////////////
-    // Import PNG //
-    ////////////////
+    ///////////////////////////////////////
+    // Import PNG                        //
+    //                                   //
+    // 8 and 16 bit.  Non-interlaced     //
+    // images are decoded row by row.    //
+    ///////////////////////////////////////
     template<typename Buffer, typename C>
       void _import(const string& filename, Buffer& result, const typename C::value_type& pad=0)
     {
@@ -105,55 +185,228 @@ namespace io {
 
       // read header & validate if a PNG
       png_byte header[8];
-      fread(header, 1, 8, fp);
-      if(png_sig_cmp(header, 0, 8)) throw unsupportedFormat();
+      if(fread(header, 1, 8, fp) != 8 || png_sig_cmp(header, 0, 8)) { fclose(fp); throw unsupportedFormat(); }
 
       // allocate support memory structures
       png_structp png_ptr = png_create_read_struct(PNG_LIBPNG_VER_STRING, NULL, NULL, NULL);
-      if(!png_ptr) throw customException("Failed to allocate PNG-read structures");
+      if(!png_ptr) { fclose(fp); throw customException("Failed to allocate PNG-read structures"); }
 
       png_infop info_ptr = png_create_info_struct(png_ptr);
       if(!info_ptr)
       {
 	png_destroy_read_struct(&png_ptr, NULL, NULL);
+	fclose(fp);
 	throw customException("Failed to allocate PNG-info structures");
       }
 
       // setup IO
       png_init_io(png_ptr, fp);
       png_set_sig_bytes(png_ptr, 8);
-
       png_read_info(png_ptr, info_ptr);
+
+      // allocate target; read as many channels as it holds
       png_uint_32 width = png_get_image_width(png_ptr, info_ptr);
       png_uint_32 height = png_get_image_height(png_ptr, info_ptr);
+      result.resize(width, height);
+
+      bool interlaced = detail::setupTransforms(png_ptr, info_ptr, (C(*result.begin())).size());
       png_uint_32 channels = png_get_channels(png_ptr, info_ptr);
       png_uint_32 bitdepth = png_get_bit_depth(png_ptr, info_ptr);
 
-      if(bitdepth < 8) png_set_expand(png_ptr);
-      if(bitdepth > 8) throw customException("PNG importer: unsupported bitdepth (too high)");
+      // row buffer (the whole image if interlaced)
+      size_t rowBytes = png_get_rowbytes(png_ptr, info_ptr);
+      std::vector<png_byte> rows(rowBytes * (interlaced ? height : 1));
 
-      // read buffer
-      typedef unsigned char   src_type;
-      buffer2d<src_type> temp(width*channels, height);
+      if(interlaced)
+      {
+	tempArray(png_bytep, row_ptr, height);
+	for(size_t i=0; i < height; i++)
+	  row_ptr[i] = &rows[i * rowBytes];
+	png_read_image(png_ptr, row_ptr);
+      }
 
-      // ptr to row buffer
-      tempArray(png_bytep, row_ptr, height);
-      for(size_t i=0; i < height; i++)
-	row_ptr[i] = &temp(0,i);
-      
-      png_read_image(png_ptr, row_ptr);
+      // decode & convert into the target buffer
+      typename Buffer::iterator scan_itr = result.begin();
+      for(size_t y=0; y < height; y++, scan_itr += width)
+      {
+	png_bytep row = &rows[interlaced ? y * rowBytes : 0];
+	if(!interlaced) png_read_row(png_ptr, row, NULL);
+
+	if(bitdepth == 16) ::io::util::convertFlatToPixel<const uint16_t*, typename Buffer::iterator, C>(reinterpret_cast<const uint16_t*>(row), channels, scan_itr, scan_itr + width, pad);
+	else ::io::util::convertFlatToPixel<const uint8_t*, typename Buffer::iterator, C>(row, channels, scan_itr, scan_itr + width, pad);
+      }
 
       // clean up
+      png_read_end(png_ptr, NULL);
       png_destroy_read_struct(&png_ptr, &info_ptr, NULL);
       fclose(fp);
 
-      // convert into the target buffer
-      result.resize(width, height);
-      ::io::util::convertFlatToPixel<typename buffer2d<src_type>::const_iterator, typename Buffer::iterator, C>(temp.begin(), 3, result.begin(), result.end(), pad);
+      // Done.
+    }
+
+
+    ///////////////////////////////////////
+    // Probe the header only.  Reports   //
+    // the channels and bit depth after  //
+    // palette/transparency expansion.   //
+    ///////////////////////////////////////
+    inline ::io::util::headerInfo _probe(const string& filename)
+    {
+      FILE *fp = fopen(filename.c_str(), "rb");
+      if(!fp) throw fileNotFound(filename, "reading");
+
+      // validate signature
+      png_byte header[8];
+      if(fread(header, 1, 8, fp) != 8 || png_sig_cmp(header, 0, 8)) { fclose(fp); throw unsupportedFormat(); }
+
+      // allocate support memory structures
+      png_structp png_ptr = png_create_read_struct(PNG_LIBPNG_VER_STRING, NULL, NULL, NULL);
+      png_infop info_ptr = png_ptr ? png_create_info_struct(png_ptr) : NULL;
+      if(!info_ptr)
+      {
+	if(png_ptr) png_destroy_read_struct(&png_ptr, NULL, NULL);
+	fclose(fp);
+	throw customException("Failed to allocate PNG-read structures");
+      }
+
+      // read info
+      png_init_io(png_ptr, fp);
+      png_set_sig_bytes(png_ptr, 8);
+      png_read_info(png_ptr, info_ptr);
+
+      png_byte colorType = png_get_color_type(png_ptr, info_ptr);
+      unsigned int channels = (colorType == PNG_COLOR_TYPE_PALETTE) ? 3 : png_get_channels(png_ptr, info_ptr);
+      if(!(colorType & PNG_COLOR_MASK_ALPHA) && png_get_valid(png_ptr, info_ptr, PNG_INFO_tRNS)) channels++;
+
+      ::io::util::headerInfo result(png_get_image_width(png_ptr, info_ptr), png_get_image_height(png_ptr, info_ptr), channels, std::max<unsigned int>(8, png_get_bit_depth(png_ptr, info_ptr)), false);
+
+      // clean up
+      png_destroy_read_struct(&png_ptr, &info_ptr, NULL);
+      fclose(fp);
 
       // Done.
+      return result;
     }
 
+
+    /////////////////////////////////////
+    // Scanline reader (backend of     //
+    // io::scanline_reader).  8 and 16 //
+    // bit, non-interlaced images.     //
+    /////////////////////////////////////
+    class reader : public ::io::util::scanlineReader {
+    public:
+      explicit reader(const string& filename) : _png(NULL), _info(NULL)
+      {
+	_fp = fopen(filename.c_str(), "rb");
+	if(!_fp) throw fileNotFound(filename, "reading");
+
+	// read header & validate if a PNG
+	png_byte header[8];
+	if(fread(header, 1, 8, _fp) != 8 || png_sig_cmp(header, 0, 8)) { fclose(_fp); throw unsupportedFormat(); }
+
+	// allocate support memory structures
+	_png = png_create_read_struct(PNG_LIBPNG_VER_STRING, NULL, NULL, NULL);
+	if(_png) _info = png_create_info_struct(_png);
+	if(!_info) { _close(); throw customException("Failed to allocate PNG-read structures"); }
+
+	// setup IO
+	png_init_io(_png, _fp);
+	png_set_sig_bytes(_png, 8);
+	png_read_info(_png, _info);
+
+	if(png_get_interlace_type(_png, _info) != PNG_INTERLACE_NONE) { _close(); throw customException("PNG reader: interlaced images are not supported."); }
+	detail::setupTransforms(_png, _info);
+
+	_width = png_get_image_width(_png, _info);
+	_height = png_get_image_height(_png, _info);
+	_channels = png_get_channels(_png, _info);
+	_bitDepth = png_get_bit_depth(_png, _info);
+	_row.resize(png_get_rowbytes(_png, _info));
+      }
+
+      ~reader(void) { _close(); }
+
+      void readRow(float* samples)
+      {
+	png_read_row(_png, &_row[0], NULL);
+
+	if(_bitDepth == 16) ::io::util::convertSamples(reinterpret_cast<const uint16_t*>(&_row[0]), _width * _channels, samples);
+	else ::io::util::convertSamples(reinterpret_cast<const uint8_t*>(&_row[0]), _width * _channels, samples);
+      }
+
+    private:
+      void _close(void)
+      {
+	if(_png) png_destroy_read_struct(&_png, _info ? &_info : NULL, NULL);
+	if(_fp) fclose(_fp);
+	_png = NULL;
+	_info = NULL;
+	_fp = NULL;
+      }
+
+      FILE* _fp;
+      png_structp _png;
+      png_infop _info;
+      unsigned int _bitDepth;
+      std::vector<png_byte> _row;
+    };
+
+
+    /////////////////////////////////////
+    // Scanline writer (backend of     //
+    // io::scanline_writer).  Gray or  //
+    // RGB, 8 or 16 bit.               //
+    /////////////////////////////////////
+    class writer : public ::io::util::scanlineWriter {
+    public:
+      writer(const string& filename, size_t width, size_t height, unsigned int channels, const options& opt=options()) : ::io::util::scanlineWriter((channels == 1) ? 1 : 3), _png(NULL), _info(NULL), _bitDepth(opt.bitDepth()), _row(width * _channels * (opt.bitDepth() / 8))
+      {
+	_fp = fopen(filename.c_str(), "wb");
+	if(!_fp) throw fileNotFound(filename, "writing");
+
+	// allocate support memory structures
+	_png = png_create_write_struct(PNG_LIBPNG_VER_STRING, NULL, NULL, NULL);
+	if(_png) _info = png_create_info_struct(_png);
+	if(!_info) { _close(); throw customException("Failed to allocate PNG-write structures"); }
+
+	// setup IO & header
+	png_init_io(_png, _fp);
+	detail::writeHeader(_png, _info, width, height, _channels, opt);
+      }
+
+      ~writer(void) { _close(); }
+
+      void writeRow(const float* samples)
+      {
+	if(_bitDepth == PNG16BIT) ::io::util::convertSamples(samples, _row.size() / 2, reinterpret_cast<uint16_t*>(&_row[0]));
+	else ::io::util::convertSamples(samples, _row.size(), &_row[0]);
+	png_write_row(_png, &_row[0]);
+      }
+
+      void finish(void)
+      {
+	png_write_end(_png, _info);
+	_close();
+      }
+
+    private:
+      void _close(void)
+      {
+	if(_png) png_destroy_write_struct(&_png, _info ? &_info : NULL);
+	if(_fp) fclose(_fp);
+	_png = NULL;
+	_info = NULL;
+	_fp = NULL;
+      }
+
+      FILE* _fp;
+      png_structp _png;
+      png_infop _info;
+      bit_depth _bitDepth;
+      std::vector<png_byte> _row;
+    };
+
 #endif /* INCLUDE_PNG */
 
   } // end png namespace
@@ -0,0 +1,81 @@
+#if defined(_BUFFER2DIO_PNG_H_) and !defined(_BUFFER2DIO_PNG_OPTIONS_H_)
+#define _BUFFER2DIO_PNG_OPTIONS_H_
+
+#include "exceptions.h"
+
+namespace io {
+  namespace png {
+
+    enum bit_depth {
+      PNG8BIT = 8,
+      PNG16BIT = 16
+    };
+
+    // row filter (ADAPTIVE: libpng picks the best filter per row)
+    enum filter {
+      ADAPTIVE = 0,
+      NO_FILTER = 1,
+      SUB = 2,
+      UP = 3,
+      AVERAGE = 4,
+      PAETH = 5
+    };
+
+    // zlib strategy (same values as zlib's Z_* constants)
+    enum strategy {
+      DEFAULT_STRATEGY = 0,
+      FILTERED = 1,
+      HUFFMAN_ONLY = 2,
+      RLE = 3
+    };
+
+    struct options {
+    public:
+      /////////////////
+      // Constructor //
+      /////////////////
+      options(const bit_depth& bitDepth=PNG8BIT, int compressionLevel=-1, const filter& filterType=ADAPTIVE, const strategy& strategyType=DEFAULT_STRATEGY) : _bitDepth(bitDepth),
+                                                                                                                                                               _compressionLevel(compressionLevel),
+                                                                                                                                                               _filter(filterType),
+                                                                                                                                                               _strategy(strategyType)
+      {
+	if(_compressionLevel < -1 || _compressionLevel > 9) throw customException("PNG options: compression level must be in [-1, 9].");
+      }
+
+      //////////////////////
+      // Copy Constructor //
+      //////////////////////
+      options(const options& src) : _bitDepth(src._bitDepth),
+                                    _compressionLevel(src._compressionLevel),
+                                    _filter(src._filter),
+                                    _strategy(src._strategy)
+      {
+	// Do nothing
+      }
+
+      ////////////////
+      // Inspectors //
+      ////////////////
+      bit_depth bitDepth(void) const        { return _bitDepth; }
+      int compressionLevel(void) const      { return _compressionLevel; }     // -1: zlib default
+      filter filterType(void) const         { return _filter; }
+      strategy strategyType(void) const     { return _strategy; }
+
+    private:
+      //////////////////
+      // Private Data //
+      //////////////////
+      bit_depth _bitDepth;
+      int _compressionLevel;
+      filter _filter;
+      strategy _strategy;
+    };
+
+
+    // fast compression (e.g., previews): larger files, several times faster to write
+    inline options fastOptions(const bit_depth& bitDepth=PNG8BIT) { return options(bitDepth, 1, SUB, RLE); }
+
+  } // end png namespace
+}   // end io namespace
+
+#endif /* _BUFFER2DIO_PNG_OPTIONS_H_ */
@@ -7,10 +7,12 @@
 
 #include "Endian.h"
 #include "tempArray.h"
+#include "mappedFile.h"
 #include "exceptions.h"
 #include "buffer2dIO.util.h"
 
 #include <cstdio>
+#include <vector>
 #include <stdint.h>
 #include <boost/limits.hpp>
 
@@ -19,34 +21,71 @@ using namespace std;
 namespace io {
   namespace ppm {
     
-    namespace detail {
-      
-      /////////////////////////////////
-      // Skip Comments in the Header //
-      /////////////////////////////////
-      void skipComment(FILE *fp, char token='#')
-      {
-	int b = fgetc(fp);
-
-	while(b != EOF && (b == token))
-	{
-	  while (b != EOF && b != '\n' && b != '\r')
-	    b = fgetc(fp);
-	  
-	  b = fgetc(fp);
-	}
-	ungetc(b, fp);
-      }
-
-    } // namespace detail
-
-
     enum bit_depth {
       PPM8BIT = 8,
       PPM16BIT = 16,
       PPM32BIT = 32          // WARNING: unofficial extension!
     };
 
+
+    namespace detail {
+
+      //////////////////////////////////////
+      // Parse the header of a (mapped)   //
+      // PPM/PGM file.  'data' points to  //
+      // the first sample.                //
+      //////////////////////////////////////
+      struct header {
+	unsigned long width, height;
+	unsigned int channels;
+	bit_depth bitDepth;
+	const char* data;
+      };
+
+      inline header readHeader(const mappedFile& file)
+      {
+	::io::util::headerReader reader(file.data(), file.data() + file.size());
+
+	// scan header
+	char dummy=0, type=0;
+	unsigned long width=0, height=0, colors=0;
+
+	bool res = reader.readChar(dummy) && (dummy == 'P') && reader.readChar(type) && reader.readChar(dummy);
+	reader.skipComment();
+	res = res && reader.readNumber(width) && reader.readChar(dummy) && reader.readNumber(height) && reader.readChar(dummy);
+	reader.skipComment();
+	res = res && reader.readNumber(colors) && reader.readChar(dummy);
+
+	if (!res) throw customException("PPM importer: failed to read header."); 
+
+	// Determine number of color channels
+	header result;
+	result.width = width;
+	result.height = height;
+	if(type == '6') result.channels = 3;
+	else if(type == '5') result.channels = 1;
+	else throw unsupportedFormat();
+
+	// get bit depth
+	if(colors == std::numeric_limits<uint8_t>::max()) result.bitDepth = PPM8BIT;
+	else if(colors == std::numeric_limits<uint16_t>::max()) result.bitDepth = PPM16BIT;
+	else if(colors == std::numeric_limits<uint32_t>::max()) result.bitDepth = PPM32BIT;
+	else throw unsupportedFormat();
+
+	// check size
+	result.data = reader.position();
+	size_t bytes;
+	if(!::io::util::imageBytes(width, height, result.channels, (result.bitDepth / 8), bytes))
+	  throw customException("PPM importer: image dimensions are too large.");
+	if((size_t)(file.data() + file.size() - result.data) < bytes)
+	  throw customException("PPM importer: file is truncated.");
+
+	// done.
+	return result;
+      }
+
+    } // namespace detail
+
   ////////////////
   // Export PPM //
   ////////////////
@@ -77,13 +116,13 @@ namespace io {
       {
         maxValue = std::numeric_limits<uint16_t>::max();
         ::io::util::convertPixelToFlat<typename Buffer::const_iterator, uint16_t*, C>(buf.begin(), buf.end(), tempArrayBegin(uint16_t, tempBuffer, tempBufferSize), numChannels, pad);
-        endian::big(tempArrayBegin(uint16_t, tempBuffer, tempBufferSize), tempArrayEnd(uint16_t, tempBuffer, tempBufferSize));
+        endian::big(tempArrayBegin(uint16_t, tempBuffer, tempBufferSize), tempArrayBegin(uint16_t, tempBuffer, tempBufferSize) + tempBufferSize);
       }
       else if(bitDepth == PPM32BIT)
       {
         maxValue = std::numeric_limits<uint32_t>::max();
         ::io::util::convertPixelToFlat<typename Buffer::const_iterator, uint32_t*, C>(buf.begin(), buf.end(), tempArrayBegin(uint32_t, tempBuffer, tempBufferSize), numChannels, pad);
-        endian::big(tempArrayBegin(uint32_t, tempBuffer, tempBufferSize), tempArrayEnd(uint32_t, tempBuffer, tempBufferSize));
+        endian::big(tempArrayBegin(uint32_t, tempBuffer, tempBufferSize), tempArrayBegin(uint32_t, tempBuffer, tempBufferSize) + tempBufferSize);
       }
 
       // write temp buffer to file
@@ -97,67 +136,136 @@ namespace io {
     }
 
 
-  ////////////////
-  // Import PPM //
-  ////////////////
+  ////////////////////////////////////////////
+  // Import PPM                             //
+  //                                        //
+  // The file is memory mapped and samples  //
+  // are converted directly from the        //
+  // mapping.                               //
+  ////////////////////////////////////////////
   template<typename Buffer, typename C>
     void _import(const string& filename, Buffer& result, const typename C::value_type& pad=0)
     {
-      // read temp buffer
-      char dummy, type;
-      unsigned long width, height, colors;
-      FILE *fp = fopen(filename.c_str(), "rb");
-
-      if(!fp) throw fileNotFound(filename);
-
-      // scan header
-      int res = fscanf(fp, "P%c%c", &type, &dummy);
-      detail::skipComment(fp);
-      res += fscanf(fp, "%lu%c%lu%c", &width, &dummy, &height, &dummy);
-      detail::skipComment(fp);
-      res += fscanf(fp, "%lu%c", &colors, &dummy);
-
-      if (res != 8) throw customException("PPM importer: failed to read header."); 
-
-      // Determine number of color channels
-      unsigned numChannels;
-      if(type == '6') numChannels = 3;
-      else if(type == '5') numChannels = 1;
-      else throw unsupportedFormat();
-
-      // get bit depth
-      bit_depth bitDepth;
-      if(colors == std::numeric_limits<uint8_t>::max()) bitDepth = PPM8BIT;
-      else if(colors == std::numeric_limits<uint16_t>::max()) bitDepth = PPM16BIT;
-      else if(colors == std::numeric_limits<uint32_t>::max()) bitDepth = PPM32BIT;
-      else unsupportedFormat();
-
-      // read buffer
-      unsigned long tempBufferSize = width * height * numChannels;
-      tempArray(uint8_t, tempBuffer, tempBufferSize * (bitDepth / 8));
-      fread(tempArrayBegin(uint8_t, tempBuffer, tempBufferSize), bitDepth / 8,  tempBufferSize, fp);
-      fclose(fp);
-
-
-      // allocate
-      result.resize(width, height);
-      
+      mappedFile file(filename);
+      detail::header header = detail::readHeader(file);
+      unsigned int numChannels = header.channels;
+      bit_depth bitDepth = header.bitDepth;
+      const char* data = header.data;
+
+      // allocate & convert (samples are big endian)
+      file.sequential();
+      result.resize(header.width, header.height);
+      bool swapBytes = !endian::isBigEndian();
+
       if(bitDepth == PPM8BIT)
-	::io::util::convertFlatToPixel<const uint8_t*, typename Buffer::iterator, C>(tempArrayBegin(uint8_t, tempBuffer, tempBufferSize), numChannels, result.begin(), result.end(), pad);
+	::io::util::convertFlatToPixel<const uint8_t*, typename Buffer::iterator, C>(reinterpret_cast<const uint8_t*>(data), numChannels, result.begin(), result.end(), pad);
       else if(bitDepth == PPM16BIT)
+	::io::util::convertFlatToPixel< ::io::util::rawSampleIterator<uint16_t>, typename Buffer::iterator, C>(::io::util::rawSampleIterator<uint16_t>(data, swapBytes), numChannels, result.begin(), result.end(), pad);
+      else if(bitDepth == PPM32BIT)
+	::io::util::convertFlatToPixel< ::io::util::rawSampleIterator<uint32_t>, typename Buffer::iterator, C>(::io::util::rawSampleIterator<uint32_t>(data, swapBytes), numChannels, result.begin(), result.end(), pad);
+
+      // done.
+    }
+
+
+  ///////////////////////////
+  // Probe the header only //
+  ///////////////////////////
+  inline ::io::util::headerInfo _probe(const string& filename)
+  {
+    mappedFile file(filename);
+    detail::header header = detail::readHeader(file);
+    return ::io::util::headerInfo(header.width, header.height, header.channels, header.bitDepth, false);
+  }
+
+
+  /////////////////////////////////////
+  // Scanline reader (backend of     //
+  // io::scanline_reader)            //
+  /////////////////////////////////////
+  class reader : public ::io::util::scanlineReader {
+  public:
+    explicit reader(const string& filename) : _file(filename)
+    {
+      detail::header header = detail::readHeader(_file);
+      _width = header.width;
+      _height = header.height;
+      _channels = header.channels;
+      _bitDepth = header.bitDepth;
+      _data = header.data;
+      _file.sequential();
+    }
+
+    void readRow(float* samples)
+    {
+      std::size_t count = _width * _channels;
+      bool swapBytes = !endian::isBigEndian();
+
+      if(_bitDepth == PPM8BIT) ::io::util::convertSamples(reinterpret_cast<const uint8_t*>(_data), count, samples);
+      else if(_bitDepth == PPM16BIT) ::io::util::convertSamples(::io::util::rawSampleIterator<uint16_t>(_data, swapBytes), count, samples);
+      else ::io::util::convertSamples(::io::util::rawSampleIterator<uint32_t>(_data, swapBytes), count, samples);
+
+      _data += count * (_bitDepth / 8);
+    }
+
+  private:
+    mappedFile _file;
+    bit_depth _bitDepth;
+    const char* _data;
+  };
+
+
+  /////////////////////////////////////
+  // Scanline writer (backend of     //
+  // io::scanline_writer)            //
+  /////////////////////////////////////
+  class writer : public ::io::util::scanlineWriter {
+  public:
+    writer(const string& filename, size_t width, size_t height, unsigned int channels, bit_depth bitDepth=PPM8BIT) : ::io::util::scanlineWriter((channels == 1) ? 1 : 3), _width(width), _bitDepth(bitDepth), _row((width * _channels * bitDepth) / 8)
+    {
+      _fp = fopen(filename.c_str(), "wb");
+      if(!_fp) throw fileNotFound(filename, "writing");
+
+      unsigned long maxValue = (bitDepth == PPM8BIT) ? std::numeric_limits<uint8_t>::max() : (bitDepth == PPM16BIT) ? std::numeric_limits<uint16_t>::max() : std::numeric_limits<uint32_t>::max();
+      fprintf(_fp, "%s\n%lu %lu\n%lu\n", (_channels == 1) ? "P5" : "P6", (unsigned long)(width), (unsigned long)(height), maxValue);
+    }
+
+    ~writer(void) { if(_fp) fclose(_fp); }
+
+    void writeRow(const float* samples)
+    {
+      std::size_t count = _width * _channels;
+
+      if(_bitDepth == PPM8BIT) ::io::util::convertSamples(samples, count, reinterpret_cast<uint8_t*>(&_row[0]));
+      else if(_bitDepth == PPM16BIT)
       {
-        endian::big(tempArrayBegin(uint16_t, tempBuffer, tempBufferSize), tempArrayEnd(uint16_t, tempBuffer, tempBufferSize));
-	::io::util::convertFlatToPixel<const uint16_t*, typename Buffer::iterator, C>(tempArrayBegin(uint16_t, tempBuffer, tempBufferSize), numChannels, result.begin(), result.end(), pad);
+	uint16_t* row = reinterpret_cast<uint16_t*>(&_row[0]);
+	::io::util::convertSamples(samples, count, row);
+	endian::big(row, row + count);
       }
-      else if(bitDepth == PPM32BIT)
+      else
       {
-        endian::big(tempArrayBegin(uint32_t, tempBuffer, tempBufferSize), tempArrayEnd(uint32_t, tempBuffer, tempBufferSize));
-	::io::util::convertFlatToPixel<const uint32_t*, typename Buffer::iterator, C>(tempArrayBegin(uint32_t, tempBuffer, tempBufferSize), numChannels, result.begin(), result.end(), pad);
+	uint32_t* row = reinterpret_cast<uint32_t*>(&_row[0]);
+	::io::util::convertSamples(samples, count, row);
+	endian::big(row, row + count);
       }
 
-      // done.
+      if(fwrite(&_row[0], 1, _row.size(), _fp) != _row.size()) throw customException("PPM writer: failed to write to file.");
     }
 
+    void finish(void)
+    {
+      if(_fp && fclose(_fp) != 0) { _fp = NULL; throw customException("PPM writer: failed to close file."); }
+      _fp = NULL;
+    }
+
+  private:
+    FILE* _fp;
+    size_t _width;
+    bit_depth _bitDepth;
+    std::vector<char> _row;
+  };
+
   } // namespace ppm
 }   // namespace io
 
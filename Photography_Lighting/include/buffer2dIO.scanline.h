@@ -0,0 +1,213 @@
+///////////////////////////////////////////////
+// Streaming (scanline) image reader/writer. //
+//                                           //
+// Rows, or bands of rows, are exchanged     //
+// through caller-provided buffers or views, //
+// such that row-local filters can process   //
+// images of any size in constant memory.    //
+///////////////////////////////////////////////
+
+#ifndef _BUFFER2DIO_SCANLINE_H_
+#define _BUFFER2DIO_SCANLINE_H_
+
+#include <string>
+#include <vector>
+#include <cctype>
+#include <algorithm>
+#include <boost/utility.hpp>
+#include <boost/scoped_ptr.hpp>
+
+#include "buffer2d.h"
+#include "buffer2dView.h"
+#include "iteratorWrapper.h"
+#include "exceptions.h"
+#include "buffer2dIO.util.h"
+#include "buffer2dIO.ppm.h"
+#include "buffer2dIO.pfm.h"
+#include "buffer2dIO.exr.h"
+#include "buffer2dIO.png.h"
+#include "buffer2dIO.jpg.h"
+#include "buffer2dIO.tif.h"
+
+namespace io {
+
+  namespace detail {
+    // lower case extension (without '.')
+    inline std::string extension(const std::string& filename)
+    {
+      std::string::size_type dot = filename.rfind('.');
+      std::string ext = (dot == std::string::npos) ? std::string() : filename.substr(dot + 1);
+      for(std::string::iterator itr=ext.begin(); itr != ext.end(); ++itr)
+	*itr = tolower(*itr);
+      return ext;
+    }
+  } // end detail namespace
+
+
+  /////////////////////////////////////////////////////
+  // Pull-style reader: the format is determined by  //
+  // the extension.  Each call to read() decodes the //
+  // next band of rows (up to the height of the      //
+  // destination) and returns the number of rows     //
+  // read (0 at the end of the image).               //
+  /////////////////////////////////////////////////////
+  class scanline_reader : boost::noncopyable {
+  public:
+    typedef size_t size_type;
+
+    //////////////////
+    // Constructors //
+    //////////////////
+    explicit scanline_reader(const std::string& filename) : _row(0)
+    {
+      std::string ext = detail::extension(filename);
+
+      if(ext == "pfm") _reader.reset(new pfm::reader(filename));
+      else if(ext == "ppm" || ext == "pnm" || ext == "pgm") _reader.reset(new ppm::reader(filename));
+      else if(ext == "exr") _reader.reset(new exr::reader(filename));
+      else if(ext == "png") _reader.reset(new png::reader(filename));
+      else if(ext == "jpg" || ext == "jpeg") _reader.reset(new jpg::reader(filename));
+      else if(ext == "tif" || ext == "tiff") _reader.reset(new tif::reader(filename));
+      else throw unsupportedFormat();
+
+      _samples.resize(width() * channels());
+    }
+
+    // JPEG decoded at reduced resolution
+    scanline_reader(const std::string& filename, jpg::scale s) : _reader(new jpg::reader(filename, s)), _row(0)  { _samples.resize(width() * channels()); }
+
+    ////////////////
+    // Inspectors //
+    ////////////////
+    size_type width(void) const       { return _reader->width(); }
+    size_type height(void) const      { return _reader->height(); }
+    unsigned int channels(void) const { return _reader->channels(); }
+
+    size_type row(void) const  { return _row; }       // index of the next row
+    bool done(void) const      { return _row == height(); }
+
+    /////////////
+    // Methods //
+    /////////////
+    template<typename T>
+      size_type read(const buffer2d_view<T>& band, const typename iteratorWrapper<T>::value_type& pad=0)
+    {
+      // sanity check
+      if(band.width() != width()) throw buffer2dIllegalSize();
+
+      size_type rows = std::min(band.height(), height() - _row);
+      for(size_type y=0; y < rows; y++, _row++)
+      {
+	_reader->readRow(&_samples[0]);
+	::io::util::convertFlatToPixel<const float*, T*, iteratorWrapper<T> >(&_samples[0], channels(), band.row(y), band.row(y) + width(), pad);
+      }
+
+      // done.
+      return rows;
+    }
+
+    template<typename T>
+      size_type read(buffer2d<T>& band, const typename iteratorWrapper<T>::value_type& pad=0)  { return read(buffer2d_view<T>(band), pad); }
+
+  private:
+    //////////////////////////
+    // Private Data Members //
+    //////////////////////////
+    boost::scoped_ptr< ::io::util::scanlineReader > _reader;
+    std::vector<float> _samples;
+    size_type _row;
+  };
+
+
+  /////////////////////////////////////////////////////
+  // Push-style writer: the format is determined by  //
+  // the extension.  Bands are appended top to       //
+  // bottom; close() (or the destructor) finalizes   //
+  // the file once all rows are written.             //
+  /////////////////////////////////////////////////////
+  class scanline_writer : boost::noncopyable {
+  public:
+    typedef size_t size_type;
+
+    //////////////////
+    // Constructors //
+    //////////////////
+    scanline_writer(const std::string& filename, size_type width, size_type height, unsigned int channels=3) : _width(width), _height(height), _row(0)
+    {
+      std::string ext = detail::extension(filename);
+
+      if(ext == "pfm") _writer.reset(new pfm::writer(filename, width, height, channels));
+      else if(ext == "ppm" || ext == "pnm" || ext == "pgm") _writer.reset(new ppm::writer(filename, width, height, channels));
+      else if(ext == "exr") _writer.reset(new exr::writer(filename, width, height, channels));
+      else if(ext == "png") _writer.reset(new png::writer(filename, width, height, channels));
+      else if(ext == "jpg" || ext == "jpeg") _writer.reset(new jpg::writer(filename, width, height, channels));
+      else if(ext == "tif" || ext == "tiff") _writer.reset(new tif::writer(filename, width, height, channels));
+      else throw unsupportedFormat();
+
+      _samples.resize(width * _writer->channels());
+    }
+
+    scanline_writer(const std::string& filename, size_type width, size_type height, unsigned int channels, const exr::options& opt) : _writer(new exr::writer(filename, width, height, channels, opt)), _width(width), _height(height), _row(0)  { _samples.resize(width * _writer->channels()); }
+    scanline_writer(const std::string& filename, size_type width, size_type height, unsigned int channels, const png::options& opt) : _writer(new png::writer(filename, width, height, channels, opt)), _width(width), _height(height), _row(0)  { _samples.resize(width * _writer->channels()); }
+    scanline_writer(const std::string& filename, size_type width, size_type height, unsigned int channels, const tif::options& opt) : _writer(new tif::writer(filename, width, height, channels, opt)), _width(width), _height(height), _row(0)  { _samples.resize(width * _writer->channels()); }
+
+    ////////////////
+    // Destructor //
+    ////////////////
+    ~scanline_writer(void)
+    {
+      try { if(_row == _height) close(); }
+      catch(...) {}
+    }
+
+    ////////////////
+    // Inspectors //
+    ////////////////
+    size_type width(void) const       { return _width; }
+    size_type height(void) const      { return _height; }
+    unsigned int channels(void) const { return _writer->channels(); }
+    size_type row(void) const         { return _row; }      // index of the next row
+
+    /////////////
+    // Methods //
+    /////////////
+    template<typename T>
+      void write(const const_buffer2d_view<T>& band, const typename iteratorWrapper<T>::value_type& pad=0)
+    {
+      // sanity check
+      if(band.width() != width() || _row + band.height() > height()) throw buffer2dIllegalSize();
+
+      for(size_type y=0; y < band.height(); y++, _row++)
+      {
+	::io::util::convertPixelToFlat<const T*, float*, iteratorWrapper<const T> >(band.row(y), band.row(y) + width(), &_samples[0], channels(), pad);
+	_writer->writeRow(&_samples[0]);
+      }
+
+      // done.
+    }
+
+    template<typename T>
+      void write(const buffer2d<T>& band, const typename iteratorWrapper<T>::value_type& pad=0)  { write(const_buffer2d_view<T>(band), pad); }
+
+    void close(void)
+    {
+      if(!_writer) return;
+      if(_row != _height) throw customException("scanline_writer: not all rows were written.");
+
+      boost::scoped_ptr< ::io::util::scanlineWriter > writer;
+      writer.swap(_writer);
+      writer->finish();
+    }
+
+  private:
+    //////////////////////////
+    // Private Data Members //
+    //////////////////////////
+    boost::scoped_ptr< ::io::util::scanlineWriter > _writer;
+    std::vector<float> _samples;
+    size_type _width, _height, _row;
+  };
+
+} // end io namespace
+
+#endif /* _BUFFER2DIO_SCANLINE_H_ */
@@ -3,12 +3,19 @@
 ///////////////////////////////////////////////////////
 
 #if !defined(_BUFFER2DIO_TIF_DETAIL_H_) && defined(_BUFFER2DIO_TIF_H_)
-#define _BUFFER2D_TIF_DETAIL_H_
+#define _BUFFER2DIO_TIF_DETAIL_H_
 
+#include <vector>
+#include <cstring>
+#include <algorithm>
 #include <stdint.h>
 #include "exceptions.h"
 #include "buffer2dIO.tif.options.h"
 
+#ifdef INCLUDE_ZLIB
+  #include <zlib.h>
+#endif
+
 namespace detail {  // io::tif::detail
 
       template<typename S, typename Swrapper>
@@ -91,7 +98,391 @@ namespace detail {  // io::tif::detail
 
 
 
+
+      //////////////////////////////////////////////////////
+      // Decodes a TIFF image one band of rows at a time: //
+      // a band is one row of strips or tiles (all        //
+      // planes), decoded with TIFFReadEncodedStrip/Tile. //
+      //////////////////////////////////////////////////////
+      class bandReader {
+      public:
+	explicit bandReader(TIFF* fp) : _fp(fp), _y0(0), _rows(0)
+	{
+	  // read the header
+	  int headerSuccess = 1;
+	  uint16_t channels, bitsPerSample, config, sampleFormat;
+
+	  headerSuccess &= TIFFGetField(fp, TIFFTAG_IMAGEWIDTH, &_width);
+	  headerSuccess &= TIFFGetField(fp, TIFFTAG_IMAGELENGTH, &_height);
+	  headerSuccess &= TIFFGetField(fp, TIFFTAG_BITSPERSAMPLE, &bitsPerSample);
+	  if(headerSuccess != 0x01) throw customException("TIFF importer failed to read header.");
+
+	  if(TIFFGetField(fp, TIFFTAG_SAMPLESPERPIXEL, &channels) != 1) channels = 1;
+	  if(TIFFGetField(fp, TIFFTAG_SAMPLEFORMAT, &sampleFormat) != 1) sampleFormat = 1;
+	  if(TIFFGetField(fp, TIFFTAG_PLANARCONFIG, &config) != 1) config = PLANARCONFIG_CONTIG;
+	  if(config != PLANARCONFIG_CONTIG && config != PLANARCONFIG_SEPARATE) throw customException("TIFF importer: unsupported planar config.");
+
+	  _channels = channels;
+	  _bitsPerSample = bitsPerSample;
+	  _sampleFormat = static_cast< ::io::tif::sample_format>(sampleFormat);
+	  _separate = (config == PLANARCONFIG_SEPARATE);
+
+	  // chunk (strip or tile) dimensions
+	  _tiled = (TIFFIsTiled(fp) != 0);
+	  if(_tiled)
+	  {
+	    TIFFGetField(fp, TIFFTAG_TILEWIDTH, &_chunkWidth);
+	    TIFFGetField(fp, TIFFTAG_TILELENGTH, &_chunkHeight);
+	    _chunk.resize(TIFFTileSize(fp));
+	  }
+	  else
+	  {
+	    _chunkWidth = _width;
+	    TIFFGetFieldDefaulted(fp, TIFFTAG_ROWSPERSTRIP, &_chunkHeight);
+	    _chunkHeight = std::min(_chunkHeight, _height);
+	  }
+
+	  // band storage: one buffer per plane
+	  _pixelBytes = (_separate ? 1 : _channels) * (_bitsPerSample / 8);
+	  _band.resize(planes());
+	  for(unsigned int p=0; p < planes(); p++)
+	    _band[p].resize(std::max<size_t>((size_t)(_chunkHeight) * rowBytes(), _tiled ? 0 : TIFFStripSize(fp)));
+	}
+
+	////////////////
+	// Inspectors //
+	////////////////
+	uint32 width(void) const                        { return _width; }
+	uint32 height(void) const                       { return _height; }
+	unsigned int channels(void) const               { return _channels; }
+	unsigned int bitsPerSample(void) const          { return _bitsPerSample; }
+	::io::tif::sample_format sampleFormat(void) const { return _sampleFormat; }
+	bool separate(void) const                       { return _separate; }
+	unsigned int planes(void) const                 { return _separate ? _channels : 1; }
+	size_t rowBytes(void) const                     { return (size_t)(_width) * _pixelBytes; }
+
+	// decoded row y of a plane (decodes the band containing y if needed)
+	const unsigned char* row(uint32 y, unsigned int plane=0)
+	{
+	  if(y < _y0 || y >= _y0 + _rows) _read(y - (y % _chunkHeight));
+	  return &_band[plane][(y - _y0) * rowBytes()];
+	}
+
+      private:
+	void _read(uint32 y0)
+	{
+	  _y0 = y0;
+	  _rows = std::min(_chunkHeight, _height - y0);
+
+	  for(unsigned int p=0; p < planes(); p++)
+	  {
+	    // strips: decode in place
+	    if(!_tiled)
+	    {
+	      if(TIFFReadEncodedStrip(_fp, TIFFComputeStrip(_fp, y0, p), &_band[p][0], (tsize_t)(-1)) < 0)
+		throw customException("TIFF importer failed to read strip.");
+	      continue;
+	    }
+
+	    // tiles: decode and copy the valid part into the band
+	    for(uint32 x0=0; x0 < _width; x0 += _chunkWidth)
+	    {
+	      if(TIFFReadEncodedTile(_fp, TIFFComputeTile(_fp, x0, y0, 0, p), &_chunk[0], (tsize_t)(-1)) < 0)
+		throw customException("TIFF importer failed to read tile.");
+
+	      size_t bytes = std::min(_chunkWidth, _width - x0) * _pixelBytes;
+	      for(uint32 r=0; r < _rows; r++)
+		std::memcpy(&_band[p][r * rowBytes() + x0 * _pixelBytes], &_chunk[r * _chunkWidth * _pixelBytes], bytes);
+	    }
+	  }
+	}
+
+	//////////////////////////
+	// Private Data Members //
+	//////////////////////////
+	TIFF* _fp;
+	uint32 _width, _height, _chunkWidth, _chunkHeight, _y0, _rows;
+	unsigned int _channels, _bitsPerSample;
+	::io::tif::sample_format _sampleFormat;
+	bool _separate, _tiled;
+	size_t _pixelBytes;
+	std::vector< std::vector<unsigned char> > _band;
+	std::vector<unsigned char> _chunk;
+      };
+
+
+      //////////////////////////////////////////////////////
+      // Strips/tiles that can be compressed outside of   //
+      // libTIFF (and hence in parallel) and written with //
+      // TIFFWriteRawStrip/Tile: uncompressed, LZW, and   //
+      // Deflate when zlib is available.                  //
+      //////////////////////////////////////////////////////
+      inline bool rawCompression(const ::io::tif::compression& compressionType)
+      {
+#ifdef INCLUDE_ZLIB
+	if(compressionType == ::io::tif::DEFLATE) return true;
+#endif
+	return (compressionType == ::io::tif::NONE || compressionType == ::io::tif::LZW);
+      }
+
+
+      // MSB-first packing of variable width codes
+      struct codeWriter {
+	codeWriter(std::vector<unsigned char>& dst) : _dst(dst), _buffer(0), _buffered(0) {}
+
+	void put(int code, int bits)
+	{
+	  _buffer = (_buffer << bits) | (unsigned long)(code);
+	  _buffered += bits;
+	  while(_buffered >= 8)
+	  {
+	    _buffered -= 8;
+	    _dst.push_back((unsigned char)(_buffer >> _buffered));
+	  }
+	}
+
+	void flush(void)
+	{
+	  if(_buffered > 0) _dst.push_back((unsigned char)(_buffer << (8 - _buffered)));
+	  _buffered = 0;
+	}
+
+      private:
+	std::vector<unsigned char>& _dst;
+	unsigned long _buffer;
+	int _buffered;
+      };
+
+
+      //////////////////////////////////////////////////////
+      // compress 'size' bytes into a TIFF LZW stream     //
+      // (MSB-first codes of 9-12 bits, starting with a   //
+      // Clear code; same code stream as libTIFF's LZW    //
+      // encoder, including the early change of the code  //
+      // width that TIFF readers expect).                 //
+      //////////////////////////////////////////////////////
+      inline void lzwChunk(const unsigned char* src, size_t size, std::vector<unsigned char>& dst)
+      {
+	const int clearCode = 256, endCode = 257, firstCode = 258, maxCode = 4095;
+	const int hashSize = 8192;                            // > 4096 codes; power of 2
+
+	std::vector<int> hashKey(hashSize, -1), hashCode(hashSize);
+	int nextCode = firstCode, bits = 9;
+
+	dst.clear();
+	dst.reserve(size / 2 + 16);
+	codeWriter out(dst);
+	out.put(clearCode, bits);
+
+	if(size != 0)
+	{
+	  int prefix = src[0];
+	  for(size_t i=1; i <= size; i++)
+	  {
+	    if(i < size)
+	    {
+	      int key = (prefix << 8) | src[i];
+	      int h = ((unsigned int)(key) * 2654435761u) >> 19 & (hashSize - 1);
+	      while(hashKey[h] != -1 && hashKey[h] != key)
+		h = (h + 1) & (hashSize - 1);
+
+	      // extend the current string
+	      if(hashKey[h] == key) { prefix = hashCode[h]; continue; }
+
+	      // emit the string and add it plus the next byte to the table
+	      out.put(prefix, bits);
+	      prefix = src[i];
+	      hashKey[h] = key;
+	      hashCode[h] = nextCode++;
+	    }
+
+	    // last string (the reader adds a table entry for it as well)
+	    else
+	    {
+	      out.put(prefix, bits);
+	      nextCode++;
+	    }
+
+	    if(nextCode == maxCode - 1)
+	    {
+	      // table full: start over
+	      out.put(clearCode, bits);
+	      std::fill(hashKey.begin(), hashKey.end(), -1);
+	      nextCode = firstCode;
+	      bits = 9;
+	    }
+	    else if(nextCode > (1 << bits) - 1) bits++;
+	  }
+	}
+
+	out.put(endCode, bits);
+	out.flush();
+      }
+
+#ifdef INCLUDE_ZLIB
+      // compress 'size' bytes into a zlib stream (as libTIFF's Deflate codec)
+      inline bool deflateChunk(const unsigned char* src, size_t size, std::vector<unsigned char>& dst)
+      {
+	uLongf length = compressBound(size);
+	dst.resize(length);
+	if(compress2(&dst[0], &length, src, size, Z_DEFAULT_COMPRESSION) != Z_OK) return false;
+	dst.resize(length);
+	return true;
+      }
+#endif
+
+
+      //////////////////////////////////////////////////////
+      // Writes the header of a contiguous TIFF image,    //
+      // and encodes it one band of rows at a time.  A    //
+      // band spans one or more rows of strips or tiles;  //
+      // with raw compression all its strips/tiles are    //
+      // compressed in parallel and then written in order //
+      // with TIFFWriteRawStrip/Tile.  Otherwise (Deflate //
+      // without zlib) libTIFF encodes every strip/tile.  //
+      //////////////////////////////////////////////////////
+      class bandWriter {
+      public:
+	bandWriter(TIFF* fp, uint32 width, uint32 height, unsigned int channels, const ::io::tif::options& opt) : _fp(fp), _width(width), _height(height), _compressionType(opt.compressionType()), _tiled(opt.isTiled())
+	{
+	  _pixelBytes = channels * opt.bitsPerSample() / 8;
+	  _parallel = rawCompression(opt.compressionType());
+
+	  // chunk dimensions
+	  if(_tiled)
+	  {
+	    _chunkWidth = opt.tileWidth();
+	    _chunkHeight = opt.tileHeight();
+	  }
+	  else
+	  {
+	    _chunkWidth = width;
+	    _chunkHeight = (opt.rowsPerStrip() != 0) ? opt.rowsPerStrip() : std::max<size_t>((256 * 1024) / rowBytes(), 1);
+	    _chunkHeight = std::min(_chunkHeight, height);
+	  }
+
+	  // create header
+	  int headerSuccess = 1;
+	  headerSuccess &= TIFFSetField(fp, TIFFTAG_SAMPLESPERPIXEL, (uint16)(channels));
+	  headerSuccess &= TIFFSetField(fp, TIFFTAG_IMAGEWIDTH, (uint32)(width));
+	  headerSuccess &= TIFFSetField(fp, TIFFTAG_IMAGELENGTH, (uint32)(height));
+	  headerSuccess &= TIFFSetField(fp, TIFFTAG_SAMPLEFORMAT, (uint16)(opt.sampleFormat()));
+	  headerSuccess &= TIFFSetField(fp, TIFFTAG_BITSPERSAMPLE, (uint16)(opt.bitsPerSample()));
+	  headerSuccess &= TIFFSetField(fp, TIFFTAG_COMPRESSION, (uint16)(opt.compressionType()));
+	  headerSuccess &= TIFFSetField(fp, TIFFTAG_PLANARCONFIG, PLANARCONFIG_CONTIG);
+	  headerSuccess &= TIFFSetField(fp, TIFFTAG_ORIENTATION, ORIENTATION_TOPLEFT);
+	  if(_tiled)
+	  {
+	    headerSuccess &= TIFFSetField(fp, TIFFTAG_TILEWIDTH, _chunkWidth);
+	    headerSuccess &= TIFFSetField(fp, TIFFTAG_TILELENGTH, _chunkHeight);
+	  }
+	  else headerSuccess &= TIFFSetField(fp, TIFFTAG_ROWSPERSTRIP, _chunkHeight);
+
+	  if(headerSuccess != 0x01) throw customException("TIFF exporter failed to write header.");
+
+	  // band: enough rows of chunks to keep all threads busy
+	  _across = (width + _chunkWidth - 1) / _chunkWidth;
+	  _bandHeight = _chunkHeight * (_parallel ? std::max<uint32>(64 / _across, 1) : 1);
+	  _band.resize((size_t)(_bandHeight) * rowBytes());
+	}
+
+	////////////////
+	// Inspectors //
+	////////////////
+	uint32 bandHeight(void) const   { return _bandHeight; }
+	size_t rowBytes(void) const     { return (size_t)(_width) * _pixelBytes; }
+
+	// row r of the band (to be filled by the caller)
+	unsigned char* row(uint32 r)    { return &_band[r * rowBytes()]; }
+
+	/////////////
+	// Methods //
+	/////////////
+
+	// encode and write the first 'rows' rows of the band as image rows [y0, y0+rows)
+	void write(uint32 y0, uint32 rows)
+	{
+	  int count = _across * ((rows + _chunkHeight - 1) / _chunkHeight);
+	  uint32 first = (y0 / _chunkHeight) * _across;
+
+	  if(_chunk.size() < (size_t)(count)) { _chunk.resize(count); _packed.resize(count); }
+	  std::vector<const unsigned char*> data(count);
+	  std::vector<size_t> size(count);
+
+	  // gather (and compress) strips/tiles
+#pragma omp parallel for schedule(dynamic) if(_parallel)
+	  for(int i=0; i < count; i++)
+	  {
+	    uint32 x0 = (i % _across) * _chunkWidth;
+	    uint32 r0 = (i / _across) * _chunkHeight;
+	    uint32 chunkRows = std::min(_chunkHeight, rows - r0);
+
+	    // strips are contiguous in the band
+	    if(!_tiled)
+	    {
+	      data[i] = row(r0);
+	      size[i] = chunkRows * rowBytes();
+	    }
+
+	    // tiles are copied and padded to full size
+	    else
+	    {
+	      size_t tileRowBytes = (size_t)(_chunkWidth) * _pixelBytes;
+	      size_t bytes = std::min(_chunkWidth, _width - x0) * _pixelBytes;
+	      _chunk[i].assign(_chunkHeight * tileRowBytes, 0);
+	      for(uint32 r=0; r < chunkRows; r++)
+		std::memcpy(&_chunk[i][r * tileRowBytes], row(r0 + r) + x0 * _pixelBytes, bytes);
+
+	      data[i] = &_chunk[i][0];
+	      size[i] = _chunk[i].size();
+	    }
+
+	    if(_compressionType == ::io::tif::LZW)
+	    {
+	      lzwChunk(data[i], size[i], _packed[i]);
+	      size[i] = _packed[i].size();
+	      data[i] = &_packed[i][0];
+	    }
+
+#ifdef INCLUDE_ZLIB
+	    if(_compressionType == ::io::tif::DEFLATE)
+	    {
+	      size[i] = deflateChunk(data[i], size[i], _packed[i]) ? _packed[i].size() : 0;     // 0: failed
+	      data[i] = &_packed[i][0];
+	    }
+#endif
+	  }
+
+	  // write in order
+	  for(int i=0; i < count; i++)
+	  {
+	    tdata_t ptr = (tdata_t)(const_cast<unsigned char*>(data[i]));
+	    tsize_t result = -1;
+
+	    if(size[i] != 0)
+	    {
+	      if(_parallel) result = _tiled ? TIFFWriteRawTile(_fp, first + i, ptr, size[i]) : TIFFWriteRawStrip(_fp, first + i, ptr, size[i]);
+	      else result = _tiled ? TIFFWriteEncodedTile(_fp, first + i, ptr, size[i]) : TIFFWriteEncodedStrip(_fp, first + i, ptr, size[i]);
+	    }
+
+	    if(result == -1) throw customException("TIFF exporter failed to write to file.");
+	  }
+	}
+
+      private:
+	//////////////////////////
+	// Private Data Members //
+	//////////////////////////
+	TIFF* _fp;
+	uint32 _width, _height, _chunkWidth, _chunkHeight, _across, _bandHeight;
+	::io::tif::compression _compressionType;
+	bool _tiled, _parallel;
+	size_t _pixelBytes;
+	std::vector<unsigned char> _band;
+	std::vector< std::vector<unsigned char> > _chunk, _packed;
+      };
+
 } // end ::io::tif::detail namespace
 
 
-#endif /* _BUFFER2D_TIF_DETAIL_H_ */
+#endif /* _BUFFER2DIO_TIF_DETAIL_H_ */
@@ -7,7 +7,14 @@
 #ifndef _BUFFER2DIO_TIF_H_
 #define _BUFFER2DIO_TIF_H_
 
+#include <vector>
+#include <cstring>
+#include <algorithm>
+#include <stdint.h>
+#include <boost/scoped_ptr.hpp>
+
 #include "exceptions.h"
+#include "buffer2dIO.util.h"
 #include "buffer2dIO.tif.options.h"
 
 #ifdef INCLUDE_TIFF
@@ -17,8 +24,11 @@ extern "C" {
   #include "tiffio.h"
 }
 
+#ifdef INCLUDE_ZLIB
+  #include <zlib.h>
+#endif
+
 #include "offset_iterator.h"
-#include "buffer2dIO.tif.detail.h"
 
 #endif /* INCLUDE_TIFF */
 
@@ -28,19 +38,37 @@ namespace io {
 #ifndef INCLUDE_TIFF
 
     template<typename Buffer, typename C>
-      void _export(const string& filename, const Buffer& buf, float pad=0.0f, const options& opt=options()) { throw unsupportedFormat(); }
+      void _export(const string&, const Buffer&, float = 0.0f, const options& = options()) { throw unsupportedFormat(); }
 
     template<typename Buffer, typename C>
-      void _import(const string& filename, Buffer& buf, float pad=0.0f) { throw unsupportedFormat(); }
+      void _import(const string&, Buffer&, float = 0.0f) { throw unsupportedFormat(); }
+
+    inline ::io::util::headerInfo _probe(const string&) { throw unsupportedFormat(); }
+
+    class reader : public ::io::util::scanlineReader {
+    public:
+      explicit reader(const string&) { throw unsupportedFormat(); }
+      void readRow(float*) {}
+    };
+
+    class writer : public ::io::util::scanlineWriter {
+    public:
+      writer(const string&, size_t, size_t, unsigned int, const options& = options()) { throw unsupportedFormat(); }
+      void writeRow(const float*) {}
+      void finish(void) {}
+    };
 
 
 #else /* INCLUDE_TIFF */
 #include "buffer2dIO.tif.detail.h"
 
 
-    /////////////////
-    // Export TIFF //
-    /////////////////
+    /////////////////////////////////////////////
+    // Export TIFF                             //
+    //                                         //
+    // Written in strips of opt.rowsPerStrip() //
+    // rows, or in tiles; see bandWriter.      //
+    /////////////////////////////////////////////
     template<typename Buffer, typename C>
       void _export(const string& filename, const Buffer& buf, float pad=0.0f, const options& opt=options())
     {
@@ -55,48 +83,37 @@ namespace io {
       TIFF *fp = TIFFOpen(filename.c_str(), "w");
       if(!fp) throw fileNotFound(filename, "writing");
 
-      // create header
-      int headerSuccess = 1;
-      headerSuccess &= TIFFSetField(fp, TIFFTAG_SAMPLESPERPIXEL, (uint16)(numChannels));
-      headerSuccess &= TIFFSetField(fp, TIFFTAG_IMAGEWIDTH, (uint32)(buf.width()));
-      headerSuccess &= TIFFSetField(fp, TIFFTAG_IMAGELENGTH, (uint32)(buf.height()));
-      headerSuccess &= TIFFSetField(fp, TIFFTAG_SAMPLEFORMAT, (uint16)(opt.sampleFormat()));
-      headerSuccess &= TIFFSetField(fp, TIFFTAG_BITSPERSAMPLE, (uint16)(opt.bitsPerSample()));
-      headerSuccess &= TIFFSetField(fp, TIFFTAG_COMPRESSION, (uint16)(opt.compressionType()));
-      headerSuccess &= TIFFSetField(fp, TIFFTAG_PLANARCONFIG, PLANARCONFIG_CONTIG);
-      headerSuccess &= TIFFSetField(fp, TIFFTAG_ROWSPERSTRIP, 1);
-      headerSuccess &= TIFFSetField(fp, TIFFTAG_ORIENTATION, ORIENTATION_TOPLEFT);
-      
-      if(headerSuccess != 0x01) throw customException("TIFF exporter failed to write header.");
-
-      // Allocate memory
-      tdata_t buffer = _TIFFmalloc(buf.width() * numChannels * opt.bitsPerSample() / 8);
-      if(buffer == NULL) 
-	throw customException("TIFF exporter failed to allocate necessary write buffers.");
-
-      // Pass data to libTIFF
-      typename Buffer::const_iterator scan_itr = buf.begin();
-      for(unsigned int y=0; y < buf.height(); y++, scan_itr+=buf.width())
-      {
-	// convert
-	detail::convertPixelToFlat<typename Buffer::const_iterator, C>(scan_itr, scan_itr+buf.width(), buffer, numChannels, opt.sampleFormat(), opt.bitsPerSample(), pad);
+      try {
+	detail::bandWriter writer(fp, buf.width(), buf.height(), numChannels, opt);
 
-	// write
-	if(TIFFWriteScanline(fp, buffer, (uint32)(y)) != 1)
-	  throw customException("TIFF exporter failed to write to file.");
-      }
+	// convert and write band per band
+	for(uint32 y0=0; y0 < buf.height(); y0 += writer.bandHeight())
+	{
+	  int rows = std::min<uint32>(writer.bandHeight(), buf.height() - y0);
 
-      // free memory
-      _TIFFfree(buffer);
+#pragma omp parallel for schedule(static)
+	  for(int r=0; r < rows; r++)
+	  {
+	    typename Buffer::const_iterator scan_itr = buf.begin() + (y0 + r) * buf.width();
+	    detail::convertPixelToFlat<typename Buffer::const_iterator, C>(scan_itr, scan_itr+buf.width(), writer.row(r), numChannels, opt.sampleFormat(), opt.bitsPerSample(), pad);
+	  }
+
+	  writer.write(y0, rows);
+	}
+      }
+      catch(...) { TIFFClose(fp); throw; }
 
       // close the tiff image
       TIFFClose(fp);
     }
 
 
-    /////////////////
-    // Import TIFF //
-    /////////////////
+    //////////////////////////////////////////////
+    // Import TIFF                              //
+    //                                          //
+    // Strips or tiles are decoded one band at  //
+    // a time; see bandReader.                  //
+    //////////////////////////////////////////////
     template<typename Buffer, typename C>
       void _import(const string& filename, Buffer& buf, const typename C::value_type& pad=0.0f)
     {
@@ -104,80 +121,182 @@ namespace io {
       TIFF *fp = TIFFOpen(filename.c_str(), "r");
       if(!fp) throw fileNotFound(filename, "reading");
 
-      // read the header
+      try {
+	detail::bandReader reader(fp);
+
+	// allocate memory
+	buf.resize(reader.width(), reader.height());
+
+	// determine number of channels
+	const C wrapper(*(buf.begin()));
+	unsigned int availableChannels = std::distance( wrapper.begin(), wrapper.end() );
+
+	for(uint32 y=0; y < buf.height(); y++)
+	{
+	  typename Buffer::iterator scan_itr = buf.begin() + y * buf.width();
+
+	  //   => Chunky config: scanline is stored with mixed channels
+	  if(!reader.separate())
+	    detail::convertFlatToPixel<typename Buffer::iterator, C>(reader.row(y), reader.channels(), scan_itr, scan_itr+buf.width(), reader.sampleFormat(), reader.bitsPerSample(), pad);
+
+	  //   => Separate config (uncommon): one plane per channel
+	  else
+	    for(unsigned int c=0; c < std::min(availableChannels, reader.channels()); c++)
+	      detail::convertFlatToPixel<offset_iterator<typename Buffer::iterator>, iteratorWrapper<typename C::value_type> >(reader.row(y, c), 1, offset_iterator<typename Buffer::iterator>(scan_itr, c), offset_iterator<typename Buffer::iterator>(scan_itr+buf.width(), c), reader.sampleFormat(), reader.bitsPerSample(), pad);
+	}
+
+	// pad channels missing in a separate config
+	if(reader.separate())
+	  for(unsigned int c=reader.channels(); c < availableChannels; c++)
+	    std::fill(offset_iterator<typename Buffer::iterator>(buf.begin(), c), offset_iterator<typename Buffer::iterator>(buf.end(), c), pad);
+      }
+      catch(...) { TIFFClose(fp); throw; }
+
+      // close the tiff image
+      TIFFClose(fp);
+    }
+
+
+
+    ///////////////////////////
+    // Probe the header only //
+    ///////////////////////////
+    inline ::io::util::headerInfo _probe(const string& filename)
+    {
+      TIFF* fp = TIFFOpen(filename.c_str(), "r");
+      if(!fp) throw fileNotFound(filename, "reading");
+
+      uint32_t width, height;
+      uint16_t channels, bitsPerSample, sampleFormat;
       int headerSuccess = 1;
-      uint32_t header_width, header_height;
-      uint16_t header_channels, header_bitsPerSample, header_config, header_sampleFormat;
+      headerSuccess &= TIFFGetField(fp, TIFFTAG_IMAGEWIDTH, &width);
+      headerSuccess &= TIFFGetField(fp, TIFFTAG_IMAGELENGTH, &height);
+      headerSuccess &= TIFFGetField(fp, TIFFTAG_BITSPERSAMPLE, &bitsPerSample);
+      if(TIFFGetField(fp, TIFFTAG_SAMPLESPERPIXEL, &channels) != 1) channels = 1;
+      if(TIFFGetField(fp, TIFFTAG_SAMPLEFORMAT, &sampleFormat) != 1) sampleFormat = 1;
+      TIFFClose(fp);
 
-      headerSuccess &= TIFFGetField(fp, TIFFTAG_IMAGEWIDTH, &header_width);
-      headerSuccess &= TIFFGetField(fp, TIFFTAG_IMAGELENGTH, &header_height);
-      headerSuccess &= TIFFGetField(fp, TIFFTAG_BITSPERSAMPLE, &header_bitsPerSample);
       if(headerSuccess != 0x01) throw customException("TIFF importer failed to read header.");
+      return ::io::util::headerInfo(width, height, channels, bitsPerSample, (sampleFormat == FLOAT));
+    }
 
-      if(TIFFGetField(fp, TIFFTAG_SAMPLESPERPIXEL, &header_channels) != 1) header_channels = 1;
-      if(TIFFGetField(fp, TIFFTAG_SAMPLEFORMAT, &header_sampleFormat) != 1) header_sampleFormat = 1;
-      if(TIFFGetField(fp, TIFFTAG_PLANARCONFIG, &header_config) != 1) header_config = PLANARCONFIG_CONTIG;
 
-      // allocate memory
-      buf.resize(header_width, header_height);
+    /////////////////////////////////////
+    // Scanline reader (backend of     //
+    // io::scanline_reader)            //
+    /////////////////////////////////////
+    class reader : public ::io::util::scanlineReader {
+    public:
+      explicit reader(const string& filename) : _y(0)
+      {
+	_fp = TIFFOpen(filename.c_str(), "r");
+	if(!_fp) throw fileNotFound(filename, "reading");
+
+	try { _reader.reset(new detail::bandReader(_fp)); }
+	catch(...) { TIFFClose(_fp); throw; }
 
-      tdata_t buffer = _TIFFmalloc(TIFFScanlineSize(fp));
-      if(buffer == NULL) 
-	throw customException("TIFF importer failed to allocate necessary read buffers.");
+	_width = _reader->width();
+	_height = _reader->height();
+	_channels = _reader->channels();
+	if(_reader->separate()) _plane.resize(_width);
+      }
 
+      ~reader(void) { _reader.reset(); TIFFClose(_fp); }
 
-      // decode scaneline per scanline based on header_config
-      //   => Chunky config
-      if(header_config == PLANARCONFIG_CONTIG)
+      void readRow(float* samples)
       {
-	// scanline is stored with mixed channels
-	typename Buffer::iterator scan_itr = buf.begin();
-	for(uint32 y=0; y < buf.height(); y++, scan_itr+=buf.width())
-	{
-	  // read
-	  if(TIFFReadScanline(fp, buffer, y) != 1) throw customException("TIFF importer failed to read scanline.");
-	  
-	  // convert
-	  detail::convertFlatToPixel<typename Buffer::iterator, C>(buffer, header_channels, scan_itr, scan_itr+buf.width(), static_cast<sample_format>(header_sampleFormat), header_bitsPerSample, pad);
-	}
+	// chunky: one row holds all channels
+	if(!_reader->separate())
+	  _convert(_reader->row(_y), _width * _channels, samples);
+
+	// separate: gather the row of every channel
+	else
+	  for(unsigned int c=0; c < _channels; c++)
+	  {
+	    _convert(_reader->row(_y, c), _width, &_plane[0]);
+	    for(size_t x=0; x < _width; x++)
+	      samples[x*_channels + c] = _plane[x];
+	  }
+
+	_y++;
       }
 
-      //   => Separate config (uncommon)
-      else if(header_config == PLANARCONFIG_SEPARATE)
+    private:
+      void _convert(const void* src, size_t count, float* dst) const
       {
-	// determine number of channels
-	const C wrapper(*(buf.begin()));
-	unsigned int availableChannels = std::distance( wrapper.begin(), wrapper.end() );
-      
-	// scanline is stored with seperated channels
-	for(uint16 c=0; c < availableChannels; c++)
-	{
-	  offset_iterator<typename Buffer::iterator> scan_itr(buf.begin(), c);
+	sample_format sampleFormat = _reader->sampleFormat();
+	unsigned int bitsPerSample = _reader->bitsPerSample();
+
+	if(sampleFormat == UINT && bitsPerSample == 8) ::io::util::convertSamples((const uint8_t*)(src), count, dst);
+	else if(sampleFormat == UINT && bitsPerSample == 16) ::io::util::convertSamples((const uint16_t*)(src), count, dst);
+	else if(sampleFormat == UINT && bitsPerSample == 32) ::io::util::convertSamples((const uint32_t*)(src), count, dst);
+	else if(sampleFormat == INT && bitsPerSample == 8) ::io::util::convertSamples((const int8_t*)(src), count, dst);
+	else if(sampleFormat == INT && bitsPerSample == 16) ::io::util::convertSamples((const int16_t*)(src), count, dst);
+	else if(sampleFormat == INT && bitsPerSample == 32) ::io::util::convertSamples((const int32_t*)(src), count, dst);
+	else if(sampleFormat == FLOAT && bitsPerSample == 32) ::io::util::convertSamples((const float*)(src), count, dst);
+	else if(sampleFormat == FLOAT && bitsPerSample == 64) ::io::util::convertSamples((const double*)(src), count, dst);
+	else throw customException("Unknown pixel format in TIF.");
+      }
 
-	  // if channel exists in TIFF, copy
-	  if(c < header_channels)
-	    for(uint32 y=0; y < buf.height(); y++, scan_itr+=buf.width())
-	    {
-	      // read scanline
-	      if(TIFFReadScanline(fp, buffer, y, c) != 1) throw customException("TIFF importer failed to read scanline.");
+      TIFF* _fp;
+      boost::scoped_ptr<detail::bandReader> _reader;
+      uint32 _y;
+      std::vector<float> _plane;
+    };
 
-	      // convert
-	      detail::convertFlatToPixel<offset_iterator<typename Buffer::iterator>, iteratorWrapper<typename C::value_type> >(buffer, 1, scan_itr, scan_itr+buf.width(), static_cast<sample_format>(header_sampleFormat), header_bitsPerSample, pad);	      
-	    }
 
-	  // else pad
-	  else std::fill(scan_itr, offset_iterator<typename Buffer::iterator>(buf.end(),c), pad);
-	}
+    /////////////////////////////////////
+    // Scanline writer (backend of     //
+    // io::scanline_writer)            //
+    /////////////////////////////////////
+    class writer : public ::io::util::scanlineWriter {
+    public:
+      writer(const string& filename, size_t width, size_t height, unsigned int channels, const options& opt=options()) : ::io::util::scanlineWriter(channels), _y(0), _height(height), _width(width), _opt(opt)
+      {
+	_fp = TIFFOpen(filename.c_str(), "w");
+	if(!_fp) throw fileNotFound(filename, "writing");
+
+	try { _writer.reset(new detail::bandWriter(_fp, width, height, channels, opt)); }
+	catch(...) { TIFFClose(_fp); throw; }
       }
 
-      //   => Unknown config
-      else throw customException("TIFF importer: unsupported planar config.");
+      ~writer(void) { _writer.reset(); if(_fp) TIFFClose(_fp); }
 
-      // close the tiff image
-      _TIFFfree(buffer);
-      TIFFClose(fp);
-    }
+      void writeRow(const float* samples)
+      {
+	size_t count = _width * _channels;
+	uint32 r = _y % _writer->bandHeight();
+	void* dst = _writer->row(r);
+
+	if(_opt.sampleFormat() == UINT && _opt.bitsPerSample() == 8) ::io::util::convertSamples(samples, count, (uint8_t*)(dst));
+	else if(_opt.sampleFormat() == UINT && _opt.bitsPerSample() == 16) ::io::util::convertSamples(samples, count, (uint16_t*)(dst));
+	else if(_opt.sampleFormat() == UINT && _opt.bitsPerSample() == 32) ::io::util::convertSamples(samples, count, (uint32_t*)(dst));
+	else if(_opt.sampleFormat() == INT && _opt.bitsPerSample() == 8) ::io::util::convertSamples(samples, count, (int8_t*)(dst));
+	else if(_opt.sampleFormat() == INT && _opt.bitsPerSample() == 16) ::io::util::convertSamples(samples, count, (int16_t*)(dst));
+	else if(_opt.sampleFormat() == INT && _opt.bitsPerSample() == 32) ::io::util::convertSamples(samples, count, (int32_t*)(dst));
+	else if(_opt.sampleFormat() == FLOAT && _opt.bitsPerSample() == 32) ::io::util::convertSamples(samples, count, (float*)(dst));
+	else if(_opt.sampleFormat() == FLOAT && _opt.bitsPerSample() == 64) ::io::util::convertSamples(samples, count, (double*)(dst));
+	else throw customException("Unknown pixel format in TIF.");
+
+	// band complete (or last row): encode
+	_y++;
+	if(r + 1 == _writer->bandHeight() || _y == _height) _writer->write(_y - r - 1, r + 1);
+      }
+
+      void finish(void)
+      {
+	_writer.reset();
+	TIFFClose(_fp);
+	_fp = NULL;
+      }
 
+    private:
+      TIFF* _fp;
+      boost::scoped_ptr<detail::bandWriter> _writer;
+      uint32 _y, _height;
+      size_t _width;
+      options _opt;
+    };
 
 #endif /* INCLUDE_TIFF */
 
@@ -12,7 +12,8 @@ namespace io {
 
     enum compression {
       NONE = 1,
-      LZW = 5
+      LZW = 5,
+      DEFLATE = 8
     };
 
     struct options {
@@ -22,7 +23,10 @@ namespace io {
       /////////////////
       options(const sample_format& format=FLOAT, unsigned int bits=32, const compression& compressionType=LZW) : _sampleFormat(format), 
                                               _bitsPerSample(bits),
-                                              _compressionType(compressionType)
+                                              _compressionType(compressionType),
+                                              _rowsPerStrip(0),
+                                              _tileWidth(0),
+                                              _tileHeight(0)
       {
 	checkOptions();
       }
@@ -32,7 +36,10 @@ namespace io {
       //////////////////////
       options(const options& src) : _sampleFormat(src._sampleFormat),
                                     _bitsPerSample(src._bitsPerSample),
-                                    _compressionType(src._compressionType)
+                                    _compressionType(src._compressionType),
+                                    _rowsPerStrip(src._rowsPerStrip),
+                                    _tileWidth(src._tileWidth),
+                                    _tileHeight(src._tileHeight)
       {
 	// Do nothing
       }
@@ -45,6 +52,31 @@ namespace io {
       unsigned int bitsPerSample(void) const { return _bitsPerSample; }
       compression compressionType(void) const { return _compressionType; }
 
+      unsigned int rowsPerStrip(void) const { return _rowsPerStrip; }      // 0: strips of about 256KB
+      bool isTiled(void) const { return _tileWidth != 0; }
+      unsigned int tileWidth(void) const { return _tileWidth; }
+      unsigned int tileHeight(void) const { return _tileHeight; }
+
+      //////////////
+      // Mutators //
+      //////////////
+      options& setRowsPerStrip(unsigned int rows)
+      {
+	_rowsPerStrip = rows;
+	_tileWidth = _tileHeight = 0;
+	return *this;
+      }
+
+      // tile dimensions must be multiples of 16 (TIFF 6.0)
+      options& setTiles(unsigned int tileWidth, unsigned int tileHeight)
+      {
+	if(tileWidth == 0 || tileHeight == 0 || tileWidth % 16 != 0 || tileHeight % 16 != 0)
+	  throw customException("TIFF options: tile dimensions must be non-zero multiples of 16.");
+	_tileWidth = tileWidth;
+	_tileHeight = tileHeight;
+	return *this;
+      }
+
     private:
       ////////////////////
       // Private Method //
@@ -66,6 +98,8 @@ namespace io {
       sample_format _sampleFormat;
       unsigned int _bitsPerSample;
       compression _compressionType;
+      unsigned int _rowsPerStrip;
+      unsigned int _tileWidth, _tileHeight;
     };
 
   } // end tif namespace
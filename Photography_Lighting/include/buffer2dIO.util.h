@@ -5,11 +5,19 @@
 #ifndef _BUFFER2DIO_UTIL_H_
 #define _BUFFER2DIO_UTIL_H_
 
+#include <cctype>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <string>
 #include <boost/limits.hpp>
+#include <boost/iterator/iterator_facade.hpp>
 #include <boost/mpl/logical.hpp>
 #include <boost/type_traits.hpp>
 #include <boost/iterator/iterator_traits.hpp>
 
+#include "Endian.h"
+
 namespace io {
   namespace util {
 
@@ -149,19 +157,217 @@ namespace io {
 	  unsigned int count=0;
 
 	  // copy & pad
-	  for(typename dst_wrapper::iterator type_itr=wrapper.begin(); type_itr != wrapper.end(); ++type_itr, ++src_itr, ++count)
+	  for(typename dst_wrapper::iterator type_itr=wrapper.begin(); type_itr != wrapper.end(); ++type_itr, ++count)
 	  {
 	    if(count < src_channels)
-	      *type_itr = convertor(*src_itr);
+	      *type_itr = convertor(*src_itr++);
 
 	    else 
 	      *type_itr = pad;
 	  }
+
+	  // skip channels that do not fit
+	  for(; count < src_channels; ++count)
+	    ++src_itr;
 	}
 
 	// Done.
       }
-      
+
+
+
+    /////////////////////////////////////////////////////
+    // Convert 'count' samples to another sample type  //
+    // (normalizing as pixelTypeConvertor does).       //
+    /////////////////////////////////////////////////////
+    template<typename S, typename D>
+      void convertSamples(S src, std::size_t count, D dst)
+      {
+	typedef pixelTypeConvertor<typename std::iterator_traits<S>::value_type, typename std::iterator_traits<D>::value_type> convertor_type;
+	convertor_type convertor;
+
+	for(std::size_t i=0; i < count; ++i, ++src, ++dst)
+	  *dst = convertor(*src);
+      }
+
+
+    /////////////////////////////////////////////////////
+    // Iterator over samples of type T stored at an    //
+    // arbitrary (possibly unaligned) address, e.g.,   //
+    // inside a memory mapped file.  Samples are       //
+    // optionally byte swapped when read.              //
+    /////////////////////////////////////////////////////
+    template<typename T>
+      class rawSampleIterator : public boost::iterator_facade< rawSampleIterator<T>, const T, boost::random_access_traversal_tag, T >
+    {
+    public:
+      rawSampleIterator(void) : _ptr(NULL), _swap(false) {}
+      rawSampleIterator(const void* ptr, bool swapBytes) : _ptr(static_cast<const char*>(ptr)), _swap(swapBytes) {}
+
+    private:
+      friend class boost::iterator_core_access;
+
+      bool equal(const rawSampleIterator<T>& other) const               { return _ptr == other._ptr; }
+      void increment(void)                                               { _ptr += sizeof(T); }
+      void decrement(void)                                               { _ptr -= sizeof(T); }
+      void advance(std::ptrdiff_t n)                                     { _ptr += n * (std::ptrdiff_t)(sizeof(T)); }
+      std::ptrdiff_t distance_to(const rawSampleIterator<T>& other) const { return (other._ptr - _ptr) / (std::ptrdiff_t)(sizeof(T)); }
+
+      T dereference(void) const
+      {
+	T value;
+	std::memcpy(&value, _ptr, sizeof(T));
+	return _swap ? ::endian::detail::swapOrder(value) : value;
+      }
+
+      const char* _ptr;
+      bool _swap;
+    };
+
+
+    /////////////////////////////////////////////////////
+    // Parse a PNM-style text header from memory.      //
+    // Mirrors the fscanf conversions previously used: //
+    // numbers skip leading white space, characters    //
+    // consume exactly one byte.                       //
+    /////////////////////////////////////////////////////
+    class headerReader {
+    public:
+      headerReader(const char* begin, const char* end) : _itr(begin), _end(end) {}
+
+      // offset of the first byte after the header
+      const char* position(void) const { return _itr; }
+
+      bool readChar(char& c)
+      {
+	if(_itr == _end) return false;
+	c = *_itr++;
+	return true;
+      }
+
+      // unsigned decimal only (strtoul would accept "-N" and wrap)
+      bool readNumber(unsigned long& value)
+      {
+	std::string token = _token();
+	if(token.empty() || !isdigit((unsigned char)(token[0]))) return false;
+	char* tokenEnd;
+	errno = 0;
+	value = strtoul(token.c_str(), &tokenEnd, 10);
+	return (*tokenEnd == '\0') && (errno != ERANGE);
+      }
+
+      bool readNumber(float& value)
+      {
+	std::string token = _token();
+	if(token.empty()) return false;
+	char* tokenEnd;
+	value = (float)(strtod(token.c_str(), &tokenEnd));
+	return (*tokenEnd == '\0');
+      }
+
+      void skipComment(char token='#')
+      {
+	while(_itr != _end && *_itr == token)
+	{
+	  while(_itr != _end && *_itr != '\n' && *_itr != '\r') ++_itr;
+	  if(_itr != _end) ++_itr;
+	}
+      }
+
+    private:
+      std::string _token(void)
+      {
+	while(_itr != _end && isspace((unsigned char)(*_itr))) ++_itr;
+	const char* start = _itr;
+	while(_itr != _end && !isspace((unsigned char)(*_itr))) ++_itr;
+	return std::string(start, _itr);
+      }
+
+      const char* _itr;
+      const char* _end;
+    };
+
+
+
+    /////////////////////////////////////////////////////
+    // result = width * height * channels * bytes;     //
+    // returns false if the product does not fit in a  //
+    // size_t (e.g., dimensions from a corrupt header) //
+    /////////////////////////////////////////////////////
+    inline bool imageBytes(unsigned long width, unsigned long height, unsigned int channels, size_t bytes, size_t& result)
+    {
+      const size_t maxSize = std::numeric_limits<size_t>::max();
+      if(width > maxSize || height > maxSize) return false;
+
+      size_t factors[4] = { width, height, channels, bytes };
+      result = 1;
+      for(int i=0; i < 4; i++)
+      {
+	if(factors[i] != 0 && result > maxSize / factors[i]) return false;
+	result *= factors[i];
+      }
+      return true;
+    }
+
+
+    /////////////////////////////////////////////////////
+    // Image properties read from a file header        //
+    // (without decoding any pixels).  'bitDepth' is   //
+    // the size of a decoded sample in bits.           //
+    /////////////////////////////////////////////////////
+    struct headerInfo {
+      headerInfo(std::size_t width=0, std::size_t height=0, unsigned int channels=0, unsigned int bitDepth=0, bool floatingPoint=false) : width(width), height(height), channels(channels), bitDepth(bitDepth), floatingPoint(floatingPoint) {}
+
+      std::size_t width, height;
+      unsigned int channels;
+      unsigned int bitDepth;
+      bool floatingPoint;
+    };
+
+
+
+    /////////////////////////////////////////////////////
+    // Format backends of io::scanline_reader and      //
+    // io::scanline_writer.  Rows are exchanged as     //
+    // width() * channels() interleaved float samples; //
+    // integer formats are normalized to [0,1].        //
+    /////////////////////////////////////////////////////
+    class scanlineReader {
+    public:
+      virtual ~scanlineReader(void) {}
+
+      std::size_t width(void) const     { return _width; }
+      std::size_t height(void) const    { return _height; }
+      unsigned int channels(void) const { return _channels; }
+
+      // decode the next row
+      virtual void readRow(float* samples) = 0;
+
+    protected:
+      scanlineReader(void) : _width(0), _height(0), _channels(0) {}
+
+      std::size_t _width, _height;
+      unsigned int _channels;
+    };
+
+
+    class scanlineWriter {
+    public:
+      virtual ~scanlineWriter(void) {}
+
+      unsigned int channels(void) const { return _channels; }
+
+      // encode the next row
+      virtual void writeRow(const float* samples) = 0;
+
+      // flush and close the file after the last row
+      virtual void finish(void) = 0;
+
+    protected:
+      scanlineWriter(unsigned int channels=0) : _channels(channels) {}
+
+      unsigned int _channels;
+    };
 
   } // end util namespace
 } // end io namespace
@@ -0,0 +1,81 @@
+#ifndef _BUFFER2DITERATOR_H_
+#define _BUFFER2DITERATOR_H_
+
+#include <cstddef>
+#include <iterator>
+#include <boost/utility/enable_if.hpp>
+#include <boost/type_traits/is_convertible.hpp>
+#include <boost/iterator/iterator_facade.hpp>
+
+////////////////////////////////////////////////////////////
+// Row-major iterator over the pixels of a buffer2d that  //
+// skips the padding at the end of each row (stride >     //
+// width).  T is the (possibly const) element type.       //
+////////////////////////////////////////////////////////////
+template<typename T>
+class buffer2d_iterator : public boost::iterator_facade< buffer2d_iterator<T>, T, std::random_access_iterator_tag >
+{
+ public:
+  typedef std::ptrdiff_t   difference_type;
+
+  buffer2d_iterator(void) : _ptr(NULL), _x(0), _width(0), _stride(0) {}
+  buffer2d_iterator(T* ptr, difference_type x, difference_type width, difference_type stride) : _ptr(ptr), _x(x), _width(width), _stride(stride) {}
+
+  template<typename S>
+    buffer2d_iterator(const buffer2d_iterator<S>& itr, typename boost::enable_if< boost::is_convertible<S*, T*> >::type* = 0) : _ptr(itr._ptr), _x(itr._x), _width(itr._width), _stride(itr._stride) {}
+
+  // address of the current element
+  T* base(void) const { return _ptr; }
+
+ private:
+  friend class boost::iterator_core_access;
+  template<typename S> friend class buffer2d_iterator;
+
+  template<typename S>
+    bool equal(const buffer2d_iterator<S>& other) const { return _ptr == other._ptr; }
+
+  void increment(void)
+  {
+    ++_ptr;
+    if(++_x == _width) { _ptr += _stride - _width; _x = 0; }
+  }
+
+  void decrement(void)
+  {
+    if(_x == 0) { _ptr -= _stride - _width; _x = _width; }
+    --_ptr;
+    --_x;
+  }
+
+  void advance(difference_type n)
+  {
+    if(n == 0) return;
+
+    difference_type x = _x + n;
+    difference_type rows = x / _width;
+    x -= rows * _width;
+    if(x < 0) { x += _width; rows--; }
+
+    _ptr += rows * _stride + (x - _x);
+    _x = x;
+  }
+
+  template<typename S>
+    difference_type distance_to(const buffer2d_iterator<S>& other) const
+  {
+    if(_stride == 0) return 0;
+    difference_type dx = other._x - _x;
+    difference_type rows = ((other._ptr - _ptr) - dx) / _stride;
+    return rows * _width + dx;
+  }
+
+  T& dereference(void) const { return *_ptr; }
+
+  //////////////////
+  // Data Members //
+  //////////////////
+  T* _ptr;
+  difference_type _x, _width, _stride;
+};
+
+#endif /* _BUFFER2DITERATOR_H_ */
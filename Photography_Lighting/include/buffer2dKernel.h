@@ -0,0 +1,116 @@
+#ifndef _BUFFER2DKERNEL_H_
+#define _BUFFER2DKERNEL_H_
+
+#include <cstddef>
+#include <numeric>
+#include <algorithm>
+#include <functional>
+#include <boost/static_assert.hpp>
+
+#include "color.h"
+#include "raises.h"
+#include "simd.h"
+
+//////////////////////////////////////////////////////
+// Functor binding a scalar as the right (or left)  //
+// operand of a binary operation.  Unlike           //
+// std::bind2nd, the scalar remains accessible, so  //
+// that kernels can dispatch on it.                 //
+//////////////////////////////////////////////////////
+template<typename Op, typename T, typename S=T>
+class buffer2dScalar {
+ public:
+  typedef T  argument_type;
+  typedef T  result_type;
+
+  explicit buffer2dScalar(const S& s, const Op& op=Op()) : _value(s), _op(op) {}
+
+  T operator()(const T& t) const { return _op(t, _value); }
+  const S& value(void) const     { return _value; }
+
+ private:
+  S _value;
+  Op _op;
+};
+
+template<typename Op, typename T, typename S=T>
+class buffer2dScalarLeft {
+ public:
+  typedef T  argument_type;
+  typedef T  result_type;
+
+  explicit buffer2dScalarLeft(const S& s, const Op& op=Op()) : _value(s), _op(op) {}
+
+  T operator()(const T& t) const { return _op(_value, t); }
+  const S& value(void) const     { return _value; }
+
+ private:
+  S _value;
+  Op _op;
+};
+
+
+//////////////////////////////////////////////////////
+// Element-wise kernels and reductions on the       //
+// contiguous storage of a buffer2d.  The generic   //
+// version uses the STL; specializations map the    //
+// common operations onto vectorized kernels.       //
+//////////////////////////////////////////////////////
+template<typename T>
+struct buffer2dKernel {
+  template<typename Op>
+    static void transform(const T* a, const T* b, T* dst, std::size_t n, Op op) { std::transform(a, a + n, b, dst, op); }
+  template<typename Op>
+    static void transform(const T* a, T* dst, std::size_t n, Op op)             { std::transform(a, a + n, dst, op); }
+
+  static const T* maxElement(const T* a, std::size_t n)  { return std::max_element(a, a + n); }
+  static const T* minElement(const T* a, std::size_t n)  { return std::min_element(a, a + n); }
+  static T sum(const T* a, std::size_t n)                { return std::accumulate(a, a + n, (T)(0)); }
+};
+
+
+//////////////////////////////////////////////////////
+// color<float>: operate on the flat r,g,b floats   //
+//////////////////////////////////////////////////////
+template<>
+struct buffer2dKernel< color<float> > {
+  typedef color<float> T;
+  BOOST_STATIC_ASSERT(sizeof(T) == 3 * sizeof(float));
+
+  // fallback
+  template<typename Op>
+    static void transform(const T* a, const T* b, T* dst, std::size_t n, Op op) { std::transform(a, a + n, b, dst, op); }
+  template<typename Op>
+    static void transform(const T* a, T* dst, std::size_t n, Op op)             { std::transform(a, a + n, dst, op); }
+
+  // buffer op buffer
+  static void transform(const T* a, const T* b, T* dst, std::size_t n, std::plus<T>)        { simd::add(_flat(a), _flat(b), _flat(dst), 3*n); }
+  static void transform(const T* a, const T* b, T* dst, std::size_t n, std::minus<T>)       { simd::subtract(_flat(a), _flat(b), _flat(dst), 3*n); }
+  static void transform(const T* a, const T* b, T* dst, std::size_t n, std::multiplies<T>)  { simd::multiply(_flat(a), _flat(b), _flat(dst), 3*n); }
+  static void transform(const T* a, const T* b, T* dst, std::size_t n, std::divides<T>)     { simd::divide(_flat(a), _flat(b), _flat(dst), 3*n); }
+
+  // buffer op scalar
+  static void transform(const T* a, T* dst, std::size_t n, const buffer2dScalar<std::plus<T>, T>& op)            { simd::addScalar(_flat(a), &op.value().r, _flat(dst), 3*n); }
+  static void transform(const T* a, T* dst, std::size_t n, const buffer2dScalar<std::minus<T>, T>& op)           { simd::subtractScalar(_flat(a), &op.value().r, _flat(dst), 3*n); }
+  static void transform(const T* a, T* dst, std::size_t n, const buffer2dScalar<std::multiplies<T>, T>& op)      { simd::multiplyScalar(_flat(a), &op.value().r, _flat(dst), 3*n); }
+  static void transform(const T* a, T* dst, std::size_t n, const buffer2dScalarLeft<std::multiplies<T>, T>& op)  { simd::multiplyScalar(_flat(a), &op.value().r, _flat(dst), 3*n); }
+  static void transform(const T* a, T* dst, std::size_t n, const buffer2dScalar<std::divides<T>, T>& op)         { simd::divideScalar(_flat(a), &op.value().r, _flat(dst), 3*n); }
+  static void transform(const T* a, T* dst, std::size_t n, const buffer2dScalar<raises<T, float>, T, float>& op)   { simd::power(_flat(a), op.value(), _flat(dst), 3*n); }
+  static void transform(const T* a, T* dst, std::size_t n, const buffer2dScalar<raises<T, double>, T, double>& op) { simd::power(_flat(a), (float)(op.value()), _flat(dst), 3*n); }
+
+  // reductions (max/min compare by color::length)
+  static const T* maxElement(const T* a, std::size_t n)  { return (n == 0) ? a : a + simd::maxLength(_flat(a), n); }
+  static const T* minElement(const T* a, std::size_t n)  { return (n == 0) ? a : a + simd::minLength(_flat(a), n); }
+  static T sum(const T* a, std::size_t n)
+  {
+    double s[3];
+    simd::channelSum(_flat(a), n, s);
+    return T(s[0], s[1], s[2]);
+  }
+
+ private:
+  static const float* _flat(const T* c)  { return reinterpret_cast<const float*>(c); }
+  static float* _flat(T* c)              { return reinterpret_cast<float*>(c); }
+};
+
+#endif /* _BUFFER2DKERNEL_H_ */
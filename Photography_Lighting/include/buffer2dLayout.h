@@ -0,0 +1,66 @@
+#ifndef _BUFFER2DLAYOUT_H_
+#define _BUFFER2DLAYOUT_H_
+
+#include <cstddef>
+#include <algorithm>
+
+#include "exceptions.h"
+
+/////////////////////////////////////////////////////////
+// Storage layout of a buffer2d: the alignment (bytes) //
+// of the first element and of every row, and an       //
+// optional minimum row stride (in elements).  The     //
+// default layout is packed: stride == width.          //
+/////////////////////////////////////////////////////////
+class buffer2dLayout {
+ public:
+  //////////////////
+  // Constructors //
+  //////////////////
+  explicit buffer2dLayout(size_t alignment=0, size_t minStride=0) : _alignment(alignment), _minStride(minStride)
+  {
+    // sanity check
+    if(_alignment & (_alignment - 1)) throw customException("buffer2dLayout: alignment must be a power of two.");
+  }
+
+  static buffer2dLayout packed(void)                  { return buffer2dLayout(); }
+  static buffer2dLayout aligned(size_t alignment=64)  { return buffer2dLayout(alignment); }
+
+  ////////////////
+  // Inspectors //
+  ////////////////
+  size_t alignment(void) const  { return _alignment; }
+  size_t minStride(void) const  { return _minStride; }
+  bool isPacked(void) const     { return (_alignment <= 1) && (_minStride == 0); }
+
+  /////////////
+  // Methods //
+  /////////////
+  template<typename T>
+    size_t stride(size_t width) const
+  {
+    size_t result = std::max(width, _minStride);
+
+    // round up such that every row starts aligned
+    if(_alignment > 1)
+    {
+      size_t step = _alignment / _gcd(_alignment, sizeof(T));
+      result = ((result + step - 1) / step) * step;
+    }
+
+    return result;
+  }
+
+  bool operator==(const buffer2dLayout& l) const { return (_alignment == l._alignment) && (_minStride == l._minStride); }
+  bool operator!=(const buffer2dLayout& l) const { return !(*this == l); }
+
+ private:
+  static size_t _gcd(size_t a, size_t b) { return (b == 0) ? a : _gcd(b, a % b); }
+
+  //////////////////
+  // Data Members //
+  //////////////////
+  size_t _alignment, _minStride;
+};
+
+#endif /* _BUFFER2DLAYOUT_H_ */
@@ -0,0 +1,122 @@
+#ifndef _BUFFER2DVIEW_H_
+#define _BUFFER2DVIEW_H_
+
+#include <cstddef>
+
+#include "buffer2d.h"
+#include "exceptions.h"
+
+/////////////////////////////////////////////////////////
+// Lightweight non-owning views on 2D data: a pointer, //
+// width, height and row stride (in elements).  A      //
+// buffer2d converts implicitly to a view; copying a   //
+// view never copies the underlying data.              //
+/////////////////////////////////////////////////////////
+
+template<typename T>
+class buffer2d_view {
+ public:
+  ///////////////
+  // type defs //
+  ///////////////
+  typedef T             value_type;
+  typedef T*            pointer;
+  typedef T&            reference;
+  typedef const T&      const_reference;
+  typedef size_t        size_type;
+
+  //////////////////
+  // Constructors //
+  //////////////////
+  buffer2d_view(void) : _data(NULL), _width(0), _height(0), _stride(0) {}
+  buffer2d_view(pointer data, size_type width, size_type height, size_type stride) : _data(data), _width(width), _height(height), _stride(stride) {}
+  buffer2d_view(buffer2d<T>& b) : _data(b.row(0)), _width(b.width()), _height(b.height()), _stride(b.stride()) {}
+
+  ////////////////
+  // Inspectors //
+  ////////////////
+  size_type width(void) const  { return _width; }
+  size_type height(void) const { return _height; }
+  size_type stride(void) const { return _stride; }
+  size_type size(void) const   { return _width * _height; }
+
+  bool empty(void) const { return (_width == 0) || (_height == 0); }
+
+  pointer   row(size_type y) const                      { return _data + y*_stride; }
+  reference operator()(size_type x, size_type y) const  { return _data[y*_stride + x]; }
+
+  /////////////
+  // Methods //
+  /////////////
+  buffer2d_view<T> subview(size_type x, size_type y, size_type width, size_type height) const
+  {
+    if(x + width > _width || y + height > _height) throw buffer2dIllegalSize();
+    return buffer2d_view<T>(&(*this)(x,y), width, height, _stride);
+  }
+
+  template<typename S>
+    void checkSize(const S& b) const { if(width() != b.width() || height() != b.height()) throw buffer2dIllegalSize(); }
+
+ private:
+  //////////////////////////
+  // Private Data Members //
+  //////////////////////////
+  pointer _data;
+  size_type _width, _height, _stride;
+};
+
+
+template<typename T>
+class const_buffer2d_view {
+ public:
+  ///////////////
+  // type defs //
+  ///////////////
+  typedef T             value_type;
+  typedef const T*      pointer;
+  typedef const T&      reference;
+  typedef const T&      const_reference;
+  typedef size_t        size_type;
+
+  //////////////////
+  // Constructors //
+  //////////////////
+  const_buffer2d_view(void) : _data(NULL), _width(0), _height(0), _stride(0) {}
+  const_buffer2d_view(pointer data, size_type width, size_type height, size_type stride) : _data(data), _width(width), _height(height), _stride(stride) {}
+  const_buffer2d_view(const buffer2d<T>& b) : _data(b.row(0)), _width(b.width()), _height(b.height()), _stride(b.stride()) {}
+  const_buffer2d_view(const buffer2d_view<T>& v) : _data(v.row(0)), _width(v.width()), _height(v.height()), _stride(v.stride()) {}
+
+  ////////////////
+  // Inspectors //
+  ////////////////
+  size_type width(void) const  { return _width; }
+  size_type height(void) const { return _height; }
+  size_type stride(void) const { return _stride; }
+  size_type size(void) const   { return _width * _height; }
+
+  bool empty(void) const { return (_width == 0) || (_height == 0); }
+
+  pointer   row(size_type y) const                      { return _data + y*_stride; }
+  reference operator()(size_type x, size_type y) const  { return _data[y*_stride + x]; }
+
+  /////////////
+  // Methods //
+  /////////////
+  const_buffer2d_view<T> subview(size_type x, size_type y, size_type width, size_type height) const
+  {
+    if(x + width > _width || y + height > _height) throw buffer2dIllegalSize();
+    return const_buffer2d_view<T>(&(*this)(x,y), width, height, _stride);
+  }
+
+  template<typename S>
+    void checkSize(const S& b) const { if(width() != b.width() || height() != b.height()) throw buffer2dIllegalSize(); }
+
+ private:
+  //////////////////////////
+  // Private Data Members //
+  //////////////////////////
+  pointer _data;
+  size_type _width, _height, _stride;
+};
+
+#endif /* _BUFFER2DVIEW_H_ */
@@ -0,0 +1,76 @@
+#ifndef _FLASHPIPELINE_H_
+#define _FLASHPIPELINE_H_
+
+#include "image.h"
+#include "bilateral.h"
+
+namespace flash {
+
+  /////////////////////////////////////////////////////
+  // Parameters of the flash/no-flash pipeline       //
+  // (Petschnigg et al. 2004).  Defaults match the   //
+  // individual stages of bilateral_filtering.       //
+  /////////////////////////////////////////////////////
+  struct options {
+  public:
+    /////////////////
+    // Constructor //
+    /////////////////
+    options(void) : nrKernel(5.0f, 0.001f, 3),
+                    baseKernel(5.0f, 0.05f, 3),
+                    detailEpsilon(0.02f),
+                    maskThreshold(0.95f),
+                    whiteBalance(true),
+                    whiteBalanceThreshold(0.02f),
+                    tileBytes(256 * 1024)
+    {
+      // Do nothing
+    }
+
+    /////////////////
+    // Public Data //
+    /////////////////
+    ::filter::bilateralKernel nrKernel;      // joint bilateral of the no-flash image
+    ::filter::bilateralKernel baseKernel;    // bilateral of the flash image
+    float detailEpsilon;                     // detail = (F + e) / (F_base + e)
+    float maskThreshold;                     // shadow/specularity mask threshold
+    bool whiteBalance;
+    float whiteBalanceThreshold;
+    unsigned int tileBytes;                  // working set per tile (per thread)
+  };
+
+
+  /////////////////////////////////////////////////////
+  // Optional full-size intermediates.  A NULL       //
+  // pointer means the intermediate is never         //
+  // materialized.                                   //
+  /////////////////////////////////////////////////////
+  struct intermediates {
+  public:
+    intermediates(image* nrImage=NULL, image* detailImage=NULL, image* maskImage=NULL) : nr(nrImage), detail(detailImage), mask(maskImage) {}
+
+    image* nr;
+    image* detail;
+    image* mask;
+  };
+
+
+  /////////////////////////////////////////////////////
+  // Fused flash/no-flash pipeline.  The NR, detail, //
+  // mask and final images are computed tile by tile //
+  // in cache-sized blocks of rows; only 'result' is //
+  // written to full-size memory (plus any requested //
+  // intermediates).  White balancing takes a second //
+  // pass over 'result' only.                        //
+  /////////////////////////////////////////////////////
+  void pipeline(const image& noflash, const image& flashImage, image& result, const options& opt=options(), const intermediates& dump=intermediates());
+
+} // end flash namespace
+
+
+////////////////////
+// Inline Methods //
+////////////////////
+#include "flashPipeline.inline.h"
+
+#endif /* _FLASHPIPELINE_H_ */
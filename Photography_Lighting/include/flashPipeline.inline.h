@@ -0,0 +1,126 @@
+////////////////////////////////////////
+// Inline Methods for flashPipeline.h //
+////////////////////////////////////////
+
+#include <vector>
+#include <cmath>
+#include <algorithm>
+#include "exceptions.h"
+
+namespace flash {
+
+//////////////////////////////
+// pipeline                 //
+//////////////////////////////
+inline void pipeline(const image& noflash, const image& flashImage, image& result, const options& opt, const intermediates& dump)
+{
+  // sanity check
+  if(noflash.width() != flashImage.width() || noflash.height() != flashImage.height()) throw buffer2dIllegalSize();
+  if(&result == &noflash || &result == &flashImage) throw customException("flash pipeline: result cannot alias an input image.");
+
+  const int width = noflash.width();
+  const int height = noflash.height();
+
+  // allocate outputs
+  result.resize(width, height);
+  if(dump.nr) dump.nr->resize(width, height);
+  if(dump.detail) dump.detail->resize(width, height);
+  if(dump.mask) dump.mask->resize(width, height);
+  if(noflash.empty()) return;
+
+  // tile size: two tile buffers (NR & base) per thread
+  int tileRows = opt.tileBytes / (2 * width * sizeof(color<float>));
+  tileRows = std::max(1, std::min(tileRows, height));
+  const int numTiles = (height + tileRows - 1) / tileRows;
+
+  // per tile white balance statistics
+  std::vector<double> wbSum(3 * numTiles, 0.0);
+  std::vector<long> wbCount(3 * numTiles, 0);
+
+  const color<float> e(opt.detailEpsilon);
+  const color<float> t(opt.maskThreshold);
+  const color<float> m1(1.0f);
+  const float wbThreshold = opt.whiteBalanceThreshold;
+
+#pragma omp parallel
+  {
+    std::vector< color<float> > nrTile(tileRows * width);
+    std::vector< color<float> > baseTile(tileRows * width);
+
+#pragma omp for schedule(dynamic)
+    for(int tile=0; tile < numTiles; tile++)
+    {
+      const int y0 = tile * tileRows;
+      const int y1 = std::min(y0 + tileRows, height);
+
+      // NR: joint bilateral of the no-flash image, guided by the flash image
+      ::filter::detail::bilateralRows(noflash, flashImage, opt.nrKernel, y0, y1, image_view(&nrTile[0], width, y1 - y0, width));
+
+      // large scale of the flash image
+      ::filter::detail::bilateralRows(flashImage, flashImage, opt.baseKernel, y0, y1, image_view(&baseTile[0], width, y1 - y0, width));
+
+      // detail, mask & final per pixel
+      double* sum = &wbSum[3*tile];
+      long* count = &wbCount[3*tile];
+
+      for(int y=y0; y < y1; y++)
+      {
+        const color<float>* nr = &nrTile[(y - y0) * width];
+        const color<float>* base = &baseTile[(y - y0) * width];
+        const color<float>* A = &noflash(0, y);
+        const color<float>* F = &flashImage(0, y);
+        color<float>* out = &result(0, y);
+
+        for(int x=0; x < width; x++)
+        {
+          color<float> detail = (F[x] + e) / (base[x] + e);
+          color<float> mask = (F[x] - A[x] < t) ? m1 : color<float>(0.0f);
+          color<float> finalPixel = (m1 - mask) * nr[x] * detail + mask * A[x];
+          out[x] = finalPixel;
+
+          // white balance statistics
+          color<float> dp = F[x] - finalPixel;
+          for(unsigned int c=0; c < 3; c++)
+            if(fabs(finalPixel[c]) >= wbThreshold && dp[c] >= wbThreshold)
+            {
+              sum[c] += finalPixel[c] / dp[c];
+              count[c]++;
+            }
+
+          // intermediates (debugging only)
+          if(dump.nr) (*dump.nr)(x, y) = nr[x];
+          if(dump.detail) (*dump.detail)(x, y) = detail;
+          if(dump.mask) (*dump.mask)(x, y) = mask;
+        }
+      }
+    }
+  }
+
+  // white balance (second pass over the result only)
+  if(!opt.whiteBalance) return;
+
+  color<float> c(1.0f);
+  for(unsigned int ch=0; ch < 3; ch++)
+  {
+    double sum = 0.0;
+    long count = 0;
+    for(int tile=0; tile < numTiles; tile++)
+    {
+      sum += wbSum[3*tile + ch];
+      count += wbCount[3*tile + ch];
+    }
+    if(count > 0) c[ch] = sum / count;
+  }
+
+#pragma omp parallel for schedule(static)
+  for(int y=0; y < height; y++)
+  {
+    color<float>* out = &result(0, y);
+    for(int x=0; x < width; x++)
+      out[x] /= c;
+  }
+
+  // Done.
+}
+
+} // end flash namespace
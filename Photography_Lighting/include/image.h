@@ -3,7 +3,11 @@
 
 #include "color.h"
 #include "buffer2d.h"
+#include "buffer2dView.h"
 
 typedef buffer2d<color<float> >  image;
 
+typedef buffer2d_view<color<float> >        image_view;
+typedef const_buffer2d_view<color<float> >  const_image_view;
+
 #endif /* _COLOR_H_ */
@@ -5,12 +5,29 @@
 
 #include "image.h"
 #include "buffer2dIO.h"
+#include "imageIO.registry.h"
 
 namespace io {
 
+  //////////////////////////////////////////////
+  // Image properties from the file header:   //
+  // the format name (see formatRegistry) and //
+  // size, channels and sample type.          //
+  //////////////////////////////////////////////
+  struct imageInfo : public ::io::util::headerInfo {
+    imageInfo(const std::string& format, const ::io::util::headerInfo& header) : ::io::util::headerInfo(header), format(format) {}
+
+    std::string format;
+  };
+
+  imageInfo probeImage(const std::string& filename);
+
   void importImage(const std::string& filename, image& result);
   void exportImage(const std::string& filename, const image& source);
 
+  void importImage(const std::string& filename, planar_rgb_image& result);
+  void exportImage(const std::string& filename, const planar_rgb_image& source);
+
 }  // end io namespace
 
 
@@ -5,21 +5,18 @@
 
 namespace io {
 
+namespace detail {
+
 /////////////////
 // importImage //
 /////////////////
-inline void importImage(const std::string& filename, image& result)
+template<typename Buffer>
+inline void importImage(const std::string& filename, Buffer& result, void (*imageFormat::*importer)(const std::string&, Buffer&))
 {
-  // determine type based on extension
-  std::string ext = filename.substr(filename.size() - 3, 3);
-  
-  if(ext == "PFM" || ext == "pfm") importPFM(filename, result);
-  else if(ext == "PPM" || ext == "ppm" || ext == "PNM" || ext == "pnm") importPPM(filename, result);
-  else if(ext == "EXR" || ext == "exr") importEXR(filename, result);
-  else if(ext == "PNG" || ext == "png") importPNG(filename, result);
-  else if(ext == "JPG" || ext == "jpg" || ext == "JPEG" || ext == "jpeg") importJPG(filename, result);
-  else if(ext == "TIF" || ext == "tif" || ext == "TIFF" || ext == "tiff") importTIF(filename, result);
-  else throw unsupportedFormat();
+  // determine type based on content, or else, extension
+  const imageFormat& format = formatRegistry::instance().forReading(filename);
+  if(!(format.*importer)) throw unsupportedFormat();
+  (format.*importer)(filename, result);
   
   // done.
 }
@@ -28,22 +25,37 @@ inline void importImage(const std::string& filename, image& result)
 /////////////////
 // exportImage //
 /////////////////
-inline void exportImage(const std::string& filename, const image& source)
+template<typename Buffer>
+inline void exportImage(const std::string& filename, const Buffer& source, void (*imageFormat::*exporter)(const std::string&, const Buffer&))
 {
   // determine type based on extension
-  std::string ext = filename.substr(filename.size() - 3, 3);
-  
-  if(ext == "PFM" || ext == "pfm") exportPFM(filename, source);
-  else if(ext == "PPM" || ext == "ppm" || ext == "PNM" || ext == "pnm") exportPPM(filename, source);
-  else if(ext == "EXR" || ext == "exr") exportEXR(filename, source);
-  else if(ext == "PNG" || ext == "png") exportPNG(filename, source);
-  else if(ext == "JPG" || ext == "jpg" || ext == "JPEG" || ext == "jpeg") exportJPG(filename, source);
-  else if(ext == "TIF" || ext == "tif" || ext == "TIFF" || ext == "tiff") exportTIF(filename, source);
-  else throw unsupportedFormat();
+  const imageFormat& format = formatRegistry::instance().forWriting(filename);
+  if(!(format.*exporter)) throw unsupportedFormat();
+  (format.*exporter)(filename, source);
   
   // done.
 }
 
+} // end detail namespace
+
+
+////////////////
+// probeImage //
+////////////////
+inline imageInfo probeImage(const std::string& filename)
+{
+  // only the header is read; no pixels are decoded
+  const imageFormat& format = formatRegistry::instance().forReading(filename);
+  if(!format.probe) throw unsupportedFormat();
+  return imageInfo(format.name, format.probe(filename));
+}
+
+
+inline void importImage(const std::string& filename, image& result)                 { detail::importImage(filename, result, &imageFormat::importImage); }
+inline void exportImage(const std::string& filename, const image& source)           { detail::exportImage(filename, source, &imageFormat::exportImage); }
+inline void importImage(const std::string& filename, planar_rgb_image& result)      { detail::importImage(filename, result, &imageFormat::importPlanar); }
+inline void exportImage(const std::string& filename, const planar_rgb_image& source) { detail::exportImage(filename, source, &imageFormat::exportPlanar); }
+
 
 } // end io namespace
 
@@ -0,0 +1,217 @@
+/////////////////////////////////////////////////////
+// Registry of image formats used by importImage   //
+// and exportImage.  Files are identified by their //
+// magic bytes, falling back to the (case          //
+// insensitive) extension; exporters are selected  //
+// by extension.  Additional formats can be added  //
+// with registerFormat() (before the registry is   //
+// used concurrently).                             //
+/////////////////////////////////////////////////////
+
+#ifndef _IMAGEIO_REGISTRY_H_
+#define _IMAGEIO_REGISTRY_H_
+
+#include <cstdio>
+#include <cctype>
+#include <string>
+#include <vector>
+#include <boost/utility.hpp>
+
+#include "image.h"
+#include "planarImage.h"
+#include "exceptions.h"
+#include "buffer2dIO.h"
+
+namespace io {
+
+  //////////////////////////////////////////////////
+  // A format: its magic bytes test, extensions   //
+  // and (header-only) probe, importers and       //
+  // exporters.  Unused entries may be NULL.      //
+  //////////////////////////////////////////////////
+  struct imageFormat {
+    typedef bool (*match_function)(const unsigned char* magic, size_t size);
+    typedef ::io::util::headerInfo (*probe_function)(const std::string& filename);
+    typedef void (*import_function)(const std::string& filename, image& result);
+    typedef void (*export_function)(const std::string& filename, const image& source);
+    typedef void (*import_planar_function)(const std::string& filename, planar_rgb_image& result);
+    typedef void (*export_planar_function)(const std::string& filename, const planar_rgb_image& source);
+
+    /////////////////
+    // Constructor //
+    /////////////////
+    // 'extensions' is a comma separated list (lower case, without '.'), e.g., "jpg,jpeg"
+    imageFormat(const std::string& name, const std::string& extensions, match_function match, probe_function probe,
+		import_function importImage, export_function exportImage,
+		import_planar_function importPlanar=NULL, export_planar_function exportPlanar=NULL) : name(name), match(match), probe(probe),
+													importImage(importImage), exportImage(exportImage),
+													importPlanar(importPlanar), exportPlanar(exportPlanar)
+    {
+      std::string::size_type start = 0, end;
+      do
+      {
+	end = extensions.find(',', start);
+	this->extensions.push_back(extensions.substr(start, (end == std::string::npos) ? std::string::npos : end - start));
+	start = end + 1;
+      } while(end != std::string::npos);
+    }
+
+    bool hasExtension(const std::string& ext) const
+    {
+      for(std::vector<std::string>::const_iterator itr=extensions.begin(); itr != extensions.end(); ++itr)
+	if(*itr == ext) return true;
+      return false;
+    }
+
+    //////////////////
+    // Data Members //
+    //////////////////
+    std::string name;
+    std::vector<std::string> extensions;
+    match_function match;
+    probe_function probe;
+    import_function importImage;
+    export_function exportImage;
+    import_planar_function importPlanar;
+    export_planar_function exportPlanar;
+  };
+
+
+  namespace detail {
+
+    // number of bytes passed to imageFormat::match
+    const size_t magicSize = 16;
+
+    ////////////////////////////////////////////////
+    // Built-in formats: magic bytes and adaptors //
+    // from the format specific IO functions.     //
+    ////////////////////////////////////////////////
+    struct pfmFormat {
+      static bool match(const unsigned char* m, size_t n)  { return n >= 3 && m[0] == 'P' && (m[1] == 'F' || m[1] == 'f') && isspace(m[2]); }
+      static ::io::util::headerInfo probe(const std::string& filename)  { return pfm::_probe(filename); }
+      template<typename Buffer> static void load(const std::string& filename, Buffer& result)        { importPFM(filename, result); }
+      template<typename Buffer> static void save(const std::string& filename, const Buffer& source)  { exportPFM(filename, source); }
+    };
+
+    struct ppmFormat {
+      static bool match(const unsigned char* m, size_t n)  { return n >= 3 && m[0] == 'P' && (m[1] == '5' || m[1] == '6') && isspace(m[2]); }
+      static ::io::util::headerInfo probe(const std::string& filename)  { return ppm::_probe(filename); }
+      template<typename Buffer> static void load(const std::string& filename, Buffer& result)        { importPPM(filename, result); }
+      template<typename Buffer> static void save(const std::string& filename, const Buffer& source)  { exportPPM(filename, source); }
+    };
+
+    struct exrFormat {
+      static bool match(const unsigned char* m, size_t n)  { return n >= 4 && m[0] == 0x76 && m[1] == 0x2f && m[2] == 0x31 && m[3] == 0x01; }
+      static ::io::util::headerInfo probe(const std::string& filename)  { return exr::_probe(filename); }
+      template<typename Buffer> static void load(const std::string& filename, Buffer& result)        { importEXR(filename, result); }
+      template<typename Buffer> static void save(const std::string& filename, const Buffer& source)  { exportEXR(filename, source); }
+    };
+
+    struct pngFormat {
+      static bool match(const unsigned char* m, size_t n)  { return n >= 8 && m[0] == 0x89 && m[1] == 'P' && m[2] == 'N' && m[3] == 'G' && m[4] == 0x0d && m[5] == 0x0a && m[6] == 0x1a && m[7] == 0x0a; }
+      static ::io::util::headerInfo probe(const std::string& filename)  { return png::_probe(filename); }
+      template<typename Buffer> static void load(const std::string& filename, Buffer& result)        { importPNG(filename, result); }
+      template<typename Buffer> static void save(const std::string& filename, const Buffer& source)  { exportPNG(filename, source); }
+    };
+
+    struct jpgFormat {
+      static bool match(const unsigned char* m, size_t n)  { return n >= 3 && m[0] == 0xff && m[1] == 0xd8 && m[2] == 0xff; }
+      static ::io::util::headerInfo probe(const std::string& filename)  { return jpg::_probe(filename); }
+      template<typename Buffer> static void load(const std::string& filename, Buffer& result)        { importJPG(filename, result); }
+      template<typename Buffer> static void save(const std::string& filename, const Buffer& source)  { exportJPG(filename, source); }
+    };
+
+    struct tifFormat {
+      static bool match(const unsigned char* m, size_t n)  { return n >= 4 && ((m[0] == 'I' && m[1] == 'I' && m[2] == 42 && m[3] == 0) || (m[0] == 'M' && m[1] == 'M' && m[2] == 0 && m[3] == 42)); }
+      static ::io::util::headerInfo probe(const std::string& filename)  { return tif::_probe(filename); }
+      template<typename Buffer> static void load(const std::string& filename, Buffer& result)        { importTIF(filename, result); }
+      template<typename Buffer> static void save(const std::string& filename, const Buffer& source)  { exportTIF(filename, source); }
+    };
+
+    template<typename F>
+      imageFormat makeFormat(const std::string& name, const std::string& extensions)
+    {
+      return imageFormat(name, extensions, &F::match, &F::probe,
+			 &F::template load<image>, &F::template save<image>,
+			 &F::template load<planar_rgb_image>, &F::template save<planar_rgb_image>);
+    }
+
+  } // end detail namespace
+
+
+  //////////////////////////////////////////////////
+  // The registry.  Formats registered later take //
+  // precedence, such that built-in formats can   //
+  // be overridden.                               //
+  //////////////////////////////////////////////////
+  class formatRegistry : boost::noncopyable {
+  public:
+    static formatRegistry& instance(void)
+    {
+      static formatRegistry registry;
+      return registry;
+    }
+
+    void add(const imageFormat& format)  { _formats.push_back(format); }
+
+    // by content; NULL if not recognized
+    const imageFormat* findByContent(const std::string& filename) const
+    {
+      FILE* fp = fopen(filename.c_str(), "rb");
+      if(!fp) throw fileNotFound(filename, "reading");
+
+      unsigned char magic[detail::magicSize];
+      size_t size = fread(magic, 1, detail::magicSize, fp);
+      fclose(fp);
+
+      for(std::vector<imageFormat>::const_reverse_iterator itr=_formats.rbegin(); itr != _formats.rend(); ++itr)
+	if(itr->match && itr->match(magic, size)) return &(*itr);
+      return NULL;
+    }
+
+    // by extension; NULL if not recognized
+    const imageFormat* findByExtension(const std::string& filename) const
+    {
+      std::string ext = detail::extension(filename);
+      for(std::vector<imageFormat>::const_reverse_iterator itr=_formats.rbegin(); itr != _formats.rend(); ++itr)
+	if(itr->hasExtension(ext)) return &(*itr);
+      return NULL;
+    }
+
+    // format to read 'filename' with: content first, then extension
+    const imageFormat& forReading(const std::string& filename) const
+    {
+      const imageFormat* format = findByContent(filename);
+      if(!format) format = findByExtension(filename);
+      if(!format) throw unsupportedFormat();
+      return *format;
+    }
+
+    // format to write 'filename' with
+    const imageFormat& forWriting(const std::string& filename) const
+    {
+      const imageFormat* format = findByExtension(filename);
+      if(!format) throw unsupportedFormat();
+      return *format;
+    }
+
+  private:
+    formatRegistry(void)
+    {
+      add( detail::makeFormat<detail::pfmFormat>("pfm", "pfm") );
+      add( detail::makeFormat<detail::ppmFormat>("ppm", "ppm,pnm,pgm") );
+      add( detail::makeFormat<detail::exrFormat>("exr", "exr") );
+      add( detail::makeFormat<detail::pngFormat>("png", "png") );
+      add( detail::makeFormat<detail::jpgFormat>("jpg", "jpg,jpeg") );
+      add( detail::makeFormat<detail::tifFormat>("tif", "tif,tiff") );
+    }
+
+    std::vector<imageFormat> _formats;
+  };
+
+
+  inline void registerFormat(const imageFormat& format)  { formatRegistry::instance().add(format); }
+
+}  // end io namespace
+
+#endif /* _IMAGEIO_REGISTRY_H_ */
@@ -63,7 +63,7 @@ class iteratorWrapper {
 // Default Const case //
 ////////////////////////
 template<typename T>
-class iteratorWrapper<const T, typename disable_if< is_fundamental<T> >::type> {
+class iteratorWrapper<const T, typename boost::disable_if< boost::is_fundamental<T> >::type> {
   public:
   //////////////
   // Typedefs //
@@ -103,16 +103,16 @@ class iteratorWrapper<const T, typename disable_if< is_fundamental<T> >::type> {
 // Fundamental type case //
 ///////////////////////////
 template<typename T>
-struct iteratorWrapper<T, typename enable_if< is_fundamental<T> >::type > {
+struct iteratorWrapper<T, typename boost::enable_if< boost::is_fundamental<T> >::type > {
   public:
   //////////////
   // Typedefs //
   //////////////
   typedef T                                       base_type;
   typedef base_type*                              iterator;
-  typedef typename add_const<base_type>::type*    const_iterator;
+  typedef typename boost::add_const<base_type>::type*    const_iterator;
   typedef base_type&                              reference;
-  typedef typename add_const<base_type>::type&    const_reference;
+  typedef typename boost::add_const<base_type>::type&    const_reference;
   typedef base_type                               value_type;
 
   /////////////////
@@ -0,0 +1,119 @@
+#ifndef _MAPPEDFILE_H_
+#define _MAPPEDFILE_H_
+
+#include <cstdio>
+#include <string>
+#include <algorithm>
+#include <boost/utility.hpp>
+
+#if defined(__unix__) || defined(__APPLE__)
+  #define MAPPEDFILE_MMAP
+  #include <fcntl.h>
+  #include <unistd.h>
+  #include <sys/mman.h>
+  #include <sys/stat.h>
+#endif
+
+#include "exceptions.h"
+
+/////////////////////////////////////////////////////////
+// Read-only view of a file's content.  On POSIX       //
+// systems the file is memory mapped copy-on-write     //
+// (MAP_PRIVATE): the content can be modified in       //
+// memory without affecting the file.  Otherwise (or   //
+// if mapping fails, e.g., for pipes) the file is read //
+// into memory once.                                   //
+/////////////////////////////////////////////////////////
+class mappedFile : boost::noncopyable {
+ public:
+  //////////////////
+  // Constructors //
+  //////////////////
+  explicit mappedFile(const std::string& filename) : _data(NULL), _size(0), _mapped(false)
+  {
+#ifdef MAPPEDFILE_MMAP
+    int fd = open(filename.c_str(), O_RDONLY);
+    if(fd < 0) throw fileNotFound(filename, "reading");
+
+    struct stat info;
+    if(fstat(fd, &info) == 0 && S_ISREG(info.st_mode) && info.st_size > 0)
+    {
+      void* ptr = mmap(NULL, (size_t)(info.st_size), PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+      if(ptr != MAP_FAILED)
+      {
+        _data = static_cast<char*>(ptr);
+        _size = (size_t)(info.st_size);
+        _mapped = true;
+      }
+    }
+    close(fd);
+    if(_mapped) return;
+#endif
+
+    _read(filename);
+  }
+
+  ////////////////
+  // Destructor //
+  ////////////////
+  ~mappedFile(void)
+  {
+#ifdef MAPPEDFILE_MMAP
+    if(_mapped) { munmap(_data, _size); return; }
+#endif
+    delete[] _data;
+  }
+
+  ////////////////
+  // Inspectors //
+  ////////////////
+  const char* data(void) const  { return _data; }
+  char*       data(void)        { return _data; }
+  size_t      size(void) const  { return _size; }
+  bool        isMapped(void) const  { return _mapped; }
+
+  // hint that the content will be read front to back once
+  void sequential(void) const
+  {
+#if defined(MAPPEDFILE_MMAP) && defined(MADV_SEQUENTIAL)
+    if(_mapped) madvise(_data, _size, MADV_SEQUENTIAL);
+#endif
+  }
+
+ private:
+  void _read(const std::string& filename)
+  {
+    FILE* fp = fopen(filename.c_str(), "rb");
+    if(!fp) throw fileNotFound(filename, "reading");
+
+    // read in chunks (the size may be unknown, e.g., for pipes)
+    const size_t chunk = 1 << 20;
+    size_t capacity = 0;
+    for(;;)
+    {
+      if(_size == capacity)
+      {
+        capacity = std::max(chunk, 2 * capacity);
+        char* grown = new char[capacity];
+        std::copy(_data, _data + _size, grown);
+        delete[] _data;
+        _data = grown;
+      }
+
+      size_t count = fread(_data + _size, 1, capacity - _size, fp);
+      _size += count;
+      if(count == 0) break;
+    }
+
+    fclose(fp);
+  }
+
+  //////////////////////////
+  // Private Data Members //
+  //////////////////////////
+  char* _data;
+  size_t _size;
+  bool _mapped;
+};
+
+#endif /* _MAPPEDFILE_H_ */
@@ -107,6 +107,7 @@ public:
   mat<T>& threshold(const_reference neg_value, const_reference pos_value);
   mat<T>& Abs(void); 
   mat<T> transpose(void) const;
+  mat<T>& transposeInPlace(void);                // no allocation if square
 
 
   /////////////
@@ -2,6 +2,8 @@
 #define _MAT_INLINE_H_
 
 #include <cassert>
+#include "mat.multiply.h"
+#include "mat.transpose.h"
 
 //////////////////////////
 // Inspector operator() //
@@ -80,16 +82,9 @@ mat<T> mat<T>::operator*(const mat<T>& other) const
   // sanity check
   assert(other.height() == width());
 
-  // multiply (storage order independent!)
+  // multiply (column major storage; BLAS for float/double)
   mat<T> result(other.width(), height());
-  for(int i=0; i < result.width(); i++)
-    for(int j=0; j < result.height(); j++)
-    {
-      T temp = 0;
-      for(int k=0; k < width(); k++)
-	temp += (*this)(k, j) * other(i, k);
-      result(i,j) = temp;
-    }
+  mat_detail::multiply(begin(), other.begin(), result.begin(), height(), other.width(), width());
   return result;
 }
 
@@ -238,15 +233,27 @@ template<typename T>
 mat<T> mat<T>::transpose(void) const
 {
   mat<T> result(height(), width());
-    
-  for(int w=0; w < width(); w++)
-    for(int h=0; h < height(); h++)
-      result(h, w) = (*this)(w, h);
-
+  mat_detail::transpose(begin(), result.begin(), height(), width());
   return result;
 }
 
 
+//////////////////////
+// transposeInPlace //
+//////////////////////
+template<typename T>
+mat<T>& mat<T>::transposeInPlace(void)
+{
+  if(width() == height()) mat_detail::transposeInPlace(begin(), width());
+  else
+  {
+    mat<T> result = transpose();
+    _swap(result);
+  }
+  return *this;
+}
+
+
 ///////////////////////
 // _swap (protected) //
 ///////////////////////
@@ -0,0 +1,133 @@
+#if defined(_MAT_H_) && !defined(_MAT_MULTIPLY_H_)
+#define _MAT_MULTIPLY_H_
+
+#include <algorithm>
+
+#ifdef INCLUDE_BLAS
+
+namespace lapack {     // ! We need this namespace to avoid conflicts with STL
+
+extern "C" {
+#include "f2c.h"
+#include "cblas.h"
+
+#undef min             // ! must undef min/max macro to use STL
+#undef max
+#undef abs
+}
+
+}
+
+#endif /* INCLUDE_BLAS */
+
+
+namespace mat_detail {
+
+  ///////////////////////////////////////////////////
+  // C = A * B for column major matrices, where A  //
+  // is m x k, B is k x n and C is m x n.          //
+  //                                               //
+  // Generic kernel: C is computed in panels of    //
+  // columns (in parallel), and each panel in      //
+  // blocks of A that stay in cache.  The inner    //
+  // loop updates 4 columns of C with a column of  //
+  // A (unit stride; vectorized by the compiler).  //
+  ///////////////////////////////////////////////////
+  template<typename T>
+    void multiply(const T* a, const T* b, T* c, int m, int n, int k)
+  {
+    const int panelWidth = 64;                  // columns of C per task
+    const int blockHeight = 128;                // rows of A per block
+    const int blockDepth = 128;                 // columns of A per block
+
+    std::fill(c, c + m*n, T(0));
+
+#pragma omp parallel for schedule(dynamic, 1) if((double)(m) * n * k > 1e6)
+    for(int p0=0; p0 < n; p0 += panelWidth)
+    {
+      int p1 = std::min(p0 + panelWidth, n);
+
+      for(int k0=0; k0 < k; k0 += blockDepth)
+      {
+	int k1 = std::min(k0 + blockDepth, k);
+
+	for(int i0=0; i0 < m; i0 += blockHeight)
+	{
+	  int i1 = std::min(i0 + blockHeight, m);
+
+	  // 4 columns at a time
+	  int j = p0;
+	  for(; j + 4 <= p1; j += 4)
+	  {
+	    T* c0 = c + j*m;
+	    T* c1 = c0 + m;
+	    T* c2 = c1 + m;
+	    T* c3 = c2 + m;
+
+	    for(int l=k0; l < k1; l++)
+	    {
+	      const T* al = a + l*m;
+	      const T b0 = b[j*k + l], b1 = b[(j+1)*k + l], b2 = b[(j+2)*k + l], b3 = b[(j+3)*k + l];
+
+	      for(int i=i0; i < i1; i++)
+	      {
+		c0[i] += al[i] * b0;
+		c1[i] += al[i] * b1;
+		c2[i] += al[i] * b2;
+		c3[i] += al[i] * b3;
+	      }
+	    }
+	  }
+
+	  // remaining columns
+	  for(; j < p1; j++)
+	  {
+	    T* cj = c + j*m;
+	    for(int l=k0; l < k1; l++)
+	    {
+	      const T* al = a + l*m;
+	      const T bl = b[j*k + l];
+	      for(int i=i0; i < i1; i++)
+		cj[i] += al[i] * bl;
+	    }
+	  }
+	}
+      }
+    }
+
+    // Done.
+  }
+
+
+#ifdef INCLUDE_BLAS
+
+  //////////////////////////////////////
+  // float and double: BLAS xGEMM     //
+  //////////////////////////////////////
+  inline void multiply(const float* a, const float* b, float* c, int m, int n, int k)
+  {
+    if(m == 0 || n == 0) return;
+    if(k == 0) { std::fill(c, c + m*n, 0.0f); return; }
+
+    char trans = 'N';
+    lapack::integer M = m, N = n, K = k;
+    lapack::real alpha = 1.0f, beta = 0.0f;
+    lapack::sgemm_(&trans, &trans, &M, &N, &K, &alpha, const_cast<float*>(a), &M, const_cast<float*>(b), &K, &beta, c, &M);
+  }
+
+  inline void multiply(const double* a, const double* b, double* c, int m, int n, int k)
+  {
+    if(m == 0 || n == 0) return;
+    if(k == 0) { std::fill(c, c + m*n, 0.0); return; }
+
+    char trans = 'N';
+    lapack::integer M = m, N = n, K = k;
+    lapack::doublereal alpha = 1.0, beta = 0.0;
+    lapack::dgemm_(&trans, &trans, &M, &N, &K, &alpha, const_cast<double*>(a), &M, const_cast<double*>(b), &K, &beta, c, &M);
+  }
+
+#endif /* INCLUDE_BLAS */
+
+} // end mat_detail namespace
+
+#endif /* _MAT_MULTIPLY_H_ */
@@ -0,0 +1,258 @@
+#if defined(_MAT_H_) && !defined(_MAT_TRANSPOSE_H_)
+#define _MAT_TRANSPOSE_H_
+
+#include <algorithm>
+#include "simd.h"
+
+namespace mat_detail {
+
+  ///////////////////////////////////////////////////
+  // dst = src^T for a column major 'rows' x       //
+  // 'cols' block of src (leading dimension lds)   //
+  // into a 'cols' x 'rows' block of dst (leading  //
+  // dimension ldd):                               //
+  //   dst[r*ldd + c] = src[c*lds + r]             //
+  //                                               //
+  // Large blocks are split recursively along the  //
+  // longest side (cache-oblivious) until a tile   //
+  // fits in L1; tiles are transposed with 8x8     //
+  // (AVX) or 4x4 (SSE) register kernels for float //
+  // and element-wise otherwise.                   //
+  ///////////////////////////////////////////////////
+  const int transposeTile = 32;
+
+  template<typename T>
+    inline void transposeTileScalar(const T* src, int lds, T* dst, int ldd, int rows, int cols)
+  {
+    for(int c=0; c < cols; c++)
+      for(int r=0; r < rows; r++)
+	dst[r*ldd + c] = src[c*lds + r];
+  }
+
+  template<typename T>
+    inline void transposeBlock(const T* src, int lds, T* dst, int ldd, int rows, int cols)
+  {
+    transposeTileScalar(src, lds, dst, ldd, rows, cols);
+  }
+
+
+  //////////////////////////////////////
+  // in-place: swap a block 'a' with  //
+  // the transpose of its mirror 'b'  //
+  // (a == b on the diagonal)         //
+  //////////////////////////////////////
+  template<typename T>
+    inline void swapTileScalar(T* a, T* b, int ld, int rows, int cols)
+  {
+    if(a == b)
+    {
+      for(int c=0; c < cols; c++)
+	for(int r=c+1; r < rows; r++)
+	  std::swap(a[c*ld + r], b[r*ld + c]);
+    }
+    else
+    {
+      for(int c=0; c < cols; c++)
+	for(int r=0; r < rows; r++)
+	  std::swap(a[c*ld + r], b[r*ld + c]);
+    }
+  }
+
+  template<typename T>
+    inline void swapBlock(T* a, T* b, int ld, int rows, int cols)
+  {
+    swapTileScalar(a, b, ld, rows, cols);
+  }
+
+
+#ifdef SIMD_X86
+
+  //////////////////////////////////////
+  // float register kernels           //
+  //////////////////////////////////////
+  inline void transpose4x4(const float* src, int lds, float* dst, int ldd)
+  {
+    __m128 c0 = _mm_loadu_ps(src);
+    __m128 c1 = _mm_loadu_ps(src + lds);
+    __m128 c2 = _mm_loadu_ps(src + 2*lds);
+    __m128 c3 = _mm_loadu_ps(src + 3*lds);
+    _MM_TRANSPOSE4_PS(c0, c1, c2, c3);
+    _mm_storeu_ps(dst, c0);
+    _mm_storeu_ps(dst + ldd, c1);
+    _mm_storeu_ps(dst + 2*ldd, c2);
+    _mm_storeu_ps(dst + 3*ldd, c3);
+  }
+
+  inline void swap4x4(float* a, float* b, int ld)
+  {
+    __m128 a0 = _mm_loadu_ps(a), a1 = _mm_loadu_ps(a + ld), a2 = _mm_loadu_ps(a + 2*ld), a3 = _mm_loadu_ps(a + 3*ld);
+    __m128 b0 = _mm_loadu_ps(b), b1 = _mm_loadu_ps(b + ld), b2 = _mm_loadu_ps(b + 2*ld), b3 = _mm_loadu_ps(b + 3*ld);
+    _MM_TRANSPOSE4_PS(a0, a1, a2, a3);
+    _MM_TRANSPOSE4_PS(b0, b1, b2, b3);
+    _mm_storeu_ps(b, a0);  _mm_storeu_ps(b + ld, a1);  _mm_storeu_ps(b + 2*ld, a2);  _mm_storeu_ps(b + 3*ld, a3);
+    _mm_storeu_ps(a, b0);  _mm_storeu_ps(a + ld, b1);  _mm_storeu_ps(a + 2*ld, b2);  _mm_storeu_ps(a + 3*ld, b3);
+  }
+
+  SIMD_TARGET_AVX2 inline void transpose8x8(const float* src, int lds, float* dst, int ldd)
+  {
+    __m256 c0 = _mm256_loadu_ps(src),         c1 = _mm256_loadu_ps(src + lds);
+    __m256 c2 = _mm256_loadu_ps(src + 2*lds), c3 = _mm256_loadu_ps(src + 3*lds);
+    __m256 c4 = _mm256_loadu_ps(src + 4*lds), c5 = _mm256_loadu_ps(src + 5*lds);
+    __m256 c6 = _mm256_loadu_ps(src + 6*lds), c7 = _mm256_loadu_ps(src + 7*lds);
+
+    // interleave pairs of columns
+    __m256 t0 = _mm256_unpacklo_ps(c0, c1), t1 = _mm256_unpackhi_ps(c0, c1);
+    __m256 t2 = _mm256_unpacklo_ps(c2, c3), t3 = _mm256_unpackhi_ps(c2, c3);
+    __m256 t4 = _mm256_unpacklo_ps(c4, c5), t5 = _mm256_unpackhi_ps(c4, c5);
+    __m256 t6 = _mm256_unpacklo_ps(c6, c7), t7 = _mm256_unpackhi_ps(c6, c7);
+
+    // 4x4 transposes within each 128-bit lane
+    __m256 s0 = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(1,0,1,0)), s1 = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(3,2,3,2));
+    __m256 s2 = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(1,0,1,0)), s3 = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(3,2,3,2));
+    __m256 s4 = _mm256_shuffle_ps(t4, t6, _MM_SHUFFLE(1,0,1,0)), s5 = _mm256_shuffle_ps(t4, t6, _MM_SHUFFLE(3,2,3,2));
+    __m256 s6 = _mm256_shuffle_ps(t5, t7, _MM_SHUFFLE(1,0,1,0)), s7 = _mm256_shuffle_ps(t5, t7, _MM_SHUFFLE(3,2,3,2));
+
+    // exchange lanes
+    _mm256_storeu_ps(dst,         _mm256_permute2f128_ps(s0, s4, 0x20));
+    _mm256_storeu_ps(dst + ldd,   _mm256_permute2f128_ps(s1, s5, 0x20));
+    _mm256_storeu_ps(dst + 2*ldd, _mm256_permute2f128_ps(s2, s6, 0x20));
+    _mm256_storeu_ps(dst + 3*ldd, _mm256_permute2f128_ps(s3, s7, 0x20));
+    _mm256_storeu_ps(dst + 4*ldd, _mm256_permute2f128_ps(s0, s4, 0x31));
+    _mm256_storeu_ps(dst + 5*ldd, _mm256_permute2f128_ps(s1, s5, 0x31));
+    _mm256_storeu_ps(dst + 6*ldd, _mm256_permute2f128_ps(s2, s6, 0x31));
+    _mm256_storeu_ps(dst + 7*ldd, _mm256_permute2f128_ps(s3, s7, 0x31));
+  }
+
+
+  //////////////////////////////////////
+  // float tiles: register kernels on //
+  // the interior, scalar on the rim  //
+  //////////////////////////////////////
+  inline void transposeTileSSE(const float* src, int lds, float* dst, int ldd, int rows, int cols)
+  {
+    int r4 = rows & ~3, c4 = cols & ~3;
+    for(int c=0; c < c4; c += 4)
+      for(int r=0; r < r4; r += 4)
+	transpose4x4(src + c*lds + r, lds, dst + r*ldd + c, ldd);
+
+    transposeTileScalar(src + r4, lds, dst + r4*ldd, ldd, rows - r4, cols);
+    transposeTileScalar(src + c4*lds, lds, dst + c4, ldd, r4, cols - c4);
+  }
+
+  SIMD_TARGET_AVX2 inline void transposeTileAVX2(const float* src, int lds, float* dst, int ldd, int rows, int cols)
+  {
+    int r8 = rows & ~7, c8 = cols & ~7;
+    for(int c=0; c < c8; c += 8)
+      for(int r=0; r < r8; r += 8)
+	transpose8x8(src + c*lds + r, lds, dst + r*ldd + c, ldd);
+
+    transposeTileScalar(src + r8, lds, dst + r8*ldd, ldd, rows - r8, cols);
+    transposeTileScalar(src + c8*lds, lds, dst + c8, ldd, r8, cols - c8);
+  }
+
+  inline void transposeBlock(const float* src, int lds, float* dst, int ldd, int rows, int cols)
+  {
+    if(simd::hasAVX2()) transposeTileAVX2(src, lds, dst, ldd, rows, cols);
+    else transposeTileSSE(src, lds, dst, ldd, rows, cols);
+  }
+
+  inline void swapBlock(float* a, float* b, int ld, int rows, int cols)
+  {
+    int r4 = rows & ~3, c4 = cols & ~3;
+    for(int c=0; c < c4; c += 4)
+      for(int r=0; r < r4; r += 4)
+      {
+	// on the diagonal, visit each pair of 4x4 blocks once
+	if(a == b && r < c) continue;
+	if(a == b && r == c)
+	{
+	  float* d = a + c*ld + r;
+	  __m128 d0 = _mm_loadu_ps(d), d1 = _mm_loadu_ps(d + ld), d2 = _mm_loadu_ps(d + 2*ld), d3 = _mm_loadu_ps(d + 3*ld);
+	  _MM_TRANSPOSE4_PS(d0, d1, d2, d3);
+	  _mm_storeu_ps(d, d0);  _mm_storeu_ps(d + ld, d1);  _mm_storeu_ps(d + 2*ld, d2);  _mm_storeu_ps(d + 3*ld, d3);
+	}
+	else swap4x4(a + c*ld + r, b + r*ld + c, ld);
+      }
+
+    // rim
+    if(a == b)
+    {
+      for(int c=0; c < cols; c++)
+	for(int r=std::max(c+1, r4); r < rows; r++)
+	  std::swap(a[c*ld + r], a[r*ld + c]);
+    }
+    else
+    {
+      swapTileScalar(a + r4, b + r4*ld, ld, rows - r4, cols);
+      swapTileScalar(a + c4*ld, b + c4, ld, r4, cols - c4);
+    }
+  }
+
+#endif /* SIMD_X86 */
+
+
+  //////////////////////////////////////
+  // Cache-oblivious recursion        //
+  //////////////////////////////////////
+  template<typename T>
+    void transposeRecursive(const T* src, int lds, T* dst, int ldd, int rows, int cols)
+  {
+    if(rows <= transposeTile && cols <= transposeTile)
+      transposeBlock(src, lds, dst, ldd, rows, cols);
+
+    // split the longest side (on a multiple of 8 to keep the kernels busy)
+    else if(rows >= cols)
+    {
+      int half = ((rows / 2) + 7) & ~7;
+      transposeRecursive(src, lds, dst, ldd, half, cols);
+      transposeRecursive(src + half, lds, dst + half*ldd, ldd, rows - half, cols);
+    }
+    else
+    {
+      int half = ((cols / 2) + 7) & ~7;
+      transposeRecursive(src, lds, dst, ldd, rows, half);
+      transposeRecursive(src + half*lds, lds, dst + half, ldd, rows, cols - half);
+    }
+  }
+
+
+  ///////////////////////////////////////////////////
+  // Out-of-place transpose of a column major      //
+  // 'rows' x 'cols' matrix; large matrices are    //
+  // processed in parallel panels of columns.      //
+  ///////////////////////////////////////////////////
+  template<typename T>
+    void transpose(const T* src, T* dst, int rows, int cols)
+  {
+    const int panelWidth = 256;
+
+#pragma omp parallel for schedule(dynamic, 1) if((double)(rows) * cols > 1e6)
+    for(int c0=0; c0 < cols; c0 += panelWidth)
+      transposeRecursive(src + c0*rows, rows, dst + c0, cols, rows, std::min(panelWidth, cols - c0));
+
+    // Done.
+  }
+
+
+  ///////////////////////////////////////////////////
+  // In-place transpose of a square n x n matrix:  //
+  // tiles above the diagonal are swapped with     //
+  // their mirror below it.                        //
+  ///////////////////////////////////////////////////
+  template<typename T>
+    void transposeInPlace(T* a, int n)
+  {
+#pragma omp parallel for schedule(dynamic, 1) if((double)(n) * n > 1e6)
+    for(int c0=0; c0 < n; c0 += transposeTile)
+    {
+      int cols = std::min(transposeTile, n - c0);
+      for(int r0=c0; r0 < n; r0 += transposeTile)
+	swapBlock(a + c0*n + r0, a + r0*n + c0, n, std::min(transposeTile, n - r0), cols);
+    }
+
+    // Done.
+  }
+
+} // end mat_detail namespace
+
+#endif /* _MAT_TRANSPOSE_H_ */
@@ -0,0 +1,246 @@
+#ifndef _MAT_BATCHED_H_
+#define _MAT_BATCHED_H_
+
+#include <cmath>
+#include <algorithm>
+#include <cstddef>
+#include <limits>
+#include <boost/static_assert.hpp>
+
+/////////////////////////////////////////////////////
+// Batched solvers for many small systems (e.g.,   //
+// one per pixel).  The systems are stored         //
+// contiguously, each matrix column major (as      //
+// mat<T>): system 's' uses A + s*M*N, B + s*M and //
+// writes X + s*N.  Sizes are template parameters  //
+// such that the kernels are fully unrolled and    //
+// kept in registers; batches are solved in        //
+// parallel.  If 'success' is given, it receives   //
+// per system whether the matrix was (numerically) //
+// full rank / positive definite; failed systems   //
+// get a zero solution.                            //
+/////////////////////////////////////////////////////
+namespace batched {
+
+  enum method {
+    CHOLESKY,          // normal equations: fastest, squares the condition number
+    QR                 // Householder QR: slower, numerically robust
+  };
+
+  namespace detail {
+
+    //////////////////////////////////////
+    // In-place Cholesky factorization  //
+    // of an SPD N x N matrix (lower    //
+    // triangle is used and replaced).  //
+    // Pivots below eps * trace are     //
+    // treated as singular.             //
+    //////////////////////////////////////
+    template<int N, typename T>
+      inline bool cholesky(T* L)
+    {
+      T tolerance = 0;
+      for(int j=0; j < N; j++)
+	tolerance += L[j*N + j];
+      tolerance *= std::numeric_limits<T>::epsilon();
+
+      for(int j=0; j < N; j++)
+      {
+	T d = L[j*N + j];
+	for(int k=0; k < j; k++)
+	  d -= L[k*N + j] * L[k*N + j];
+	if(!(d > tolerance)) return false;
+
+	d = std::sqrt(d);
+	L[j*N + j] = d;
+
+	T inv = T(1) / d;
+	for(int i=j+1; i < N; i++)
+	{
+	  T s = L[j*N + i];
+	  for(int k=0; k < j; k++)
+	    s -= L[k*N + i] * L[k*N + j];
+	  L[j*N + i] = s * inv;
+	}
+      }
+      return true;
+    }
+
+
+    //////////////////////////////////////
+    // Solve L L^T x = b (in place)     //
+    //////////////////////////////////////
+    template<int N, typename T>
+      inline void choleskySubstitute(const T* L, T* x)
+    {
+      for(int i=0; i < N; i++)
+      {
+	T s = x[i];
+	for(int k=0; k < i; k++)
+	  s -= L[k*N + i] * x[k];
+	x[i] = s / L[i*N + i];
+      }
+
+      for(int i=N-1; i >= 0; i--)
+      {
+	T s = x[i];
+	for(int k=i+1; k < N; k++)
+	  s -= L[i*N + k] * x[k];
+	x[i] = s / L[i*N + i];
+      }
+    }
+
+
+    //////////////////////////////////////
+    // min |Ax - b| via the normal      //
+    // equations A^T A x = A^T b        //
+    //////////////////////////////////////
+    template<int M, int N, typename T>
+      inline bool normalEquations(const T* A, const T* b, T* x)
+    {
+      T AtA[N*N];
+      for(int j=0; j < N; j++)
+      {
+	for(int i=j; i < N; i++)
+	{
+	  T s = 0;
+	  for(int r=0; r < M; r++)
+	    s += A[i*M + r] * A[j*M + r];
+	  AtA[j*N + i] = s;
+	}
+
+	T s = 0;
+	for(int r=0; r < M; r++)
+	  s += A[j*M + r] * b[r];
+	x[j] = s;
+      }
+
+      if(!cholesky<N>(AtA)) return false;
+      choleskySubstitute<N>(AtA, x);
+      return true;
+    }
+
+
+    //////////////////////////////////////
+    // min |Ax - b| via Householder QR; //
+    // rank deficient if a diagonal of  //
+    // R is below eps * M * the largest //
+    // column norm.                     //
+    //////////////////////////////////////
+    template<int M, int N, typename T>
+      inline bool householder(const T* A, const T* b, T* x)
+    {
+      T a[M*N], y[M], diag[N];
+      for(int i=0; i < M*N; i++) a[i] = A[i];
+      for(int i=0; i < M; i++) y[i] = b[i];
+
+      T tolerance = 0;
+      for(int j=0; j < N; j++)
+      {
+	T norm = 0;
+	for(int r=0; r < M; r++)
+	  norm += a[j*M + r] * a[j*M + r];
+	tolerance = std::max(tolerance, norm);
+      }
+      tolerance = std::sqrt(tolerance) * M * std::numeric_limits<T>::epsilon();
+
+      // reduce to R; apply the reflections to y (= Q^T b)
+      for(int j=0; j < N; j++)
+      {
+	T* v = a + j*M;
+
+	T norm = 0;
+	for(int r=j; r < M; r++)
+	  norm += v[r] * v[r];
+	norm = std::sqrt(norm);
+	if(!(norm > tolerance)) return false;
+
+	T alpha = (v[j] > T(0)) ? -norm : norm;
+	v[j] -= alpha;
+	diag[j] = alpha;
+
+	T vnorm = 0;
+	for(int r=j; r < M; r++)
+	  vnorm += v[r] * v[r];
+	T scale = T(2) / vnorm;
+
+	for(int c=j+1; c < N; c++)
+	{
+	  T* col = a + c*M;
+	  T s = 0;
+	  for(int r=j; r < M; r++)
+	    s += v[r] * col[r];
+	  s *= scale;
+	  for(int r=j; r < M; r++)
+	    col[r] -= s * v[r];
+	}
+
+	T s = 0;
+	for(int r=j; r < M; r++)
+	  s += v[r] * y[r];
+	s *= scale;
+	for(int r=j; r < M; r++)
+	  y[r] -= s * v[r];
+      }
+
+      // back substitution R x = (Q^T b)[0..N)
+      for(int i=N-1; i >= 0; i--)
+      {
+	T s = y[i];
+	for(int k=i+1; k < N; k++)
+	  s -= a[k*M + i] * x[k];
+	x[i] = s / diag[i];
+      }
+
+      return true;
+    }
+
+  } // end detail namespace
+
+
+  ///////////////////////////////////////////////
+  // Solve A x = b for 'count' symmetric       //
+  // positive definite N x N matrices.         //
+  ///////////////////////////////////////////////
+  template<int N, typename T>
+    void cholesky_solve(const T* A, const T* B, T* X, long count, bool* success=NULL)
+  {
+#pragma omp parallel for schedule(static)
+    for(long s=0; s < count; s++)
+    {
+      T L[N*N];
+      const T* a = A + s*N*N;
+      T* x = X + s*N;
+      for(int i=0; i < N*N; i++) L[i] = a[i];
+      for(int i=0; i < N; i++) x[i] = B[s*N + i];
+
+      bool ok = detail::cholesky<N>(L);
+      if(ok) detail::choleskySubstitute<N>(L, x);
+      else for(int i=0; i < N; i++) x[i] = T(0);
+      if(success) success[s] = ok;
+    }
+  }
+
+
+  ///////////////////////////////////////////////
+  // min |A x - b| for 'count' M x N matrices  //
+  // (M >= N).                                 //
+  ///////////////////////////////////////////////
+  template<int M, int N, typename T>
+    void least_squares(const T* A, const T* B, T* X, long count, method m=QR, bool* success=NULL)
+  {
+    BOOST_STATIC_ASSERT(M >= N);     // over-determined systems only
+
+#pragma omp parallel for schedule(static)
+    for(long s=0; s < count; s++)
+    {
+      T* x = X + s*N;
+      bool ok = (m == CHOLESKY) ? detail::normalEquations<M,N>(A + s*M*N, B + s*M, x) : detail::householder<M,N>(A + s*M*N, B + s*M, x);
+      if(!ok) for(int i=0; i < N; i++) x[i] = T(0);
+      if(success) success[s] = ok;
+    }
+  }
+
+} // end batched namespace
+
+#endif /* _MAT_BATCHED_H_ */
@@ -1,6 +1,9 @@
 #ifndef _MAT_OPERATIONS_H_
 #define _MAT_OPERATIONS_H_
 
+#include <vector>
+#include <iostream>
+#include <algorithm>
 #include "mat.h"
 #include "tempArray.h"
 
@@ -537,4 +540,268 @@ void least_squares<double>(mat<double>& A, mat<double>& B)
   // done.
 }
 
+/////////////////////////////////////////////////
+// Solver objects with reusable workspaces.    //
+//                                             //
+// The functions above query and allocate the  //
+// LAPACK workspaces on every call.  A solver  //
+// is constructed for a problem shape; the     //
+// workspaces are queried and allocated once   //
+// and reused by every call of that shape.     //
+// Results are written to caller-provided      //
+// matrices, which are only reallocated if     //
+// their size differs.  Methods return false   //
+// if LAPACK reports a numerical failure       //
+// (singular or rank deficient matrix, no      //
+// convergence).                               //
+/////////////////////////////////////////////////
+namespace lapack {
+
+  /////////////////////////////////////
+  // float/double LAPACK dispatching //
+  /////////////////////////////////////
+  template<typename T> struct routines;
+
+  template<> struct routines<float> {
+    static void syevd(char* jobz, char* uplo, integer* n, float* a, integer* lda, float* w, float* work, integer* lwork, integer* iwork, integer* liwork, integer* info)  { ssyevd_(jobz, uplo, n, a, lda, w, work, lwork, iwork, liwork, info); }
+    static void gesdd(char* jobz, integer* m, integer* n, float* a, integer* lda, float* s, float* u, integer* ldu, float* vt, integer* ldvt, float* work, integer* lwork, integer* iwork, integer* info)  { sgesdd_(jobz, m, n, a, lda, s, u, ldu, vt, ldvt, work, lwork, iwork, info); }
+    static void getrf(integer* m, integer* n, float* a, integer* lda, integer* ipiv, integer* info)  { sgetrf_(m, n, a, lda, ipiv, info); }
+    static void getri(integer* n, float* a, integer* lda, integer* ipiv, float* work, integer* lwork, integer* info)  { sgetri_(n, a, lda, ipiv, work, lwork, info); }
+    static void gesv(integer* n, integer* nrhs, float* a, integer* lda, integer* ipiv, float* b, integer* ldb, integer* info)  { sgesv_(n, nrhs, a, lda, ipiv, b, ldb, info); }
+    static void gels(char* trans, integer* m, integer* n, integer* nrhs, float* a, integer* lda, float* b, integer* ldb, float* work, integer* lwork, integer* info)  { sgels_(trans, m, n, nrhs, a, lda, b, ldb, work, lwork, info); }
+  };
+
+  template<> struct routines<double> {
+    static void syevd(char* jobz, char* uplo, integer* n, double* a, integer* lda, double* w, double* work, integer* lwork, integer* iwork, integer* liwork, integer* info)  { dsyevd_(jobz, uplo, n, a, lda, w, work, lwork, iwork, liwork, info); }
+    static void gesdd(char* jobz, integer* m, integer* n, double* a, integer* lda, double* s, double* u, integer* ldu, double* vt, integer* ldvt, double* work, integer* lwork, integer* iwork, integer* info)  { dgesdd_(jobz, m, n, a, lda, s, u, ldu, vt, ldvt, work, lwork, iwork, info); }
+    static void getrf(integer* m, integer* n, double* a, integer* lda, integer* ipiv, integer* info)  { dgetrf_(m, n, a, lda, ipiv, info); }
+    static void getri(integer* n, double* a, integer* lda, integer* ipiv, double* work, integer* lwork, integer* info)  { dgetri_(n, a, lda, ipiv, work, lwork, info); }
+    static void gesv(integer* n, integer* nrhs, double* a, integer* lda, integer* ipiv, double* b, integer* ldb, integer* info)  { dgesv_(n, nrhs, a, lda, ipiv, b, ldb, info); }
+    static void gels(char* trans, integer* m, integer* n, integer* nrhs, double* a, integer* lda, double* b, integer* ldb, double* work, integer* lwork, integer* info)  { dgels_(trans, m, n, nrhs, a, lda, b, ldb, work, lwork, info); }
+  };
+
+
+  // (re)allocate 'm' only if its size differs
+  template<typename T>
+    void ensureSize(mat<T>& m, int width, int height)
+  {
+    if(m.width() != width || m.height() != height) m = mat<T>(width, height);
+  }
+
+
+  //////////////////////////////////////
+  // Eigen-decomposition of symmetric //
+  // size x size matrices.  'm' is    //
+  // replaced by the eigenvectors.    //
+  //////////////////////////////////////
+  template<typename T>
+    class eigen_solver {
+  public:
+    explicit eigen_solver(int size) : _size(size), _work(std::max(1, 1 + 6*size + 2*size*size)), _iwork(std::max(1, 3 + 5*size)) {}
+
+    int size(void) const { return _size; }
+
+    bool decompose(mat<T>& m, mat<T>& eigenvalues)
+    {
+      // sanity check
+      assert(m.width() == _size && m.height() == _size);
+      ensureSize(eigenvalues, 1, _size);
+
+      // call LAPACK
+      char JOBS = 'V', UPLO = 'U';
+      integer N = _size, LWORK = _work.size(), LIWORK = _iwork.size(), status;
+      routines<T>::syevd(&JOBS, &UPLO, &N, m.begin(), &N, eigenvalues.begin(), &_work[0], &LWORK, &_iwork[0], &LIWORK, &status);
+
+      // check status
+      assert(status >= 0);    // UNEXPECTED ERROR, one of the parameters is wrong??
+      return (status == 0);
+    }
+
+  private:
+    int _size;
+    std::vector<T> _work;
+    std::vector<integer> _iwork;
+  };
+
+
+  //////////////////////////////////////
+  // SVD of height x width matrices;  //
+  // 'm' is destroyed (see svd()).    //
+  //////////////////////////////////////
+  template<typename T>
+    class svd_solver {
+  public:
+    svd_solver(int width, int height) : _width(width), _height(height), _iwork(std::max(1, 8 * std::min(width, height)))
+    {
+      // query the optimal workspace once
+      char JOBS = 'A';
+      integer M = std::max(1, height), N = std::max(1, width), LWORK = -1, status;
+      T optimalWork = 1, dummy = 0;
+      if(width > 0 && height > 0) routines<T>::gesdd(&JOBS, &M, &N, &dummy, &M, &dummy, &dummy, &M, &dummy, &N, &optimalWork, &LWORK, &_iwork[0], &status);
+      _work.resize(std::max(1, (int)(optimalWork)));
+    }
+
+    int width(void) const  { return _width; }
+    int height(void) const { return _height; }
+
+    bool decompose(mat<T>& m, mat<T>& U, mat<T>& V, mat<T>& sigma)
+    {
+      // sanity check
+      assert(m.width() == _width && m.height() == _height);
+      ensureSize(U, _height, _height);
+      ensureSize(V, _width, _width);
+      ensureSize(sigma, std::min(_width, _height), 1);
+      if(_width == 0 || _height == 0) return true;
+
+      // call LAPACK
+      char JOBS = 'A';
+      integer M = _height, N = _width, LWORK = _work.size(), status;
+      routines<T>::gesdd(&JOBS, &M, &N, m.begin(), &M, sigma.begin(), U.begin(), &M, V.begin(), &N, &_work[0], &LWORK, &_iwork[0], &status);
+
+      // check status
+      assert(status >= 0);    // UNEXPECTED ERROR, one of the parameters is wrong??
+      return (status == 0);
+    }
+
+  private:
+    int _width, _height;
+    std::vector<T> _work;
+    std::vector<integer> _iwork;
+  };
+
+
+  //////////////////////////////////////
+  // Inverse of size x size matrices  //
+  // (in place).                      //
+  //////////////////////////////////////
+  template<typename T>
+    class inverse_solver {
+  public:
+    explicit inverse_solver(int size) : _size(size), _ipiv(std::max(1, size))
+    {
+      // query the optimal (blocked) workspace once
+      integer N = std::max(1, size), LWORK = -1, status;
+      T optimalWork = 1, dummy = 0;
+      routines<T>::getri(&N, &dummy, &N, &_ipiv[0], &optimalWork, &LWORK, &status);
+      _work.resize(std::max(std::max(1, size), (int)(optimalWork)));
+    }
+
+    int size(void) const { return _size; }
+
+    bool invert(mat<T>& m)
+    {
+      // sanity check
+      assert(m.width() == _size && m.height() == _size);
+      if(_size == 0) return true;
+
+      // call LAPACK
+      integer N = _size, LWORK = _work.size(), status;
+      routines<T>::getrf(&N, &N, m.begin(), &N, &_ipiv[0], &status);
+      assert(status >= 0);    // UNEXPECTED ERROR, one of the parameters is wrong??
+      if(status > 0) return false;
+
+      routines<T>::getri(&N, m.begin(), &N, &_ipiv[0], &_work[0], &LWORK, &status);
+      assert(status >= 0);
+      return (status == 0);
+    }
+
+  private:
+    int _size;
+    std::vector<integer> _ipiv;
+    std::vector<T> _work;
+  };
+
+
+  //////////////////////////////////////
+  // Solve A x = B for size x size A  //
+  // (see linear_solve()).            //
+  //////////////////////////////////////
+  template<typename T>
+    class linear_solver {
+  public:
+    explicit linear_solver(int size) : _size(size), _ipiv(std::max(1, size)) {}
+
+    int size(void) const { return _size; }
+
+    bool solve(mat<T>& A, mat<T>& B)
+    {
+      // sanity check
+      assert(A.width() == _size && A.height() == _size && B.height() == _size);
+      if(_size == 0 || B.width() == 0) return true;
+
+      // call LAPACK
+      integer N = _size, NRHS = B.width(), status;
+      routines<T>::gesv(&N, &NRHS, A.begin(), &N, &_ipiv[0], B.begin(), &N, &status);
+
+      assert(status >= 0);    // UNEXPECTED ERROR, one of the parameters is wrong??
+      return (status == 0);
+    }
+
+  private:
+    int _size;
+    std::vector<integer> _ipiv;
+  };
+
+
+  //////////////////////////////////////
+  // min |A x - B| for height x width //
+  // A (full rank) and 'systems'      //
+  // right hand sides.  A is          //
+  // destroyed; the solution is       //
+  // written to X (systems x width).  //
+  // B is copied into a cached        //
+  // max(width, height) x systems     //
+  // buffer instead of an extended    //
+  // copy per call.                   //
+  //////////////////////////////////////
+  template<typename T>
+    class least_squares_solver {
+  public:
+    least_squares_solver(int width, int height, int systems=1) : _width(width), _height(height), _systems(systems), _ldb(std::max(1, std::max(width, height))), _b(_ldb * std::max(1, systems))
+    {
+      // query the optimal workspace once
+      char TRANS = 'N';
+      integer M = height, N = width, NRHS = systems, LDA = std::max(1, height), LDB = _ldb, LWORK = -1, status;
+      T optimalSize = 1, dummy = 0;
+      routines<T>::gels(&TRANS, &M, &N, &NRHS, &dummy, &LDA, &dummy, &LDB, &optimalSize, &LWORK, &status);
+      _work.resize(std::max(1, (int)(optimalSize)));
+    }
+
+    int width(void) const   { return _width; }
+    int height(void) const  { return _height; }
+    int systems(void) const { return _systems; }
+
+    bool solve(mat<T>& A, const mat<T>& B, mat<T>& X)
+    {
+      // sanity check
+      assert(A.width() == _width && A.height() == _height);
+      assert(B.width() == _systems && B.height() == _height);
+      ensureSize(X, _systems, _width);
+
+      // copy B (column by column)
+      for(int j=0; j < _systems; j++)
+	std::copy(B.begin() + j*_height, B.begin() + (j+1)*_height, _b.begin() + j*_ldb);
+
+      // call LAPACK
+      char TRANS = 'N';
+      integer M = _height, N = _width, NRHS = _systems, LDA = std::max(1, _height), LDB = _ldb, LWORK = _work.size(), status;
+      routines<T>::gels(&TRANS, &M, &N, &NRHS, A.begin(), &LDA, &_b[0], &LDB, &_work[0], &LWORK, &status);
+      assert(status >= 0);    // UNEXPECTED ERROR, one of the parameters is wrong??
+
+      // copy solution
+      for(int j=0; j < _systems; j++)
+	std::copy(_b.begin() + j*_ldb, _b.begin() + j*_ldb + _width, X.begin() + j*_width);
+
+      return (status == 0);
+    }
+
+  private:
+    int _width, _height, _systems, _ldb;
+    std::vector<T> _b;
+    std::vector<T> _work;
+  };
+
+} // end lapack namespace
+
+
 #endif /* _MAT_OPERATIONS_H_ */
@@ -0,0 +1,82 @@
+#ifndef _PERMUTOHEDRAL_H_
+#define _PERMUTOHEDRAL_H_
+
+#include <vector>
+#include <cstddef>
+
+#include "image.h"
+
+namespace filter {
+
+  ////////////////////////////////////////////////////////
+  // Permutohedral lattice (Adams, Baek & Davis 2010).  //
+  // Filters VD-dimensional values with a Gaussian in a //
+  // D-dimensional feature space.  Values are splatted  //
+  // onto the enclosing simplex of the lattice, blurred //
+  // along each of the D+1 lattice directions and       //
+  // sliced back with the same barycentric weights.     //
+  // Cost is linear in the number of samples.          //
+  //                                                    //
+  // Features must be pre-divided by their sigma.       //
+  ////////////////////////////////////////////////////////
+  template<int D, int VD>
+  class permutohedralLattice {
+  public:
+    /////////////////
+    // Constructor //
+    /////////////////
+    permutohedralLattice(std::size_t expectedSamples=0);
+
+    ////////////////
+    // Inspectors //
+    ////////////////
+    std::size_t numberOfVertices(void) const { return _filled; }
+
+    /////////////
+    // Methods //
+    /////////////
+    void splat(const float* position, const float* value);
+    void blur(void);
+    void slice(const float* position, float* value) const;
+
+  private:
+    /////////////////////
+    // Private Methods //
+    /////////////////////
+    void _embed(const float* position, int* vertexKeys, float* barycentric) const;
+
+    std::size_t _hash(const int* key) const;
+    int _lookup(const int* key) const;
+    int _insert(const int* key);
+    void _grow(void);
+
+    //////////////////
+    // Private Data //
+    //////////////////
+    float _scaleFactor[D];
+    int _canonical[(D+1)*(D+1)];
+
+    std::vector<int> _entries;      // hash table => vertex index or -1
+    std::vector<int> _keys;         // D ints per vertex
+    std::vector<float> _values;     // VD floats per vertex
+    std::size_t _filled;
+  };
+
+
+  ///////////////////////////////////////////////////////
+  // Joint bilateral filter of 'src' with range weights//
+  // on the RGB values of 'guide', computed on a 5D    //
+  // (x, y, r, g, b) permutohedral lattice.  'src' and //
+  // 'dst' may be the same image.                      //
+  ///////////////////////////////////////////////////////
+  void jointBilateralLattice(const image& src, const image& guide, image& dst, float sigmad=5.0f, float sigmar=0.001f);
+
+} // end filter namespace
+
+
+////////////////////
+// Inline Methods //
+////////////////////
+#include "permutohedral.inline.h"
+
+#endif /* _PERMUTOHEDRAL_H_ */
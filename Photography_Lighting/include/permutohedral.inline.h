@@ -0,0 +1,327 @@
+////////////////////////////////////////
+// Inline Methods for permutohedral.h //
+////////////////////////////////////////
+
+#include <cmath>
+#include <algorithm>
+#include "exceptions.h"
+
+namespace filter {
+
+//////////////////////////////
+// permutohedralLattice     //
+//////////////////////////////
+template<int D, int VD>
+inline permutohedralLattice<D,VD>::permutohedralLattice(std::size_t expectedSamples) : _filled(0)
+{
+  // scale factors that project onto the lattice with
+  // a blur of standard deviation 1 per feature unit
+  const float invStdDev = (D + 1) * sqrt(2.0f / 3.0f);
+  for(int i=0; i < D; i++)
+    _scaleFactor[i] = invStdDev / sqrt((float)((i + 1) * (i + 2)));
+
+  // canonical simplex
+  for(int i=0; i <= D; i++)
+  {
+    for(int j=0; j <= D - i; j++) _canonical[i*(D+1) + j] = i;
+    for(int j=D - i + 1; j <= D; j++) _canonical[i*(D+1) + j] = i - (D + 1);
+  }
+
+  // hash table (power of two, at most half full)
+  std::size_t capacity = 1 << 10;
+  while(capacity < 2 * expectedSamples) capacity <<= 1;
+  _entries.assign(capacity, -1);
+  _keys.reserve(expectedSamples * D);
+  _values.reserve(expectedSamples * VD);
+}
+
+
+//////////////////////////////
+// splat                    //
+//////////////////////////////
+template<int D, int VD>
+inline void permutohedralLattice<D,VD>::splat(const float* position, const float* value)
+{
+  int vertexKeys[(D+1)*D];
+  float barycentric[D+2];
+  _embed(position, vertexKeys, barycentric);
+
+  for(int remainder=0; remainder <= D; remainder++)
+  {
+    int vertex = _insert(&vertexKeys[remainder*D]);
+    float* v = &_values[vertex*VD];
+    for(int c=0; c < VD; c++)
+      v[c] += barycentric[remainder] * value[c];
+  }
+}
+
+
+//////////////////////////////
+// blur                     //
+//                          //
+// [1 2 1] / 4 along each   //
+// lattice direction.       //
+//////////////////////////////
+template<int D, int VD>
+inline void permutohedralLattice<D,VD>::blur(void)
+{
+  std::vector<float> newValues(_values.size());
+  const int numVertices = _filled;
+
+  for(int j=0; j <= D; j++)
+  {
+#pragma omp parallel for schedule(static)
+    for(int i=0; i < numVertices; i++)
+    {
+      const int* key = &_keys[i*D];
+      int neighbor1[D+1], neighbor2[D+1];
+
+      for(int k=0; k < D; k++)
+      {
+        neighbor1[k] = key[k] + 1;
+        neighbor2[k] = key[k] - 1;
+      }
+      // the (D+1)-th coordinate is implicit (not stored)
+      if(j < D)
+      {
+        neighbor1[j] = key[j] - D;
+        neighbor2[j] = key[j] + D;
+      }
+
+      int v1 = _lookup(neighbor1);
+      int v2 = _lookup(neighbor2);
+
+      const float* oldValue = &_values[i*VD];
+      float* newValue = &newValues[i*VD];
+      for(int c=0; c < VD; c++)
+      {
+        float sum = 0.5f * oldValue[c];
+        if(v1 >= 0) sum += 0.25f * _values[v1*VD + c];
+        if(v2 >= 0) sum += 0.25f * _values[v2*VD + c];
+        newValue[c] = sum;
+      }
+    }
+
+    _values.swap(newValues);
+  }
+}
+
+
+//////////////////////////////
+// slice                    //
+//////////////////////////////
+template<int D, int VD>
+inline void permutohedralLattice<D,VD>::slice(const float* position, float* value) const
+{
+  int vertexKeys[(D+1)*D];
+  float barycentric[D+2];
+  _embed(position, vertexKeys, barycentric);
+
+  for(int c=0; c < VD; c++) value[c] = 0.0f;
+
+  for(int remainder=0; remainder <= D; remainder++)
+  {
+    int vertex = _lookup(&vertexKeys[remainder*D]);
+    if(vertex < 0) continue;
+
+    const float* v = &_values[vertex*VD];
+    for(int c=0; c < VD; c++)
+      value[c] += barycentric[remainder] * v[c];
+  }
+}
+
+
+//////////////////////////////
+// _embed                   //
+//                          //
+// Find the enclosing       //
+// simplex of 'position'    //
+// and its barycentric      //
+// coordinates.             //
+//////////////////////////////
+template<int D, int VD>
+inline void permutohedralLattice<D,VD>::_embed(const float* position, int* vertexKeys, float* barycentric) const
+{
+  float elevated[D+1];
+  int greedy[D+1];
+  int rank[D+1];
+
+  // elevate onto the hyperplane
+  elevated[D] = -D * position[D-1] * _scaleFactor[D-1];
+  for(int i=D-1; i > 0; i--)
+    elevated[i] = elevated[i+1] - i * position[i-1] * _scaleFactor[i-1] + (i + 2) * position[i] * _scaleFactor[i];
+  elevated[0] = elevated[1] + 2 * position[0] * _scaleFactor[0];
+
+  // closest remainder-0 point
+  int sum = 0;
+  for(int i=0; i <= D; i++)
+  {
+    float v = elevated[i] / (D + 1);
+    int up = (int)(ceil(v)) * (D + 1);
+    int down = (int)(floor(v)) * (D + 1);
+    greedy[i] = (up - elevated[i] < elevated[i] - down) ? up : down;
+    sum += greedy[i];
+  }
+  sum /= D + 1;
+
+  // rank the differential
+  for(int i=0; i <= D; i++) rank[i] = 0;
+  for(int i=0; i < D; i++)
+    for(int j=i+1; j <= D; j++)
+      if(elevated[i] - greedy[i] < elevated[j] - greedy[j]) rank[i]++;
+      else rank[j]++;
+
+  // fix up if the point is not on the hyperplane
+  if(sum > 0)
+  {
+    for(int i=0; i <= D; i++)
+      if(rank[i] >= D + 1 - sum) { greedy[i] -= D + 1; rank[i] += sum - (D + 1); }
+      else rank[i] += sum;
+  }
+  else if(sum < 0)
+  {
+    for(int i=0; i <= D; i++)
+      if(rank[i] < -sum) { greedy[i] += D + 1; rank[i] += (D + 1) + sum; }
+      else rank[i] += sum;
+  }
+
+  // barycentric coordinates
+  for(int i=0; i < D+2; i++) barycentric[i] = 0.0f;
+  for(int i=0; i <= D; i++)
+  {
+    float delta = (elevated[i] - greedy[i]) / (D + 1);
+    barycentric[D - rank[i]] += delta;
+    barycentric[D + 1 - rank[i]] -= delta;
+  }
+  barycentric[0] += 1.0f + barycentric[D + 1];
+
+  // keys of the simplex vertices
+  for(int remainder=0; remainder <= D; remainder++)
+    for(int i=0; i < D; i++)
+      vertexKeys[remainder*D + i] = greedy[i] + _canonical[remainder*(D+1) + rank[i]];
+}
+
+
+//////////////////////////////
+// _hash                    //
+//////////////////////////////
+template<int D, int VD>
+inline std::size_t permutohedralLattice<D,VD>::_hash(const int* key) const
+{
+  std::size_t h = 0;
+  for(int i=0; i < D; i++)
+  {
+    h += key[i];
+    h *= 2531011;
+  }
+  return h;
+}
+
+
+//////////////////////////////
+// _lookup                  //
+//////////////////////////////
+template<int D, int VD>
+inline int permutohedralLattice<D,VD>::_lookup(const int* key) const
+{
+  const std::size_t mask = _entries.size() - 1;
+  for(std::size_t h = _hash(key) & mask; ; h = (h + 1) & mask)
+  {
+    int vertex = _entries[h];
+    if(vertex < 0) return -1;
+    if(std::equal(key, key + D, &_keys[vertex*D])) return vertex;
+  }
+}
+
+
+//////////////////////////////
+// _insert                  //
+//////////////////////////////
+template<int D, int VD>
+inline int permutohedralLattice<D,VD>::_insert(const int* key)
+{
+  if(2 * (_filled + 1) > _entries.size()) _grow();
+
+  const std::size_t mask = _entries.size() - 1;
+  for(std::size_t h = _hash(key) & mask; ; h = (h + 1) & mask)
+  {
+    int vertex = _entries[h];
+    if(vertex >= 0)
+    {
+      if(std::equal(key, key + D, &_keys[vertex*D])) return vertex;
+      continue;
+    }
+
+    // new vertex
+    vertex = _filled++;
+    _entries[h] = vertex;
+    _keys.insert(_keys.end(), key, key + D);
+    _values.resize(_values.size() + VD, 0.0f);
+    return vertex;
+  }
+}
+
+
+//////////////////////////////
+// _grow                    //
+//////////////////////////////
+template<int D, int VD>
+inline void permutohedralLattice<D,VD>::_grow(void)
+{
+  std::vector<int> entries(2 * _entries.size(), -1);
+  const std::size_t mask = entries.size() - 1;
+
+  for(std::size_t vertex=0; vertex < _filled; vertex++)
+  {
+    std::size_t h = _hash(&_keys[vertex*D]) & mask;
+    while(entries[h] >= 0) h = (h + 1) & mask;
+    entries[h] = vertex;
+  }
+
+  _entries.swap(entries);
+}
+
+
+//////////////////////////////
+// jointBilateralLattice    //
+//////////////////////////////
+inline void jointBilateralLattice(const image& src, const image& guide, image& dst, float sigmad, float sigmar)
+{
+  // sanity check
+  if(src.width() != guide.width() || src.height() != guide.height()) throw buffer2dIllegalSize();
+
+  const int width = src.width();
+  const int height = src.height();
+  permutohedralLattice<5,4> lattice(src.size() / 8);
+
+  // splat (x, y, r, g, b) => (r, g, b, 1)
+  for(int y=0; y < height; y++)
+    for(int x=0; x < width; x++)
+    {
+      const color<float>& g = guide(x,y);
+      const color<float>& s = src(x,y);
+      float position[5] = { x / sigmad, y / sigmad, g.r / sigmar, g.g / sigmar, g.b / sigmar };
+      float value[4] = { s.r, s.g, s.b, 1.0f };
+      lattice.splat(position, value);
+    }
+
+  lattice.blur();
+
+  // slice (safe to write into src/guide only after all reads)
+  image temp(width, height);
+
+#pragma omp parallel for schedule(dynamic)
+  for(int y=0; y < height; y++)
+    for(int x=0; x < width; x++)
+    {
+      const color<float>& g = guide(x,y);
+      float position[5] = { x / sigmad, y / sigmad, g.r / sigmar, g.g / sigmar, g.b / sigmar };
+      float value[4];
+      lattice.slice(position, value);
+      temp(x,y) = (value[3] > 0.0f) ? color<float>(value[0], value[1], value[2]) / value[3] : src(x,y);
+    }
+
+  swap(temp, dst);
+}
+
+} // end filter namespace
@@ -0,0 +1,235 @@
+#ifndef _PLANARIMAGE_H_
+#define _PLANARIMAGE_H_
+
+#include <cstddef>
+#include <boost/utility/enable_if.hpp>
+#include <boost/type_traits/remove_const.hpp>
+#include <boost/type_traits/is_convertible.hpp>
+#include <boost/iterator/iterator_facade.hpp>
+
+#include "color.h"
+#include "image.h"
+#include "simd.h"
+#include "exceptions.h"
+
+/////////////////////////////////////////////////////////
+// Pixel of a planar_image: a proxy to the Channels    //
+// values of one pixel, one per plane.  It behaves as  //
+// a reference (copying it does not copy the values)   //
+// and provides the iterator interface expected from   //
+// a pixel type by the io routines.                    //
+/////////////////////////////////////////////////////////
+template<typename T, unsigned int Channels>
+class planar_pixel {
+ public:
+  ///////////////
+  // type defs //
+  ///////////////
+  typedef typename boost::remove_const<T>::type   value_type;
+  typedef buffer2d_iterator<T>                    iterator;
+  typedef buffer2d_iterator<const T>              const_iterator;
+  typedef T&                                      reference;
+  typedef const value_type&                       const_reference;
+
+  //////////////////
+  // Constructors //
+  //////////////////
+  planar_pixel(T* ptr, std::ptrdiff_t planeStride) : _ptr(ptr), _planeStride(planeStride) {}
+
+  /////////////
+  // Methods //
+  /////////////
+  iterator begin(void) const  { return iterator(_ptr, 0, 1, _planeStride); }
+  iterator end(void) const    { return iterator(_ptr + Channels*_planeStride, 0, 1, _planeStride); }
+
+  std::size_t size(void) const                { return Channels; }
+  reference operator[](std::size_t c) const   { return _ptr[c*_planeStride]; }
+
+ private:
+  //////////////////////////
+  // Private Data Members //
+  //////////////////////////
+  T* _ptr;
+  std::ptrdiff_t _planeStride;
+};
+
+
+/////////////////////////////////////////////////////////
+// Row-major iterator over the pixels of a             //
+// planar_image; dereferencing yields a planar_pixel.  //
+/////////////////////////////////////////////////////////
+template<typename T, unsigned int Channels>
+class planar_image_iterator : public boost::iterator_facade< planar_image_iterator<T, Channels>, planar_pixel<T, Channels>, boost::random_access_traversal_tag, planar_pixel<T, Channels> >
+{
+ public:
+  typedef std::ptrdiff_t   difference_type;
+
+  planar_image_iterator(void) : _itr(), _planeStride(0) {}
+  planar_image_iterator(const buffer2d_iterator<T>& itr, difference_type planeStride) : _itr(itr), _planeStride(planeStride) {}
+
+  template<typename S>
+    planar_image_iterator(const planar_image_iterator<S, Channels>& itr, typename boost::enable_if< boost::is_convertible<S*, T*> >::type* = 0) : _itr(itr._itr), _planeStride(itr._planeStride) {}
+
+ private:
+  friend class boost::iterator_core_access;
+  template<typename S, unsigned int C> friend class planar_image_iterator;
+
+  template<typename S>
+    bool equal(const planar_image_iterator<S, Channels>& other) const   { return _itr == other._itr; }
+
+  void increment(void)                  { ++_itr; }
+  void decrement(void)                  { --_itr; }
+  void advance(difference_type n)       { _itr += n; }
+
+  template<typename S>
+    difference_type distance_to(const planar_image_iterator<S, Channels>& other) const { return buffer2d_iterator<const T>(other._itr) - buffer2d_iterator<const T>(_itr); }
+
+  planar_pixel<T, Channels> dereference(void) const { return planar_pixel<T, Channels>(_itr.base(), _planeStride); }
+
+  //////////////////
+  // Data Members //
+  //////////////////
+  buffer2d_iterator<T> _itr;
+  difference_type _planeStride;
+};
+
+
+/////////////////////////////////////////////////////////
+// Planar (structure of arrays) image: every channel   //
+// is stored in its own plane.  All planes share a     //
+// single allocation and a row stride; by default      //
+// every row of every plane is 64-byte aligned, such   //
+// that per channel operations can use full-width      //
+// vector loads.  Channel views do not copy data.      //
+/////////////////////////////////////////////////////////
+template<typename T, unsigned int Channels>
+class planar_image {
+ public:
+  ///////////////
+  // type defs //
+  ///////////////
+  typedef T                                          value_type;
+  typedef planar_pixel<T, Channels>                  pixel_type;
+  typedef planar_image_iterator<T, Channels>         iterator;
+  typedef planar_image_iterator<const T, Channels>   const_iterator;
+  typedef buffer2d_view<T>                           channel_view;
+  typedef const_buffer2d_view<T>                     const_channel_view;
+  typedef size_t                                     size_type;
+
+  static const unsigned int channels = Channels;
+
+  //////////////////
+  // Constructors //
+  //////////////////
+  explicit planar_image(size_type width=0, size_type height=0, const buffer2dLayout& layout=buffer2dLayout::aligned()) : _height(height), _planes(width, height*Channels, layout) {}
+
+  ///////////////
+  // Iterators //
+  ///////////////
+  iterator          begin(void)         { return iterator(_planes.begin(), _planeStride()); }
+  const_iterator    begin(void) const   { return const_iterator(_planes.begin(), _planeStride()); }
+  iterator          end(void)           { return iterator(typename buffer2d<T>::iterator(_planes.row(_height), 0, width(), stride()), _planeStride()); }
+  const_iterator    end(void) const     { return const_iterator(typename buffer2d<T>::const_iterator(_planes.row(_height), 0, width(), stride()), _planeStride()); }
+
+  ////////////////
+  // Inspectors //
+  ////////////////
+  size_type width(void) const   { return _planes.width(); }
+  size_type height(void) const  { return _height; }
+  size_type size(void) const    { return width() * height(); }
+  size_type stride(void) const  { return _planes.stride(); }
+
+  bool empty(void) const { return (width() == 0) || (height() == 0); }
+
+  const buffer2dLayout& layout(void) const { return _planes.layout(); }
+
+  channel_view        channel(unsigned int c)         { _checkChannel(c); return channel_view(_planes.row(c*_height), width(), height(), stride()); }
+  const_channel_view  channel(unsigned int c) const   { _checkChannel(c); return const_channel_view(_planes.row(c*_height), width(), height(), stride()); }
+
+  T*        row(unsigned int c, size_type y)         { return _planes.row(c*_height + y); }
+  const T*  row(unsigned int c, size_type y) const   { return _planes.row(c*_height + y); }
+
+  pixel_type                            operator()(size_type x, size_type y)        { return pixel_type(row(0, y) + x, _planeStride()); }
+  planar_pixel<const T, Channels>       operator()(size_type x, size_type y) const  { return planar_pixel<const T, Channels>(row(0, y) + x, _planeStride()); }
+
+  T&        operator()(size_type x, size_type y, unsigned int c)         { return row(c, y)[x]; }
+  const T&  operator()(size_type x, size_type y, unsigned int c) const   { return row(c, y)[x]; }
+
+  /////////////
+  // Methods //
+  /////////////
+  void resize(size_type newWidth, size_type newHeight)  { _planes.resize(newWidth, newHeight*Channels); _height = newHeight; }
+  void clear(const T& s=(T)(0))                         { _planes.clear(s); }
+
+  /////////////
+  // Friends //
+  /////////////
+  friend void swap(planar_image<T, Channels>& a, planar_image<T, Channels>& b)   { std::swap(a._height, b._height); swap(a._planes, b._planes); }
+
+ private:
+  std::ptrdiff_t _planeStride(void) const  { return (std::ptrdiff_t)(_height * stride()); }
+  void _checkChannel(unsigned int c) const { if(c >= Channels) throw customException("planar_image: channel out of range."); }
+
+  //////////////////////////
+  // Private Data Members //
+  //////////////////////////
+  size_type _height;
+  buffer2d<T> _planes;      // Channels planes stacked vertically
+};
+
+typedef planar_image<float, 3>  planar_rgb_image;
+
+
+/////////////////////////////////////////////////////////
+// Conversion of a single row between interleaved      //
+// pixels and planes.  The generic version copies      //
+// channel by channel; color<float> <-> 3 float planes //
+// is vectorized.                                      //
+/////////////////////////////////////////////////////////
+template<typename P, typename T, unsigned int Channels>
+struct planarKernel {
+  static void deinterleave(const P* src, T* const* planes, std::size_t n)
+  {
+    for(std::size_t x=0; x < n; x++)
+      for(unsigned int c=0; c < Channels; c++)
+        planes[c][x] = (T)(src[x][c]);
+  }
+
+  static void interleave(const T* const* planes, P* dst, std::size_t n)
+  {
+    for(std::size_t x=0; x < n; x++)
+      for(unsigned int c=0; c < Channels; c++)
+        dst[x][c] = planes[c][x];
+  }
+};
+
+template<>
+struct planarKernel<color<float>, float, 3> {
+  static void deinterleave(const color<float>* src, float* const* planes, std::size_t n)  { simd::deinterleave(&src->r, planes[0], planes[1], planes[2], n); }
+  static void interleave(const float* const* planes, color<float>* dst, std::size_t n)    { simd::interleave(planes[0], planes[1], planes[2], &dst->r, n); }
+};
+
+
+/////////////////////////////////////////////////////////
+// Convert between an interleaved buffer (e.g., image) //
+// and a planar_image.  The destination is resized.    //
+/////////////////////////////////////////////////////////
+template<typename P, typename T, unsigned int Channels>
+  void deinterleave(const const_buffer2d_view<P>& src, planar_image<T, Channels>& dst);
+
+template<typename P, typename T, unsigned int Channels>
+  void deinterleave(const buffer2d<P>& src, planar_image<T, Channels>& dst);
+
+template<typename P, typename T, unsigned int Channels>
+  void interleave(const planar_image<T, Channels>& src, const buffer2d_view<P>& dst);
+
+template<typename P, typename T, unsigned int Channels>
+  void interleave(const planar_image<T, Channels>& src, buffer2d<P>& dst);
+
+
+////////////////////
+// Inline Methods //
+////////////////////
+#include "planarImage.inline.h"
+
+#endif /* _PLANARIMAGE_H_ */
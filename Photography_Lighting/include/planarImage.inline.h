@@ -0,0 +1,60 @@
+//////////////////////////////////////
+// Inline Methods for planarImage.h //
+//////////////////////////////////////
+
+//////////////////////////////
+// deinterleave             //
+//////////////////////////////
+template<typename P, typename T, unsigned int Channels>
+inline void deinterleave(const const_buffer2d_view<P>& src, planar_image<T, Channels>& dst)
+{
+  dst.resize(src.width(), src.height());
+
+  T* planes[Channels];
+  for(typename planar_image<T, Channels>::size_type y=0; y < src.height(); y++)
+  {
+    for(unsigned int c=0; c < Channels; c++)
+      planes[c] = dst.row(c, y);
+
+    planarKernel<P, T, Channels>::deinterleave(src.row(y), planes, src.width());
+  }
+
+  // done.
+}
+
+
+template<typename P, typename T, unsigned int Channels>
+inline void deinterleave(const buffer2d<P>& src, planar_image<T, Channels>& dst)
+{
+  deinterleave(const_buffer2d_view<P>(src), dst);
+}
+
+
+//////////////////////////////
+// interleave               //
+//////////////////////////////
+template<typename P, typename T, unsigned int Channels>
+inline void interleave(const planar_image<T, Channels>& src, const buffer2d_view<P>& dst)
+{
+  // sanity check
+  dst.checkSize(src);
+
+  const T* planes[Channels];
+  for(typename planar_image<T, Channels>::size_type y=0; y < src.height(); y++)
+  {
+    for(unsigned int c=0; c < Channels; c++)
+      planes[c] = src.row(c, y);
+
+    planarKernel<P, T, Channels>::interleave(planes, dst.row(y), src.width());
+  }
+
+  // done.
+}
+
+
+template<typename P, typename T, unsigned int Channels>
+inline void interleave(const planar_image<T, Channels>& src, buffer2d<P>& dst)
+{
+  dst.resize(src.width(), src.height());
+  interleave(src, buffer2d_view<P>(dst));
+}
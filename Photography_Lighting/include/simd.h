@@ -0,0 +1,77 @@
+#ifndef _SIMD_H_
+#define _SIMD_H_
+
+#include <cstddef>
+
+//////////////////////////////////////////////////////////
+// Vectorized kernels on flat float arrays (e.g., the   //
+// r,g,b floats underneath an image).  Element-wise     //
+// kernels have AVX2 and SSE2 paths, reductions an SSE2 //
+// path, and all have a scalar fallback; the path is    //
+// selected at run time from the CPU features.  Kernels //
+// may operate in place (dst == a or dst == b).         //
+//////////////////////////////////////////////////////////
+
+namespace simd {
+
+  ///////////////////////////////
+  // dst[i] = a[i] op b[i]     //
+  ///////////////////////////////
+  void add(const float* a, const float* b, float* dst, std::size_t n);
+  void subtract(const float* a, const float* b, float* dst, std::size_t n);
+  void multiply(const float* a, const float* b, float* dst, std::size_t n);
+  void divide(const float* a, const float* b, float* dst, std::size_t n);
+
+  ///////////////////////////////////////
+  // dst[i] = a[i] op s[i % 3], i.e.,  //
+  // with a color (3 floats) as scalar //
+  ///////////////////////////////////////
+  void addScalar(const float* a, const float* s, float* dst, std::size_t n);
+  void subtractScalar(const float* a, const float* s, float* dst, std::size_t n);
+  void multiplyScalar(const float* a, const float* s, float* dst, std::size_t n);
+  void divideScalar(const float* a, const float* s, float* dst, std::size_t n);
+
+  /////////////////////////////////////////
+  // dst[i] = pow(a[i], e).  Positive    //
+  // normal inputs use a polynomial      //
+  // log2/exp2 (relative error ~1e-6);   //
+  // all other inputs go to std::pow.    //
+  /////////////////////////////////////////
+  void power(const float* a, float e, float* dst, std::size_t n);
+
+  ////////////////
+  // Reductions //
+  ////////////////
+  double sum(const float* a, std::size_t n);
+  float min(const float* a, std::size_t n);
+  float max(const float* a, std::size_t n);
+
+  // per channel sum of 'pixels' interleaved r,g,b triplets
+  void channelSum(const float* rgb, std::size_t pixels, double result[3]);
+
+  // index of the first triplet with the largest/smallest r*r+g*g+b*b
+  std::size_t maxLength(const float* rgb, std::size_t pixels);
+  std::size_t minLength(const float* rgb, std::size_t pixels);
+
+  ///////////////////////////////////////////
+  // Conversion between interleaved r,g,b  //
+  // triplets and three separate planes    //
+  ///////////////////////////////////////////
+  void deinterleave(const float* rgb, float* r, float* g, float* b, std::size_t pixels);
+  void interleave(const float* r, const float* g, const float* b, float* rgb, std::size_t pixels);
+
+  //////////////////////
+  // Runtime dispatch //
+  //////////////////////
+  bool hasSSE2(void);
+  bool hasAVX2(void);
+
+} // end simd namespace
+
+
+////////////////////
+// Inline Methods //
+////////////////////
+#include "simd.inline.h"
+
+#endif /* _SIMD_H_ */
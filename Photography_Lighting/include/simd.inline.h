@@ -0,0 +1,695 @@
+///////////////////////////////
+// Inline Methods for simd.h //
+///////////////////////////////
+
+#include <cmath>
+#include <limits>
+#include <algorithm>
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || (defined(__i386__) && defined(__SSE2__)))
+  #define SIMD_X86
+  #define SIMD_TARGET_AVX2 __attribute__((target("avx2")))
+  #include <immintrin.h>
+#endif
+
+namespace simd {
+
+//////////////////////////////
+// hasSSE2                  //
+//////////////////////////////
+inline bool hasSSE2(void)
+{
+#ifdef SIMD_X86
+  return true;
+#else
+  return false;
+#endif
+}
+
+
+//////////////////////////////
+// hasAVX2                  //
+//////////////////////////////
+inline bool hasAVX2(void)
+{
+#ifdef SIMD_X86
+  static const bool avx2 = (__builtin_cpu_init(), __builtin_cpu_supports("avx2") != 0);
+  return avx2;
+#else
+  return false;
+#endif
+}
+
+
+namespace detail {
+
+  ////////////////////////////////
+  // Element-wise operations    //
+  ////////////////////////////////
+  struct addOp {
+    static float scalar(float a, float b) { return a + b; }
+#ifdef SIMD_X86
+    static __m128 sse(__m128 a, __m128 b) { return _mm_add_ps(a, b); }
+    SIMD_TARGET_AVX2 static __m256 avx(__m256 a, __m256 b) { return _mm256_add_ps(a, b); }
+#endif
+  };
+
+  struct subtractOp {
+    static float scalar(float a, float b) { return a - b; }
+#ifdef SIMD_X86
+    static __m128 sse(__m128 a, __m128 b) { return _mm_sub_ps(a, b); }
+    SIMD_TARGET_AVX2 static __m256 avx(__m256 a, __m256 b) { return _mm256_sub_ps(a, b); }
+#endif
+  };
+
+  struct multiplyOp {
+    static float scalar(float a, float b) { return a * b; }
+#ifdef SIMD_X86
+    static __m128 sse(__m128 a, __m128 b) { return _mm_mul_ps(a, b); }
+    SIMD_TARGET_AVX2 static __m256 avx(__m256 a, __m256 b) { return _mm256_mul_ps(a, b); }
+#endif
+  };
+
+  struct divideOp {
+    static float scalar(float a, float b) { return a / b; }
+#ifdef SIMD_X86
+    static __m128 sse(__m128 a, __m128 b) { return _mm_div_ps(a, b); }
+    SIMD_TARGET_AVX2 static __m256 avx(__m256 a, __m256 b) { return _mm256_div_ps(a, b); }
+#endif
+  };
+
+
+  ////////////////////////////////
+  // a op b                     //
+  ////////////////////////////////
+  template<typename Op>
+  inline void binaryScalar(const float* a, const float* b, float* dst, std::size_t i, std::size_t n)
+  {
+    for(; i < n; i++)
+      dst[i] = Op::scalar(a[i], b[i]);
+  }
+
+#ifdef SIMD_X86
+  template<typename Op>
+  inline void binarySSE(const float* a, const float* b, float* dst, std::size_t n)
+  {
+    std::size_t i = 0;
+    for(; i + 8 <= n; i += 8)
+    {
+      __m128 r0 = Op::sse(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i));
+      __m128 r1 = Op::sse(_mm_loadu_ps(a + i + 4), _mm_loadu_ps(b + i + 4));
+      _mm_storeu_ps(dst + i, r0);
+      _mm_storeu_ps(dst + i + 4, r1);
+    }
+    binaryScalar<Op>(a, b, dst, i, n);
+  }
+
+  template<typename Op>
+  SIMD_TARGET_AVX2 inline void binaryAVX2(const float* a, const float* b, float* dst, std::size_t n)
+  {
+    std::size_t i = 0;
+    for(; i + 16 <= n; i += 16)
+    {
+      __m256 r0 = Op::avx(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i));
+      __m256 r1 = Op::avx(_mm256_loadu_ps(a + i + 8), _mm256_loadu_ps(b + i + 8));
+      _mm256_storeu_ps(dst + i, r0);
+      _mm256_storeu_ps(dst + i + 8, r1);
+    }
+    for(; i + 8 <= n; i += 8)
+      _mm256_storeu_ps(dst + i, Op::avx(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i)));
+    binaryScalar<Op>(a, b, dst, i, n);
+  }
+#endif
+
+  template<typename Op>
+  inline void binary(const float* a, const float* b, float* dst, std::size_t n)
+  {
+#ifdef SIMD_X86
+    if(hasAVX2()) { binaryAVX2<Op>(a, b, dst, n); return; }
+    if(hasSSE2()) { binarySSE<Op>(a, b, dst, n); return; }
+#endif
+    binaryScalar<Op>(a, b, dst, 0, n);
+  }
+
+
+  ////////////////////////////////
+  // a op s (s: 3 floats that   //
+  // repeat along the array)    //
+  ////////////////////////////////
+  template<typename Op>
+  inline void scalarScalar(const float* a, const float* s, float* dst, std::size_t i, std::size_t n)
+  {
+    for(; i < n; i++)
+      dst[i] = Op::scalar(a[i], s[i % 3]);
+  }
+
+#ifdef SIMD_X86
+  template<typename Op>
+  inline void scalarSSE(const float* a, const float* s, float* dst, std::size_t n)
+  {
+    // 12 floats = lcm(3, 4)
+    float pattern[12];
+    for(unsigned int k=0; k < 12; k++) pattern[k] = s[k % 3];
+    const __m128 s0 = _mm_loadu_ps(pattern);
+    const __m128 s1 = _mm_loadu_ps(pattern + 4);
+    const __m128 s2 = _mm_loadu_ps(pattern + 8);
+
+    std::size_t i = 0;
+    for(; i + 12 <= n; i += 12)
+    {
+      __m128 r0 = Op::sse(_mm_loadu_ps(a + i), s0);
+      __m128 r1 = Op::sse(_mm_loadu_ps(a + i + 4), s1);
+      __m128 r2 = Op::sse(_mm_loadu_ps(a + i + 8), s2);
+      _mm_storeu_ps(dst + i, r0);
+      _mm_storeu_ps(dst + i + 4, r1);
+      _mm_storeu_ps(dst + i + 8, r2);
+    }
+    scalarScalar<Op>(a, s, dst, i, n);
+  }
+
+  template<typename Op>
+  SIMD_TARGET_AVX2 inline void scalarAVX2(const float* a, const float* s, float* dst, std::size_t n)
+  {
+    // 24 floats = lcm(3, 8)
+    float pattern[24];
+    for(unsigned int k=0; k < 24; k++) pattern[k] = s[k % 3];
+    const __m256 s0 = _mm256_loadu_ps(pattern);
+    const __m256 s1 = _mm256_loadu_ps(pattern + 8);
+    const __m256 s2 = _mm256_loadu_ps(pattern + 16);
+
+    std::size_t i = 0;
+    for(; i + 24 <= n; i += 24)
+    {
+      __m256 r0 = Op::avx(_mm256_loadu_ps(a + i), s0);
+      __m256 r1 = Op::avx(_mm256_loadu_ps(a + i + 8), s1);
+      __m256 r2 = Op::avx(_mm256_loadu_ps(a + i + 16), s2);
+      _mm256_storeu_ps(dst + i, r0);
+      _mm256_storeu_ps(dst + i + 8, r1);
+      _mm256_storeu_ps(dst + i + 16, r2);
+    }
+    scalarScalar<Op>(a, s, dst, i, n);
+  }
+#endif
+
+  template<typename Op>
+  inline void scalar(const float* a, const float* s, float* dst, std::size_t n)
+  {
+#ifdef SIMD_X86
+    if(hasAVX2()) { scalarAVX2<Op>(a, s, dst, n); return; }
+    if(hasSSE2()) { scalarSSE<Op>(a, s, dst, n); return; }
+#endif
+    scalarScalar<Op>(a, s, dst, 0, n);
+  }
+
+
+  ////////////////////////////////
+  // pow(a, e) = 2^(e log2(a))  //
+  //                            //
+  // log2: Cephes logf on the   //
+  // mantissa in [sqrt(.5),     //
+  // sqrt(2)); exp2: Cephes     //
+  // exp2f on [-.5, .5].  Only  //
+  // used for positive normal   //
+  // a with e log2(a) in        //
+  // [-126, 127]; other blocks  //
+  // go to std::pow.            //
+  ////////////////////////////////
+  inline void powerScalar(const float* a, float e, float* dst, std::size_t i, std::size_t n)
+  {
+    for(; i < n; i++)
+      dst[i] = std::pow(a[i], e);
+  }
+
+#ifdef SIMD_X86
+  inline __m128 log2SSE(__m128 x)
+  {
+    const __m128 one = _mm_set1_ps(1.0f);
+    __m128i bits = _mm_castps_si128(x);
+    __m128i exponent = _mm_sub_epi32(_mm_srli_epi32(bits, 23), _mm_set1_epi32(127));
+    __m128 m = _mm_or_ps(_mm_and_ps(x, _mm_castsi128_ps(_mm_set1_epi32(0x007fffff))), one);
+
+    // m in [sqrt(.5), sqrt(2))
+    __m128 big = _mm_cmpgt_ps(m, _mm_set1_ps(1.41421356f));
+    m = _mm_sub_ps(m, _mm_and_ps(big, _mm_mul_ps(m, _mm_set1_ps(0.5f))));
+    exponent = _mm_sub_epi32(exponent, _mm_castps_si128(big));
+
+    __m128 f = _mm_sub_ps(m, one);
+    __m128 z = _mm_mul_ps(f, f);
+    __m128 p = _mm_set1_ps(7.0376836292E-2f);
+    p = _mm_add_ps(_mm_mul_ps(p, f), _mm_set1_ps(-1.1514610310E-1f));
+    p = _mm_add_ps(_mm_mul_ps(p, f), _mm_set1_ps(1.1676998740E-1f));
+    p = _mm_add_ps(_mm_mul_ps(p, f), _mm_set1_ps(-1.2420140846E-1f));
+    p = _mm_add_ps(_mm_mul_ps(p, f), _mm_set1_ps(1.4249322787E-1f));
+    p = _mm_add_ps(_mm_mul_ps(p, f), _mm_set1_ps(-1.6668057665E-1f));
+    p = _mm_add_ps(_mm_mul_ps(p, f), _mm_set1_ps(2.0000714765E-1f));
+    p = _mm_add_ps(_mm_mul_ps(p, f), _mm_set1_ps(-2.4999993993E-1f));
+    p = _mm_add_ps(_mm_mul_ps(p, f), _mm_set1_ps(3.3333331174E-1f));
+    p = _mm_mul_ps(_mm_mul_ps(p, f), z);
+    p = _mm_sub_ps(p, _mm_mul_ps(z, _mm_set1_ps(0.5f)));
+    __m128 ln = _mm_add_ps(f, p);
+
+    return _mm_add_ps(_mm_cvtepi32_ps(exponent), _mm_mul_ps(ln, _mm_set1_ps(1.44269504089f)));
+  }
+
+  inline __m128 exp2SSE(__m128 t)
+  {
+    __m128i i = _mm_cvtps_epi32(t);
+    __m128 f = _mm_sub_ps(t, _mm_cvtepi32_ps(i));
+
+    __m128 p = _mm_set1_ps(1.535336188319500E-4f);
+    p = _mm_add_ps(_mm_mul_ps(p, f), _mm_set1_ps(1.339887440266574E-3f));
+    p = _mm_add_ps(_mm_mul_ps(p, f), _mm_set1_ps(9.618437357674640E-3f));
+    p = _mm_add_ps(_mm_mul_ps(p, f), _mm_set1_ps(5.550332471162809E-2f));
+    p = _mm_add_ps(_mm_mul_ps(p, f), _mm_set1_ps(2.402264791363012E-1f));
+    p = _mm_add_ps(_mm_mul_ps(p, f), _mm_set1_ps(6.931472028550421E-1f));
+    p = _mm_add_ps(_mm_mul_ps(p, f), _mm_set1_ps(1.0f));
+
+    __m128 scale = _mm_castsi128_ps(_mm_slli_epi32(_mm_add_epi32(i, _mm_set1_epi32(127)), 23));
+    return _mm_mul_ps(p, scale);
+  }
+
+  inline void powerSSE(const float* a, float e, float* dst, std::size_t n)
+  {
+    const __m128 exponent = _mm_set1_ps(e);
+    const __m128 lo = _mm_set1_ps(std::numeric_limits<float>::min());
+    const __m128 hi = _mm_set1_ps(std::numeric_limits<float>::max());
+    const __m128 tlo = _mm_set1_ps(-126.0f);
+    const __m128 thi = _mm_set1_ps(127.0f);
+
+    std::size_t i = 0;
+    for(; i + 4 <= n; i += 4)
+    {
+      __m128 x = _mm_loadu_ps(a + i);
+      __m128 valid = _mm_and_ps(_mm_cmpge_ps(x, lo), _mm_cmple_ps(x, hi));
+      if(_mm_movemask_ps(valid) != 0xf) { powerScalar(a, e, dst, i, i + 4); continue; }
+
+      __m128 t = _mm_mul_ps(exponent, log2SSE(x));
+      valid = _mm_and_ps(_mm_cmpge_ps(t, tlo), _mm_cmple_ps(t, thi));
+      if(_mm_movemask_ps(valid) != 0xf) { powerScalar(a, e, dst, i, i + 4); continue; }
+
+      _mm_storeu_ps(dst + i, exp2SSE(t));
+    }
+    powerScalar(a, e, dst, i, n);
+  }
+
+  SIMD_TARGET_AVX2 inline __m256 log2AVX2(__m256 x)
+  {
+    const __m256 one = _mm256_set1_ps(1.0f);
+    __m256i bits = _mm256_castps_si256(x);
+    __m256i exponent = _mm256_sub_epi32(_mm256_srli_epi32(bits, 23), _mm256_set1_epi32(127));
+    __m256 m = _mm256_or_ps(_mm256_and_ps(x, _mm256_castsi256_ps(_mm256_set1_epi32(0x007fffff))), one);
+
+    // m in [sqrt(.5), sqrt(2))
+    __m256 big = _mm256_cmp_ps(m, _mm256_set1_ps(1.41421356f), _CMP_GT_OQ);
+    m = _mm256_sub_ps(m, _mm256_and_ps(big, _mm256_mul_ps(m, _mm256_set1_ps(0.5f))));
+    exponent = _mm256_sub_epi32(exponent, _mm256_castps_si256(big));
+
+    __m256 f = _mm256_sub_ps(m, one);
+    __m256 z = _mm256_mul_ps(f, f);
+    __m256 p = _mm256_set1_ps(7.0376836292E-2f);
+    p = _mm256_add_ps(_mm256_mul_ps(p, f), _mm256_set1_ps(-1.1514610310E-1f));
+    p = _mm256_add_ps(_mm256_mul_ps(p, f), _mm256_set1_ps(1.1676998740E-1f));
+    p = _mm256_add_ps(_mm256_mul_ps(p, f), _mm256_set1_ps(-1.2420140846E-1f));
+    p = _mm256_add_ps(_mm256_mul_ps(p, f), _mm256_set1_ps(1.4249322787E-1f));
+    p = _mm256_add_ps(_mm256_mul_ps(p, f), _mm256_set1_ps(-1.6668057665E-1f));
+    p = _mm256_add_ps(_mm256_mul_ps(p, f), _mm256_set1_ps(2.0000714765E-1f));
+    p = _mm256_add_ps(_mm256_mul_ps(p, f), _mm256_set1_ps(-2.4999993993E-1f));
+    p = _mm256_add_ps(_mm256_mul_ps(p, f), _mm256_set1_ps(3.3333331174E-1f));
+    p = _mm256_mul_ps(_mm256_mul_ps(p, f), z);
+    p = _mm256_sub_ps(p, _mm256_mul_ps(z, _mm256_set1_ps(0.5f)));
+    __m256 ln = _mm256_add_ps(f, p);
+
+    return _mm256_add_ps(_mm256_cvtepi32_ps(exponent), _mm256_mul_ps(ln, _mm256_set1_ps(1.44269504089f)));
+  }
+
+  SIMD_TARGET_AVX2 inline __m256 exp2AVX2(__m256 t)
+  {
+    __m256i i = _mm256_cvtps_epi32(t);
+    __m256 f = _mm256_sub_ps(t, _mm256_cvtepi32_ps(i));
+
+    __m256 p = _mm256_set1_ps(1.535336188319500E-4f);
+    p = _mm256_add_ps(_mm256_mul_ps(p, f), _mm256_set1_ps(1.339887440266574E-3f));
+    p = _mm256_add_ps(_mm256_mul_ps(p, f), _mm256_set1_ps(9.618437357674640E-3f));
+    p = _mm256_add_ps(_mm256_mul_ps(p, f), _mm256_set1_ps(5.550332471162809E-2f));
+    p = _mm256_add_ps(_mm256_mul_ps(p, f), _mm256_set1_ps(2.402264791363012E-1f));
+    p = _mm256_add_ps(_mm256_mul_ps(p, f), _mm256_set1_ps(6.931472028550421E-1f));
+    p = _mm256_add_ps(_mm256_mul_ps(p, f), _mm256_set1_ps(1.0f));
+
+    __m256 scale = _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_add_epi32(i, _mm256_set1_epi32(127)), 23));
+    return _mm256_mul_ps(p, scale);
+  }
+
+  SIMD_TARGET_AVX2 inline void powerAVX2(const float* a, float e, float* dst, std::size_t n)
+  {
+    const __m256 exponent = _mm256_set1_ps(e);
+    const __m256 lo = _mm256_set1_ps(std::numeric_limits<float>::min());
+    const __m256 hi = _mm256_set1_ps(std::numeric_limits<float>::max());
+    const __m256 tlo = _mm256_set1_ps(-126.0f);
+    const __m256 thi = _mm256_set1_ps(127.0f);
+
+    std::size_t i = 0;
+    for(; i + 8 <= n; i += 8)
+    {
+      __m256 x = _mm256_loadu_ps(a + i);
+      __m256 valid = _mm256_and_ps(_mm256_cmp_ps(x, lo, _CMP_GE_OQ), _mm256_cmp_ps(x, hi, _CMP_LE_OQ));
+      if(_mm256_movemask_ps(valid) != 0xff) { powerScalar(a, e, dst, i, i + 8); continue; }
+
+      __m256 t = _mm256_mul_ps(exponent, log2AVX2(x));
+      valid = _mm256_and_ps(_mm256_cmp_ps(t, tlo, _CMP_GE_OQ), _mm256_cmp_ps(t, thi, _CMP_LE_OQ));
+      if(_mm256_movemask_ps(valid) != 0xff) { powerScalar(a, e, dst, i, i + 8); continue; }
+
+      _mm256_storeu_ps(dst + i, exp2AVX2(t));
+    }
+    powerScalar(a, e, dst, i, n);
+  }
+#endif
+
+
+  ////////////////////////////////
+  // Length reductions: process //
+  // 4 r,g,b triplets at a time //
+  ////////////////////////////////
+  struct greaterOp {
+    static bool scalar(float a, float b) { return a > b; }
+#ifdef SIMD_X86
+    static __m128 sse(__m128 a, __m128 b) { return _mm_cmpgt_ps(a, b); }
+#endif
+  };
+
+  struct lessOp {
+    static bool scalar(float a, float b) { return a < b; }
+#ifdef SIMD_X86
+    static __m128 sse(__m128 a, __m128 b) { return _mm_cmplt_ps(a, b); }
+#endif
+  };
+
+  inline float length(const float* rgb) { return rgb[0]*rgb[0] + rgb[1]*rgb[1] + rgb[2]*rgb[2]; }
+
+  template<typename Compare>
+  inline std::size_t selectLength(const float* rgb, std::size_t pixels)
+  {
+    if(pixels == 0) return 0;
+
+    std::size_t best = 0;
+    float bestLength = length(rgb);
+    std::size_t p = 1;
+
+#ifdef SIMD_X86
+    if(hasSSE2() && pixels >= 4)
+    {
+      __m128 bestValue = _mm_set1_ps(bestLength);
+      __m128i bestIndex = _mm_setzero_si128();
+      __m128i index = _mm_set_epi32(3, 2, 1, 0);
+      const __m128i four = _mm_set1_epi32(4);
+
+      for(p=0; p + 4 <= pixels; p += 4)
+      {
+        // squares of r0 g0 b0 r1 | g1 b1 r2 g2 | b2 r3 g3 b3
+        __m128 a0 = _mm_loadu_ps(rgb + 3*p);
+        __m128 a1 = _mm_loadu_ps(rgb + 3*p + 4);
+        __m128 a2 = _mm_loadu_ps(rgb + 3*p + 8);
+        a0 = _mm_mul_ps(a0, a0);
+        a1 = _mm_mul_ps(a1, a1);
+        a2 = _mm_mul_ps(a2, a2);
+
+        // deinterleave
+        __m128 r = _mm_shuffle_ps(a0, _mm_shuffle_ps(a1, a2, _MM_SHUFFLE(1,0,3,2)), _MM_SHUFFLE(3,0,3,0));
+        __m128 g = _mm_shuffle_ps(_mm_shuffle_ps(a0, a1, _MM_SHUFFLE(0,0,1,1)), _mm_shuffle_ps(a1, a2, _MM_SHUFFLE(2,2,3,3)), _MM_SHUFFLE(2,0,2,0));
+        __m128 b = _mm_shuffle_ps(_mm_shuffle_ps(a0, a1, _MM_SHUFFLE(1,1,2,2)), _mm_shuffle_ps(a2, a2, _MM_SHUFFLE(3,3,0,0)), _MM_SHUFFLE(2,0,2,0));
+        __m128 len = _mm_add_ps(_mm_add_ps(r, g), b);
+
+        // strict compare keeps the first index per lane
+        __m128 better = Compare::sse(len, bestValue);
+        __m128i betteri = _mm_castps_si128(better);
+        bestValue = _mm_or_ps(_mm_and_ps(better, len), _mm_andnot_ps(better, bestValue));
+        bestIndex = _mm_or_si128(_mm_and_si128(betteri, index), _mm_andnot_si128(betteri, bestIndex));
+        index = _mm_add_epi32(index, four);
+      }
+
+      // combine lanes (ties: lowest index)
+      float values[4];
+      int indices[4];
+      _mm_storeu_ps(values, bestValue);
+      _mm_storeu_si128((__m128i*)indices, bestIndex);
+      for(unsigned int lane=0; lane < 4; lane++)
+        if(Compare::scalar(values[lane], bestLength) || (values[lane] == bestLength && (std::size_t)(indices[lane]) < best))
+        {
+          bestLength = values[lane];
+          best = indices[lane];
+        }
+    }
+#endif
+
+    for(; p < pixels; p++)
+    {
+      float len = length(rgb + 3*p);
+      if(Compare::scalar(len, bestLength)) { bestLength = len; best = p; }
+    }
+
+    return best;
+  }
+
+} // end detail namespace
+
+
+//////////////////////////////
+// binary operations        //
+//////////////////////////////
+inline void add(const float* a, const float* b, float* dst, std::size_t n)      { detail::binary<detail::addOp>(a, b, dst, n); }
+inline void subtract(const float* a, const float* b, float* dst, std::size_t n) { detail::binary<detail::subtractOp>(a, b, dst, n); }
+inline void multiply(const float* a, const float* b, float* dst, std::size_t n) { detail::binary<detail::multiplyOp>(a, b, dst, n); }
+inline void divide(const float* a, const float* b, float* dst, std::size_t n)   { detail::binary<detail::divideOp>(a, b, dst, n); }
+
+
+//////////////////////////////
+// scalar operations        //
+//////////////////////////////
+inline void addScalar(const float* a, const float* s, float* dst, std::size_t n)      { detail::scalar<detail::addOp>(a, s, dst, n); }
+inline void subtractScalar(const float* a, const float* s, float* dst, std::size_t n) { detail::scalar<detail::subtractOp>(a, s, dst, n); }
+inline void multiplyScalar(const float* a, const float* s, float* dst, std::size_t n) { detail::scalar<detail::multiplyOp>(a, s, dst, n); }
+inline void divideScalar(const float* a, const float* s, float* dst, std::size_t n)   { detail::scalar<detail::divideOp>(a, s, dst, n); }
+
+
+//////////////////////////////
+// power                    //
+//////////////////////////////
+inline void power(const float* a, float e, float* dst, std::size_t n)
+{
+#ifdef SIMD_X86
+  // non-finite exponents: leave it to std::pow
+  if(e == e && std::fabs(e) <= std::numeric_limits<float>::max())
+  {
+    if(hasAVX2()) { detail::powerAVX2(a, e, dst, n); return; }
+    if(hasSSE2()) { detail::powerSSE(a, e, dst, n); return; }
+  }
+#endif
+  detail::powerScalar(a, e, dst, 0, n);
+}
+
+
+//////////////////////////////
+// sum                      //
+//                          //
+// Accumulate in float      //
+// vectors over short       //
+// blocks, and in double    //
+// across blocks.           //
+//////////////////////////////
+inline double sum(const float* a, std::size_t n)
+{
+  const std::size_t blockSize = 1024;
+  double result = 0.0;
+  std::size_t i = 0;
+
+#ifdef SIMD_X86
+  if(hasSSE2())
+    for(; i + blockSize <= n; i += blockSize)
+    {
+      __m128 acc0 = _mm_setzero_ps(), acc1 = _mm_setzero_ps();
+      for(std::size_t j=i; j < i + blockSize; j += 8)
+      {
+        acc0 = _mm_add_ps(acc0, _mm_loadu_ps(a + j));
+        acc1 = _mm_add_ps(acc1, _mm_loadu_ps(a + j + 4));
+      }
+
+      float lanes[4];
+      _mm_storeu_ps(lanes, _mm_add_ps(acc0, acc1));
+      result += (double)(lanes[0]) + lanes[1] + lanes[2] + lanes[3];
+    }
+#endif
+
+  for(; i < n; i++)
+    result += a[i];
+
+  return result;
+}
+
+
+//////////////////////////////
+// channelSum               //
+//////////////////////////////
+inline void channelSum(const float* rgb, std::size_t pixels, double result[3])
+{
+  const std::size_t n = 3 * pixels;
+  const std::size_t blockSize = 1020;        // multiple of 12
+  result[0] = result[1] = result[2] = 0.0;
+  std::size_t i = 0;
+
+#ifdef SIMD_X86
+  if(hasSSE2())
+    for(; i + blockSize <= n; i += blockSize)
+    {
+      // acc0: r g b r, acc1: g b r g, acc2: b r g b
+      __m128 acc0 = _mm_setzero_ps(), acc1 = _mm_setzero_ps(), acc2 = _mm_setzero_ps();
+      for(std::size_t j=i; j < i + blockSize; j += 12)
+      {
+        acc0 = _mm_add_ps(acc0, _mm_loadu_ps(rgb + j));
+        acc1 = _mm_add_ps(acc1, _mm_loadu_ps(rgb + j + 4));
+        acc2 = _mm_add_ps(acc2, _mm_loadu_ps(rgb + j + 8));
+      }
+
+      float lanes[12];
+      _mm_storeu_ps(lanes, acc0);
+      _mm_storeu_ps(lanes + 4, acc1);
+      _mm_storeu_ps(lanes + 8, acc2);
+      for(unsigned int k=0; k < 12; k++)
+        result[k % 3] += lanes[k];
+    }
+#endif
+
+  for(; i < n; i++)
+    result[i % 3] += rgb[i];
+}
+
+
+//////////////////////////////
+// min                      //
+//////////////////////////////
+inline float min(const float* a, std::size_t n)
+{
+  float result = std::numeric_limits<float>::infinity();
+  std::size_t i = 0;
+
+#ifdef SIMD_X86
+  if(hasSSE2() && n >= 8)
+  {
+    __m128 acc0 = _mm_set1_ps(result), acc1 = acc0;
+    for(; i + 8 <= n; i += 8)
+    {
+      acc0 = _mm_min_ps(acc0, _mm_loadu_ps(a + i));
+      acc1 = _mm_min_ps(acc1, _mm_loadu_ps(a + i + 4));
+    }
+
+    float lanes[4];
+    _mm_storeu_ps(lanes, _mm_min_ps(acc0, acc1));
+    result = std::min(std::min(lanes[0], lanes[1]), std::min(lanes[2], lanes[3]));
+  }
+#endif
+
+  for(; i < n; i++)
+    result = std::min(result, a[i]);
+
+  return result;
+}
+
+
+//////////////////////////////
+// max                      //
+//////////////////////////////
+inline float max(const float* a, std::size_t n)
+{
+  float result = -std::numeric_limits<float>::infinity();
+  std::size_t i = 0;
+
+#ifdef SIMD_X86
+  if(hasSSE2() && n >= 8)
+  {
+    __m128 acc0 = _mm_set1_ps(result), acc1 = acc0;
+    for(; i + 8 <= n; i += 8)
+    {
+      acc0 = _mm_max_ps(acc0, _mm_loadu_ps(a + i));
+      acc1 = _mm_max_ps(acc1, _mm_loadu_ps(a + i + 4));
+    }
+
+    float lanes[4];
+    _mm_storeu_ps(lanes, _mm_max_ps(acc0, acc1));
+    result = std::max(std::max(lanes[0], lanes[1]), std::max(lanes[2], lanes[3]));
+  }
+#endif
+
+  for(; i < n; i++)
+    result = std::max(result, a[i]);
+
+  return result;
+}
+
+
+//////////////////////////////
+// maxLength & minLength    //
+//////////////////////////////
+inline std::size_t maxLength(const float* rgb, std::size_t pixels) { return detail::selectLength<detail::greaterOp>(rgb, pixels); }
+inline std::size_t minLength(const float* rgb, std::size_t pixels) { return detail::selectLength<detail::lessOp>(rgb, pixels); }
+
+
+//////////////////////////////
+// deinterleave             //
+//////////////////////////////
+inline void deinterleave(const float* rgb, float* r, float* g, float* b, std::size_t pixels)
+{
+  std::size_t p = 0;
+
+#ifdef SIMD_X86
+  if(hasSSE2())
+    for(; p + 4 <= pixels; p += 4)
+    {
+      // r0 g0 b0 r1 | g1 b1 r2 g2 | b2 r3 g3 b3
+      __m128 a0 = _mm_loadu_ps(rgb + 3*p);
+      __m128 a1 = _mm_loadu_ps(rgb + 3*p + 4);
+      __m128 a2 = _mm_loadu_ps(rgb + 3*p + 8);
+
+      _mm_storeu_ps(r + p, _mm_shuffle_ps(a0, _mm_shuffle_ps(a1, a2, _MM_SHUFFLE(1,0,3,2)), _MM_SHUFFLE(3,0,3,0)));
+      _mm_storeu_ps(g + p, _mm_shuffle_ps(_mm_shuffle_ps(a0, a1, _MM_SHUFFLE(0,0,1,1)), _mm_shuffle_ps(a1, a2, _MM_SHUFFLE(2,2,3,3)), _MM_SHUFFLE(2,0,2,0)));
+      _mm_storeu_ps(b + p, _mm_shuffle_ps(_mm_shuffle_ps(a0, a1, _MM_SHUFFLE(1,1,2,2)), _mm_shuffle_ps(a2, a2, _MM_SHUFFLE(3,3,0,0)), _MM_SHUFFLE(2,0,2,0)));
+    }
+#endif
+
+  for(; p < pixels; p++)
+  {
+    r[p] = rgb[3*p];
+    g[p] = rgb[3*p + 1];
+    b[p] = rgb[3*p + 2];
+  }
+}
+
+
+//////////////////////////////
+// interleave               //
+//////////////////////////////
+inline void interleave(const float* r, const float* g, const float* b, float* rgb, std::size_t pixels)
+{
+  std::size_t p = 0;
+
+#ifdef SIMD_X86
+  if(hasSSE2())
+    for(; p + 4 <= pixels; p += 4)
+    {
+      __m128 vr = _mm_loadu_ps(r + p);
+      __m128 vg = _mm_loadu_ps(g + p);
+      __m128 vb = _mm_loadu_ps(b + p);
+
+      // r0 g0 b0 r1 | g1 b1 r2 g2 | b2 r3 g3 b3
+      _mm_storeu_ps(rgb + 3*p,     _mm_shuffle_ps(_mm_shuffle_ps(vr, vg, _MM_SHUFFLE(0,0,0,0)), _mm_shuffle_ps(vb, vr, _MM_SHUFFLE(1,1,0,0)), _MM_SHUFFLE(2,0,2,0)));
+      _mm_storeu_ps(rgb + 3*p + 4, _mm_shuffle_ps(_mm_shuffle_ps(vg, vb, _MM_SHUFFLE(1,1,1,1)), _mm_shuffle_ps(vr, vg, _MM_SHUFFLE(2,2,2,2)), _MM_SHUFFLE(2,0,2,0)));
+      _mm_storeu_ps(rgb + 3*p + 8, _mm_shuffle_ps(_mm_shuffle_ps(vb, vr, _MM_SHUFFLE(3,3,2,2)), _mm_shuffle_ps(vg, vb, _MM_SHUFFLE(3,3,3,3)), _MM_SHUFFLE(2,0,2,0)));
+    }
+#endif
+
+  for(; p < pixels; p++)
+  {
+    rgb[3*p]     = r[p];
+    rgb[3*p + 1] = g[p];
+    rgb[3*p + 2] = b[p];
+  }
+}
+
+} // end simd namespace
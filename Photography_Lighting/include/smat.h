@@ -0,0 +1,176 @@
+#ifndef _SMAT_H_
+#define _SMAT_H_
+
+#include <ostream>
+#include <cassert>
+#include <cmath>
+#include <algorithm>
+#include <boost/type_traits.hpp>
+#include <boost/utility/enable_if.hpp>
+
+#include "mat.h"
+#include "vec3d.h"
+#include "color.h"
+
+/////////////////////////////////////////////////////
+// Fixed size R x C matrix with inline storage     //
+// (e.g., 3x3 color transforms, 4x4 transforms).   //
+// Same conventions as mat<T>: column major,       //
+// operator()(x,y) with x the column and y the     //
+// row, width() = C and height() = R.  All loops   //
+// have compile-time bounds and are unrolled by    //
+// the compiler; no heap allocation.               //
+/////////////////////////////////////////////////////
+template<typename T, int R, int C>
+struct smat {
+public:
+  /////////////
+  // Typedef //
+  /////////////
+  typedef T            value_type;
+  typedef T&           reference;
+  typedef const T&     const_reference;
+  typedef T*           iterator;
+  typedef const T*     const_iterator;
+
+  enum { rows = R, cols = C, elements = R*C };
+
+  //////////////////
+  // Constructors //
+  //////////////////
+  smat(const_reference value=(T)(0))   { std::fill(begin(), end(), value); }
+
+  template<typename Iterator>
+    explicit smat(Iterator data, typename boost::disable_if<boost::is_fundamental<Iterator> >::type* = 0)  { std::copy(data, data + elements, begin()); }
+
+  explicit smat(const mat<T>& m);
+
+  static smat<T,R,C> identity(void);
+
+  ///////////////////
+  // Cast Operator //
+  ///////////////////
+  operator mat<T>() const { return mat<T>(C, R, begin()); }
+
+  //////////////////////
+  // Iterator Support //
+  //////////////////////
+  const_iterator begin(void) const { return _data; }
+  const_iterator end(void) const   { return _data + elements; }
+
+  iterator begin(void) { return _data; }
+  iterator end(void)   { return _data + elements; }
+
+  ////////////////
+  // Inspectors //
+  ////////////////
+  reference operator()(int x, int y)              { return _data[x*R + y]; }
+  const_reference operator()(int x, int y) const  { return _data[x*R + y]; }
+
+  reference operator[](int i)              { return _data[i]; }
+  const_reference operator[](int i) const  { return _data[i]; }
+
+  int width(void) const  { return C; }
+  int height(void) const { return R; }
+  int size(void) const   { return elements; }
+
+  ///////////////
+  // Operator= //
+  ///////////////
+  smat<T,R,C>& operator=(const_reference val) { std::fill(begin(), end(), val); return *this; }
+
+  ///////////////
+  //   Math    //
+  // Operators //
+  ///////////////
+  template<int K>
+    smat<T,R,K> operator*(const smat<T,C,K>& other) const;
+
+  smat<T,R,C> operator*(const_reference val) const  { smat<T,R,C> result(*this); return (result *= val); }
+  smat<T,R,C> operator/(const_reference val) const  { smat<T,R,C> result(*this); return (result /= val); }
+  smat<T,R,C> operator+(const smat<T,R,C>& other) const  { smat<T,R,C> result(*this); return (result += other); }
+  smat<T,R,C> operator-(const smat<T,R,C>& other) const  { smat<T,R,C> result(*this); return (result -= other); }
+
+  smat<T,R,C>& operator*=(const_reference val)  { for(int i=0; i < elements; i++) _data[i] *= val; return *this; }
+  smat<T,R,C>& operator/=(const_reference val)  { for(int i=0; i < elements; i++) _data[i] /= val; return *this; }
+  smat<T,R,C>& operator+=(const smat<T,R,C>& other)  { for(int i=0; i < elements; i++) _data[i] += other._data[i]; return *this; }
+  smat<T,R,C>& operator-=(const smat<T,R,C>& other)  { for(int i=0; i < elements; i++) _data[i] -= other._data[i]; return *this; }
+
+  /////////////
+  // Compare //
+  /////////////
+  bool operator==(const smat<T,R,C>& other) const { return std::equal(begin(), end(), other.begin()); }
+  bool operator!=(const smat<T,R,C>& other) const { return !(*this == other); }
+
+  //////////////////////
+  // Matrix Functions //
+  //////////////////////
+  smat<T,C,R> transpose(void) const;
+
+  /////////////
+  // Friends //
+  /////////////
+  friend std::ostream& operator<<(std::ostream& s, const smat<T,R,C>& m)
+  {
+    for(int j=0; j < R; j++)
+    {
+      for(int i=0; i < C; i++)
+	s << m(i,j) << ", ";
+      s << "\r\n";
+    }
+    return s;
+  }
+
+protected:
+  //////////////////
+  // Data Members //
+  //////////////////
+  T _data[R*C];
+};
+
+
+////////////////////////////////////////
+// Products with vectors and colors   //
+// (treated as column vectors).       //
+////////////////////////////////////////
+template<typename T>
+  vec3d<T> operator*(const smat<T,3,3>& m, const vec3d<T>& v);
+
+template<typename T>
+  color<T> operator*(const smat<T,3,3>& m, const color<T>& c);
+
+template<typename T>
+  vec3d<T> transformPoint(const smat<T,4,4>& m, const vec3d<T>& p);     // homogeneous (w=1), divided by w
+
+template<typename T>
+  vec3d<T> transformVector(const smat<T,4,4>& m, const vec3d<T>& v);    // homogeneous (w=0)
+
+
+////////////////////////////////////////
+// Determinant and in-place inverse   //
+// of square matrices.  invert()      //
+// returns false (and leaves 'm'      //
+// unspecified) if 'm' is singular.   //
+////////////////////////////////////////
+template<typename T>
+  T determinant(const smat<T,2,2>& m);
+
+template<typename T>
+  T determinant(const smat<T,3,3>& m);
+
+template<typename T, int N>
+  bool invert(smat<T,N,N>& m);
+
+template<typename T>
+  bool invert(smat<T,2,2>& m);
+
+template<typename T>
+  bool invert(smat<T,3,3>& m);
+
+
+////////////////////
+// Inline Methods //
+////////////////////
+#include "smat.inline.h"
+
+#endif /* _SMAT_H_ */
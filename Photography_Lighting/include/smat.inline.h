@@ -0,0 +1,217 @@
+#if defined(_SMAT_H_) && !defined(_SMAT_INLINE_H_)
+#define _SMAT_INLINE_H_
+
+/////////////////////////////
+// Constructor (from mat)  //
+/////////////////////////////
+template<typename T, int R, int C>
+inline smat<T,R,C>::smat(const mat<T>& m)
+{
+  // sanity check
+  assert(m.width() == C && m.height() == R);
+
+  // same storage order
+  std::copy(m.begin(), m.end(), begin());
+}
+
+
+//////////////
+// identity //
+//////////////
+template<typename T, int R, int C>
+inline smat<T,R,C> smat<T,R,C>::identity(void)
+{
+  smat<T,R,C> result;
+  for(int i=0; i < R && i < C; i++)
+    result(i,i) = (T)(1);
+  return result;
+}
+
+
+///////////////
+// Operator* //
+///////////////
+template<typename T, int R, int C>
+  template<int K>
+inline smat<T,R,K> smat<T,R,C>::operator*(const smat<T,C,K>& other) const
+{
+  smat<T,R,K> result;
+  for(int i=0; i < K; i++)
+    for(int k=0; k < C; k++)
+    {
+      const T b = other(i,k);
+      for(int j=0; j < R; j++)
+	result(i,j) += (*this)(k,j) * b;
+    }
+  return result;
+}
+
+
+///////////////
+// transpose //
+///////////////
+template<typename T, int R, int C>
+inline smat<T,C,R> smat<T,R,C>::transpose(void) const
+{
+  smat<T,C,R> result;
+  for(int w=0; w < C; w++)
+    for(int h=0; h < R; h++)
+      result(h, w) = (*this)(w, h);
+  return result;
+}
+
+
+/////////////////////////////////
+// Vector and color products   //
+/////////////////////////////////
+template<typename T>
+inline vec3d<T> operator*(const smat<T,3,3>& m, const vec3d<T>& v)
+{
+  return vec3d<T>(m[0]*v.x + m[3]*v.y + m[6]*v.z,
+		  m[1]*v.x + m[4]*v.y + m[7]*v.z,
+		  m[2]*v.x + m[5]*v.y + m[8]*v.z);
+}
+
+
+template<typename T>
+inline color<T> operator*(const smat<T,3,3>& m, const color<T>& c)
+{
+  return color<T>(m[0]*c.r + m[3]*c.g + m[6]*c.b,
+		  m[1]*c.r + m[4]*c.g + m[7]*c.b,
+		  m[2]*c.r + m[5]*c.g + m[8]*c.b);
+}
+
+
+template<typename T>
+inline vec3d<T> transformPoint(const smat<T,4,4>& m, const vec3d<T>& p)
+{
+  T w = m[3]*p.x + m[7]*p.y + m[11]*p.z + m[15];
+  return vec3d<T>(m[0]*p.x + m[4]*p.y + m[8]*p.z + m[12],
+		  m[1]*p.x + m[5]*p.y + m[9]*p.z + m[13],
+		  m[2]*p.x + m[6]*p.y + m[10]*p.z + m[14]) / w;
+}
+
+
+template<typename T>
+inline vec3d<T> transformVector(const smat<T,4,4>& m, const vec3d<T>& v)
+{
+  return vec3d<T>(m[0]*v.x + m[4]*v.y + m[8]*v.z,
+		  m[1]*v.x + m[5]*v.y + m[9]*v.z,
+		  m[2]*v.x + m[6]*v.y + m[10]*v.z);
+}
+
+
+/////////////////
+// determinant //
+/////////////////
+template<typename T>
+inline T determinant(const smat<T,2,2>& m)
+{
+  return m[0]*m[3] - m[2]*m[1];
+}
+
+
+template<typename T>
+inline T determinant(const smat<T,3,3>& m)
+{
+  return m[0]*(m[4]*m[8] - m[7]*m[5])
+       - m[3]*(m[1]*m[8] - m[7]*m[2])
+       + m[6]*(m[1]*m[5] - m[4]*m[2]);
+}
+
+
+////////////
+// invert //
+////////////
+template<typename T, int N>
+inline bool invert(smat<T,N,N>& m)
+{
+  // Gauss-Jordan elimination with partial pivoting
+  smat<T,N,N> inv = smat<T,N,N>::identity();
+
+  for(int c=0; c < N; c++)
+  {
+    // find pivot
+    int pivot = c;
+    for(int r=c+1; r < N; r++)
+      if(std::abs(m(c,r)) > std::abs(m(c,pivot))) pivot = r;
+    if(m(c,pivot) == (T)(0)) return false;
+
+    // swap rows
+    if(pivot != c)
+      for(int x=0; x < N; x++)
+      {
+	std::swap(m(x,c), m(x,pivot));
+	std::swap(inv(x,c), inv(x,pivot));
+      }
+
+    // normalize pivot row
+    T scale = (T)(1) / m(c,c);
+    for(int x=0; x < N; x++)
+    {
+      m(x,c) *= scale;
+      inv(x,c) *= scale;
+    }
+
+    // eliminate column c from the other rows
+    for(int r=0; r < N; r++)
+    {
+      if(r == c) continue;
+      T f = m(c,r);
+      for(int x=0; x < N; x++)
+      {
+	m(x,r) -= f * m(x,c);
+	inv(x,r) -= f * inv(x,c);
+      }
+    }
+  }
+
+  m = inv;
+  return true;
+}
+
+
+template<typename T>
+inline bool invert(smat<T,2,2>& m)
+{
+  T det = determinant(m);
+  if(det == (T)(0)) return false;
+
+  T inv = (T)(1) / det;
+  T a = m[0];
+  m[0] = m[3] * inv;
+  m[3] = a * inv;
+  m[1] = -m[1] * inv;
+  m[2] = -m[2] * inv;
+  return true;
+}
+
+
+template<typename T>
+inline bool invert(smat<T,3,3>& m)
+{
+  // adjugate / determinant
+  T c0 = m[4]*m[8] - m[7]*m[5];
+  T c1 = m[7]*m[2] - m[1]*m[8];
+  T c2 = m[1]*m[5] - m[4]*m[2];
+
+  T det = m[0]*c0 + m[3]*c1 + m[6]*c2;
+  if(det == (T)(0)) return false;
+  T inv = (T)(1) / det;
+
+  smat<T,3,3> result;
+  result[0] = c0 * inv;
+  result[1] = c1 * inv;
+  result[2] = c2 * inv;
+  result[3] = (m[6]*m[5] - m[3]*m[8]) * inv;
+  result[4] = (m[0]*m[8] - m[6]*m[2]) * inv;
+  result[5] = (m[3]*m[2] - m[0]*m[5]) * inv;
+  result[6] = (m[3]*m[7] - m[6]*m[4]) * inv;
+  result[7] = (m[6]*m[1] - m[0]*m[7]) * inv;
+  result[8] = (m[0]*m[4] - m[3]*m[1]) * inv;
+
+  m = result;
+  return true;
+}
+
+#endif /* _SMAT_INLINE_H_ */